@@ -0,0 +1,483 @@
+/** Latency benchmarks for the main client side data paths
+ *
+ * Runs the loopback backend in the same process, opens a session to it and measures each path repeatedly. Reports
+ * percentiles and a log2 latency histogram per path, optionally as JSON so that results of different releases can be
+ * compared by scripts.
+ *
+ * Measured paths:
+ *  - ffb_generate_effect_call: FfbPipeline::generateEffect call duration
+ *  - ffb_generate_effect_to_wire: from generateEffect call to the datagram being received by the backend
+ *  - ffb_replay_send: EffectReplayer::sendNext of effects recorded with EffectRecorder, only with --replay
+ *  - telemetry_update_group_send: TelemetryUpdateGroup::send with 8 telemetries
+ *  - bson_shm_data_provider_update: BsonShmDataProvider::update copying device info from shared memory
+ *  - device_info_parse: DeviceInfoProvider::parseDeviceInfo without cached result
+ *  - sim_data_parse: SimData::parseFromRaw of 20 vehicles, 40 participants, 4 tracks, 4 tires and 2 sessions
+ *  - variable_find: VariableDefinitions::find by name and device
+ *  - blocking_command_round_trip: Session::blockingCommand round trip through TCP
+ *
+ * Heap allocations made by any thread of the process during the measured calls are counted and reported per call, so
+ * that paths that should not allocate in the steady state can be checked.
+ *
+ * No other backend, real or loopback, may be running at the same time.
+ *
+ * Usage: sc-api-bench [--iterations N] [--json <path or - for stdout>] [--replay <effect recording>]
+ */
+#include <sc-api/core/api_core.h>
+#include <sc-api/core/command.h>
+#include <sc-api/core/device_info.h>
+#include <sc-api/core/ffb.h>
+#include <sc-api/core/ffb_recorder.h>
+#include <sc-api/core/session.h>
+#include <sc-api/core/sim_data.h>
+#include <sc-api/core/sim_data/participant.h>
+#include <sc-api/core/sim_data/session.h>
+#include <sc-api/core/sim_data/tire.h>
+#include <sc-api/core/sim_data/track.h>
+#include <sc-api/core/sim_data/vehicle.h>
+#include <sc-api/core/sim_data_builder.h>
+#include <sc-api/core/telemetry.h>
+#include <sc-api/core/telemetry_references.h>
+#include <sc-api/core/time.h>
+#include <sc-api/core/variables.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "api_internal.h"
+#include "loopback_backend.h"
+
+using namespace sc_api::core;
+
+namespace {
+
+/** Number of heap allocations made by the process so far */
+std::atomic<uint64_t> g_allocations{0};
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return ::operator new(size); }
+void  operator delete(void* p) noexcept { std::free(p); }
+void  operator delete[](void* p) noexcept { std::free(p); }
+void  operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void  operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+constexpr int k_histogram_buckets = 32;
+
+struct Result {
+    std::string          name;
+    std::vector<int64_t> ns;
+    uint64_t             failures    = 0;
+    uint64_t             allocations = 0;
+
+    double allocationsPerCall() const {
+        const uint64_t calls = ns.size() + failures;
+        return calls == 0 ? 0.0 : (double)allocations / (double)calls;
+    }
+
+    int64_t percentile(double p) const { return ns.empty() ? 0 : ns[(std::size_t)(p * (double)(ns.size() - 1))]; }
+
+    double mean() const {
+        if (ns.empty()) return 0.0;
+        double sum = 0.0;
+        for (int64_t v : ns) sum += (double)v;
+        return sum / (double)ns.size();
+    }
+
+    /** Bucket i counts samples in range [2^i, 2^(i+1)) ns, bucket 0 also contains 0 ns */
+    std::vector<uint64_t> histogram() const {
+        std::vector<uint64_t> buckets(k_histogram_buckets, 0);
+        for (int64_t v : ns) {
+            int bucket = 0;
+            while (bucket + 1 < k_histogram_buckets && v >= ((int64_t)2 << bucket)) ++bucket;
+            ++buckets[bucket];
+        }
+        return buckets;
+    }
+};
+
+int64_t nowNs() { return Clock::now().time_since_epoch().count(); }
+
+/** Time f for the given number of iterations. f returns false if the operation failed, which isn't recorded */
+Result measure(const char* name, unsigned iterations, const std::function<bool()>& f,
+               const std::function<void()>& prepare = {}) {
+    Result r{name, {}, 0, 0};
+    r.ns.reserve(iterations);
+    for (unsigned i = 0; i < iterations; ++i) {
+        if (prepare) prepare();
+        const uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+        const int64_t  start       = nowNs();
+        const bool     ok          = f();
+        const int64_t  end         = nowNs();
+        r.allocations += g_allocations.load(std::memory_order_relaxed) - allocations;
+        if (ok) {
+            r.ns.push_back(end - start);
+        } else {
+            ++r.failures;
+        }
+    }
+    std::sort(r.ns.begin(), r.ns.end());
+    return r;
+}
+
+/** Build sim data in the format backend publishes it in the shared memory */
+std::shared_ptr<const uint8_t[]> buildRawSimData() {
+    std::vector<uint8_t> buffer;
+    util::BsonBuilder    b(&buffer);
+
+    auto id = [](const char* prefix, int i) {
+        std::string s(prefix);
+        s += (char)('a' + i / 26);
+        s += (char)('a' + i % 26);
+        return s;
+    };
+
+    sim_data::VehiclesBuilder vehicles;
+    sim_data::VehicleBuilder  vehicle;
+    for (int i = 0; i < 20; ++i) {
+        vehicle.set(sim_data::vehicle::name, id("Vehicle ", i))
+            .set(sim_data::vehicle::engine_idle_rpm, 900.0 + i)
+            .set(sim_data::vehicle::gearbox_forward_gears, 6);
+        vehicles.buildAndAdd(id("vehicle_", i), vehicle);
+    }
+    b.docAddSubDoc("vehicles", vehicles.finish().first);
+
+    sim_data::ParticipantsBuilder participants;
+    sim_data::ParticipantBuilder  participant;
+    for (int i = 1; i <= 40; ++i) {
+        participant.set(sim_data::participant::name, id("Driver ", i))
+            .set(sim_data::participant::abbrev_name, id("D", i))
+            .set(sim_data::participant::team_name, id("Team ", i / 2))
+            .set(sim_data::participant::vehicle_id, id("vehicle_", i % 20));
+        participants.buildAndAdd(i, participant);
+    }
+    b.docAddSubDoc("participants", participants.finish().first);
+
+    sim_data::TracksBuilder tracks;
+    sim_data::TrackBuilder  track;
+    for (int i = 0; i < 4; ++i) {
+        track.set(sim_data::track::name, id("Track ", i)).set(sim_data::track::track_length, 4500.0 + i);
+        tracks.buildAndAdd(id("track_", i), track);
+    }
+    b.docAddSubDoc("tracks", tracks.finish().first);
+
+    sim_data::TiresBuilder tires;
+    sim_data::TireBuilder  tire;
+    for (int i = 1; i <= 4; ++i) {
+        tire.set(sim_data::tire::name, id("Tire ", i)).set(sim_data::tire::hardness_order, i);
+        tires.buildAndAdd(i, tire);
+    }
+    b.docAddSubDoc("tires", tires.finish().first);
+
+    sim_data::SessionsBuilder sessions;
+    sim_data::SessionBuilder  session;
+    for (int i = 0; i < 2; ++i) {
+        session.set(sim_data::session::track_id, "track_aa")
+            .set(sim_data::session::player_vehicle_id, "vehicle_ab")
+            .set(sim_data::session::player_participant_id, 1);
+        sessions.buildAndAdd(id("session_", i), session);
+    }
+    b.docAddSubDoc("sessions", sessions.finish().first);
+
+    b.docAddElement("active_session", "session_aa");
+    b.docAddElement("active_sim", "bench");
+
+    auto [data, size] = b.finish();
+    std::shared_ptr<uint8_t[]> raw(new uint8_t[(std::size_t)size]);
+    std::memcpy(raw.get(), data, (std::size_t)size);
+    return raw;
+}
+
+void printTable(const std::vector<Result>& results) {
+    std::printf("%-32s %8s %10s %10s %10s %10s %10s %10s %10s\n", "benchmark", "count", "mean ns", "p50 ns", "p90 ns",
+                "p99 ns", "p99.9 ns", "max ns", "allocs/op");
+    for (const Result& r : results) {
+        std::printf("%-32s %8zu %10.0f %10lld %10lld %10lld %10lld %10lld %10.2f\n", r.name.c_str(), r.ns.size(),
+                    r.mean(), (long long)r.percentile(0.5), (long long)r.percentile(0.9),
+                    (long long)r.percentile(0.99), (long long)r.percentile(0.999),
+                    (long long)(r.ns.empty() ? 0 : r.ns.back()), r.allocationsPerCall());
+    }
+}
+
+void writeJson(std::FILE* f, const std::vector<Result>& results, unsigned iterations) {
+    const clock_source::SourceInfo clock_info = clock_source::getSourceInfo();
+
+    std::fprintf(f, "{\n  \"clock_source\": \"%s\",\n  \"clock_read_cost_ns\": %.1f,\n  \"iterations\": %u,\n",
+                 clock_source::toString(clock_info.type), clock_info.read_cost_ns, iterations);
+    std::fprintf(f, "  \"benchmarks\": [\n");
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fprintf(f,
+                     "    {\"name\": \"%s\", \"unit\": \"ns\", \"count\": %zu, \"failures\": %llu, \"min\": %lld, "
+                     "\"mean\": %.1f, \"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"p999\": %lld, \"max\": %lld, "
+                     "\"allocations_per_call\": %.3f,\n",
+                     r.name.c_str(), r.ns.size(), (unsigned long long)r.failures,
+                     (long long)(r.ns.empty() ? 0 : r.ns.front()), r.mean(), (long long)r.percentile(0.5),
+                     (long long)r.percentile(0.9), (long long)r.percentile(0.99), (long long)r.percentile(0.999),
+                     (long long)(r.ns.empty() ? 0 : r.ns.back()), r.allocationsPerCall());
+
+        // Histogram is written as [upper bound ns, count] pairs leaving out the empty tail
+        std::vector<uint64_t> buckets = r.histogram();
+        int                   last    = k_histogram_buckets - 1;
+        while (last > 0 && buckets[last] == 0) --last;
+        std::fprintf(f, "     \"histogram\": [");
+        for (int b = 0; b <= last; ++b) {
+            std::fprintf(f, "%s[%lld, %llu]", b == 0 ? "" : ", ", (long long)((int64_t)2 << b),
+                         (unsigned long long)buckets[b]);
+        }
+        std::fprintf(f, "]}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+}
+
+void printUsage() {
+    std::printf("Usage: sc-api-bench [--iterations N] [--json <path or - for stdout>] [--replay <effect recording>]\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    unsigned    iterations  = 10000;
+    const char* json_path   = nullptr;
+    const char* replay_path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "--iterations") == 0) {
+            iterations = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--json") == 0) {
+            json_path = argv[++i];
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--replay") == 0) {
+            replay_path = argv[++i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (iterations == 0) {
+        printUsage();
+        return 1;
+    }
+
+    // Effect start timestamp is the time of the generateEffect call, so the backend can compute the latency from it
+    std::vector<int64_t>  wire_ns(iterations);
+    std::atomic<unsigned> wire_count{0};
+    std::atomic_bool      record_wire{false};
+
+    sc_api::tools::LoopbackBackend backend;
+    backend.setActionObserver([&](const SC_API_PROTOCOL_ActionHeader_t& hdr, const uint8_t* action) {
+        const int64_t received = nowNs();
+
+        struct {
+            SC_API_PROTOCOL_ActionFbEffect_AAD_t aad;
+            uint16_t                             device;
+            SC_API_PROTOCOL_ActionFbEffect_Enc_t data;
+        } payload;
+
+        if (hdr.action_id != SC_API_PROTOCOL_ACTION_FB_EFFECT || hdr.size < sizeof(hdr) + sizeof(payload)) return;
+        std::memcpy(&payload, action + sizeof(hdr), sizeof(payload));
+
+        if (!record_wire.load(std::memory_order_acquire)) return;
+
+        const unsigned idx = wire_count.load(std::memory_order_relaxed);
+        if (idx >= wire_ns.size()) return;
+        wire_ns[idx] = received - (int64_t)(((uint64_t)payload.data.start_time_high << 32) | payload.data.start_time_low);
+        wire_count.store(idx + 1, std::memory_order_release);
+    });
+
+    if (!backend.start()) {
+        std::fprintf(stderr, "Failed to start loopback backend. Is another backend already running?\n");
+        return 2;
+    }
+
+    ApiCore                  api;
+    std::shared_ptr<Session> session;
+    if (api.openSession(session) != sc_api::ResultCode::ok) {
+        std::fprintf(stderr, "Failed to open session to the loopback backend\n");
+        return 2;
+    }
+
+    ApiUserInformation user_info;
+    user_info.display_name = "sc-api-bench";
+    if (session->registerToControl(Session::control_ffb_effects | Session::control_telemetry, "sc-api-bench",
+                                   user_info) != sc_api::ResultCode::ok) {
+        std::fprintf(stderr, "Failed to register to control\n");
+        return 2;
+    }
+
+    std::atomic_bool stopping{false};
+    std::thread      session_thread([&]() {
+        while (!stopping) session->runUntilStateChanges();
+    });
+
+    auto            device_info = session->getDeviceInfo();
+    DeviceSessionId brake;
+    for (const auto& device : *device_info) {
+        if (device.getRole() == device_info::DeviceRole::brake_pedal) brake = device.getSessionId();
+    }
+
+    std::vector<Result> results;
+
+    {
+        FfbPipeline   pipeline(session, brake);
+        PipelineConfig config;
+        config.offset_type = OffsetType::force_N;
+        if (!pipeline.configure(config)) {
+            std::fprintf(stderr, "Failed to configure effect pipeline\n");
+        }
+
+        float samples[8] = {};
+        results.push_back(measure("ffb_generate_effect_call", iterations, [&]() {
+            return pipeline.generateEffect(Clock::now(), std::chrono::microseconds(125), samples, 8);
+        }));
+
+        // Let the datagrams of the previous run drain so that they aren't counted, then wait for each datagram before
+        // sending the next one so that queuing doesn't dominate the measurement
+        const int64_t drain_timeout = nowNs() + 1000000000;
+        while (backend.getActionStats().ffb_effect_actions < results.back().ns.size() && nowNs() < drain_timeout) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        wire_count = 0;
+        record_wire = true;
+        Result wire{"ffb_generate_effect_to_wire", {}, 0, 0};
+        for (unsigned i = 0; i < iterations; ++i) {
+            const uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+            const bool     ok = pipeline.generateEffect(Clock::now(), std::chrono::microseconds(125), samples, 8);
+            wire.allocations += g_allocations.load(std::memory_order_relaxed) - allocations;
+            if (!ok) {
+                ++wire.failures;
+                continue;
+            }
+            const int64_t timeout = nowNs() + 100000000;
+            while (wire_count.load(std::memory_order_acquire) <= i - wire.failures && nowNs() < timeout) {
+            }
+        }
+        record_wire             = false;
+        const unsigned received = wire_count.load(std::memory_order_acquire);
+        wire.failures += iterations - wire.failures - received;
+        wire.ns.assign(wire_ns.begin(), wire_ns.begin() + received);
+        std::sort(wire.ns.begin(), wire.ns.end());
+        results.push_back(std::move(wire));
+
+        if (replay_path) {
+            // All recorded pipelines are replayed to the brake pipeline in the recorded order
+            EffectReplayer replayer(session);
+            if (replayer.open(replay_path)) {
+                for (EffectPipelineRef ref : replayer.getRecordedPipelines()) replayer.mapPipeline(ref, pipeline);
+                const unsigned count = (unsigned)std::min<std::size_t>(iterations, replayer.getRecordCount());
+                results.push_back(measure("ffb_replay_send", count, [&]() { return replayer.sendNext(); }));
+            } else {
+                std::fprintf(stderr, "Failed to open effect recording %s\n", replay_path);
+            }
+        }
+    }
+
+    {
+        Telemetry physics_running(telemetry::physics_running, true);
+        Telemetry engine_rpm(telemetry::engine_rpm, 4000.0f);
+        Telemetry speed(telemetry::speed, 30.0f);
+        Telemetry brake_input(telemetry::brake_input);
+        Telemetry abs_active(telemetry::abs_active);
+        Telemetry acc_x(telemetry::local_acceleration_x);
+        Telemetry acc_y(telemetry::local_acceleration_y);
+        Telemetry gear(telemetry::transmission_gear, (int8_t)3);
+
+        TelemetryUpdateGroup group(1);
+        group.add({&physics_running, &engine_rpm, &speed, &brake_input, &abs_active, &acc_x, &acc_y, &gear});
+        if (!group.configure(session->getTelemetries())) {
+            std::fprintf(stderr, "Failed to configure telemetry update group\n");
+        }
+
+        results.push_back(measure("telemetry_update_group_send", iterations, [&]() {
+            brake_input.setValue(brake_input.getValue() + 0.001f);
+            return group.send() == ActionResult::complete;
+        }));
+    }
+
+    Session::Internal& internal = session->getInternal();
+
+    {
+        internal::BsonShmDataProvider provider;
+        results.push_back(measure(
+            "bson_shm_data_provider_update", iterations,
+            [&]() { return provider.update() == internal::BsonShmDataProvider::new_data; },
+            [&]() {
+                provider.setShmBuffer((const uint8_t*)internal.device_info.getBuffer(), internal.device_info.getSize());
+            }));
+    }
+
+    {
+        std::unique_ptr<internal::DeviceInfoProvider> provider;
+        results.push_back(measure(
+            "device_info_parse", iterations, [&]() { return provider->parseDeviceInfo() != nullptr; },
+            [&]() {
+                provider = std::make_unique<internal::DeviceInfoProvider>();
+                provider->initialize(internal.device_info.getBuffer(), internal.device_info.getSize());
+                provider->update();
+            }));
+    }
+
+    {
+        std::shared_ptr<const uint8_t[]> raw      = buildRawSimData();
+        uint32_t                         revision = 0;
+        results.push_back(measure("sim_data_parse", iterations, [&]() {
+            return sim_data::SimData::parseFromRaw(raw, ++revision) != nullptr;
+        }));
+    }
+
+    {
+        VariableDefinitions             vars = session->getVariables();
+        std::vector<VariableDefinition> defs;
+        for (VariableDefinition d : vars) defs.push_back(d);
+        if (defs.empty()) {
+            std::fprintf(stderr, "Backend has no variables, skipping variable_find\n");
+        } else {
+            std::size_t idx = 0;
+            results.push_back(measure("variable_find", iterations, [&]() {
+                const VariableDefinition& d = defs[idx++ % defs.size()];
+                return (bool)vars.find(d.name, d.device_session_id);
+            }));
+        }
+    }
+
+    results.push_back(measure("blocking_command_round_trip", iterations, [&]() {
+        return session->blockingCommand(CommandRequest("bench", "echo")).isSuccess();
+    }));
+
+    stopping = true;
+    session->stop();
+    session_thread.join();
+    session->close();
+    backend.stop();
+
+    if (json_path && std::strcmp(json_path, "-") == 0) {
+        writeJson(stdout, results, iterations);
+        return 0;
+    }
+
+    printTable(results);
+    if (json_path) {
+        std::FILE* f = std::fopen(json_path, "w");
+        if (!f) {
+            std::fprintf(stderr, "Failed to open %s for writing\n", json_path);
+            return 3;
+        }
+        writeJson(f, results, iterations);
+        std::fclose(f);
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+/** Compares action datagram transports on loopback UDP
+ *
+ * Sends a fixed number of datagrams per simulated tick through each transport and reports system calls per action
+ * and send latency percentiles per tick. Needs only the loopback interface, backend is not required.
+ *
+ * Usage: sc-api-transport-bench [datagrams_per_tick] [datagram_size] [ticks]
+ */
+#include <sc-api/core/time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "api_internal.h"
+#ifdef SC_API_IO_URING
+#include "uring_transport.h"
+#endif
+
+using namespace sc_api::core;
+
+namespace {
+
+struct Result {
+    const char*          name;
+    uint64_t             syscalls  = 0;
+    uint64_t             datagrams = 0;
+    uint64_t             not_sent  = 0;
+    std::vector<int64_t> tick_ns;
+};
+
+/** Drains the receiving socket so that send buffers don't fill up */
+class Receiver {
+public:
+    explicit Receiver(asio::io_context& ctx)
+        : socket_(ctx, asio::ip::udp::endpoint(asio::ip::make_address_v4("127.0.0.1"), 0)) {
+        socket_.set_option(asio::socket_base::receive_buffer_size(4 * 1024 * 1024));
+        socket_.non_blocking(true);
+        thread_ = std::thread([this]() {
+            std::vector<uint8_t> buf(65536);
+            while (running_) {
+                asio::error_code ec;
+                socket_.receive(asio::buffer(buf), 0, ec);
+                if (ec == asio::error::would_block) std::this_thread::yield();
+            }
+        });
+    }
+
+    ~Receiver() {
+        running_ = false;
+        thread_.join();
+    }
+
+    asio::ip::udp::endpoint endpoint() const { return socket_.local_endpoint(); }
+
+private:
+    asio::ip::udp::socket socket_;
+    std::atomic_bool      running_{true};
+    std::thread           thread_;
+};
+
+int64_t toNs(int64_t ticks) { return ticks * 1000000000 / clock_source::getTimestampFrequencyHz(); }
+
+void run(Result& result, unsigned ticks, const std::function<void()>& tick) {
+    result.tick_ns.reserve(ticks);
+    for (unsigned i = 0; i < ticks; ++i) {
+        int64_t start = clock_source::getTimestamp();
+        tick();
+        result.tick_ns.push_back(toNs(clock_source::getTimestamp() - start));
+
+        // Roughly 10 kHz tick rate so that receiver keeps up
+        int64_t end = clock_source::getTimestamp() + clock_source::getTimestampFrequencyHz() / 10000;
+        while (clock_source::getTimestamp() < end) {
+        }
+    }
+}
+
+void print(Result& r) {
+    std::sort(r.tick_ns.begin(), r.tick_ns.end());
+    auto pct = [&](double p) { return r.tick_ns[(std::size_t)(p * (double)(r.tick_ns.size() - 1))]; };
+    std::printf("%-14s %10.3f %10lld %10lld %10lld %10llu\n", r.name,
+                (double)r.syscalls / (double)std::max<uint64_t>(r.datagrams, 1), (long long)pct(0.5),
+                (long long)pct(0.99), (long long)r.tick_ns.back(), (unsigned long long)r.not_sent);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const unsigned per_tick = argc > 1 ? (unsigned)std::atoi(argv[1]) : 4;
+    const unsigned size     = argc > 2 ? (unsigned)std::atoi(argv[2]) : 1024;
+    const unsigned ticks    = argc > 3 ? (unsigned)std::atoi(argv[3]) : 20000;
+
+    Session::Internal h{};
+    Receiver          receiver(h.io_ctx);
+
+    h.high_priority_socket_target = receiver.endpoint();
+    h.high_priority_socket.open(asio::ip::udp::v4());
+    h.high_priority_socket.non_blocking(true);
+
+    std::vector<uint8_t>  data((std::size_t)per_tick * size, 0x5a);
+    std::vector<uint32_t> ends(per_tick);
+    for (unsigned i = 0; i < per_tick; ++i) {
+        ends[i] = (i + 1) * size;
+    }
+    std::vector<ActionResult> results(per_tick);
+
+    std::vector<Result> all;
+
+    Result send_to{"asio_send_to", 0, 0, 0, {}};
+    run(send_to, ticks, [&]() {
+        for (unsigned i = 0; i < per_tick; ++i) {
+            asio::error_code ec;
+            h.high_priority_socket.send_to(asio::buffer(data.data() + i * size, size), h.high_priority_socket_target,
+                                           0, ec);
+            ++send_to.syscalls;
+            ++send_to.datagrams;
+            send_to.not_sent += ec ? 1 : 0;
+        }
+    });
+    all.push_back(std::move(send_to));
+
+    // Send statistics record each sendmmsg call, so they give the actual number of system calls
+    h.action_stats_storage = std::make_unique<internal::ActionStatsCollector>();
+    h.action_stats.store(h.action_stats_storage.get(), std::memory_order_release);
+
+    Result batch{"batch", 0, 0, 0, {}};
+    run(batch, ticks, [&]() {
+        h.sendHighPrioBatch(data.data(), ends.data(), per_tick, results.data());
+        batch.datagrams += per_tick;
+        batch.not_sent += std::count_if(results.begin(), results.end(),
+                                        [](ActionResult r) { return r != ActionResult::complete; });
+    });
+    batch.syscalls = h.action_stats_storage->snapshot().send.count;
+    h.action_stats.store(nullptr, std::memory_order_release);
+    all.push_back(std::move(batch));
+
+#ifdef SC_API_IO_URING
+    auto uring = internal::UringTransport::create(h.high_priority_socket_target.data(),
+                                                  (uint32_t)h.high_priority_socket_target.size(), size);
+    if (uring) {
+        Result uring_result{"io_uring", 0, 0, 0, {}};
+        bool   supported = true;
+        run(uring_result, ticks, [&]() {
+            supported &= uring->send(data.data(), ends.data(), per_tick, results.data());
+            uring_result.datagrams += per_tick;
+            uring_result.not_sent += std::count_if(results.begin(), results.end(),
+                                                   [](ActionResult r) { return r != ActionResult::complete; });
+        });
+        uring_result.syscalls = uring->getSubmitCalls();
+        if (supported) {
+            all.push_back(std::move(uring_result));
+        } else {
+            std::printf("io_uring: kernel does not support fixed buffer socket writes\n");
+        }
+    } else {
+        std::printf("io_uring: not available\n");
+    }
+#else
+    std::printf("io_uring: not enabled in this build (SC_API_IO_URING)\n");
+#endif
+
+    std::printf("%u datagrams of %u bytes per tick, %u ticks\n\n", per_tick, size, ticks);
+    std::printf("%-14s %10s %10s %10s %10s %10s\n", "transport", "sc/action", "p50 ns", "p99 ns", "max ns",
+                "not sent");
+    for (Result& r : all) {
+        print(r);
+    }
+    return 0;
+}
@@ -6,7 +6,9 @@
 
 #ifndef SC_API_CORE_ACTION_H_
 #define SC_API_CORE_ACTION_H_
+#include <array>
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -15,6 +17,11 @@
 namespace sc_api::core {
 
 class Session;
+class ActionBatch;
+
+namespace internal {
+class ActionRing;
+}
 
 enum class ActionResult {
     /** Asynchronous operaton started */
@@ -29,21 +36,76 @@ enum class ActionResult {
     would_block
 };
 
+/** Distribution of measured durations in power of two nanosecond buckets */
+struct ActionLatencyStats {
+    static constexpr int k_bucket_count = 24;
+
+    uint64_t count    = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns   = 0;
+
+    /** buckets[i] counts durations in range [2^i, 2^(i+1)) ns. First bucket also contains 0 ns and the last bucket
+     * all longer durations */
+    std::array<uint64_t, k_bucket_count> buckets{};
+
+    double meanNs() const { return count == 0 ? 0.0 : (double)total_ns / (double)count; }
+};
+
+/** Number of sent actions and their total size in bytes, including the action header */
+struct ActionIdStats {
+    /** action_id of the entry that counts actions of all ids that didn't fit to the statistics table */
+    static constexpr uint16_t k_other = 0xffff;
+
+    uint16_t action_id = 0;
+    uint64_t actions   = 0;
+    uint64_t bytes     = 0;
+};
+
+/** Snapshot of the action send statistics of a session
+ *
+ * @see Session::setActionStatsEnabled
+ */
+struct ActionStats {
+    /** From starting to build the first action in an ActionBuilder until the actions are passed for sending */
+    ActionLatencyStats build;
+
+    /** Duration of SecureSessionInterface::encrypt calls */
+    ActionLatencyStats encrypt;
+
+    /** Duration of socket send system calls. One call may send multiple datagrams */
+    ActionLatencyStats send;
+
+    uint64_t datagrams_sent = 0;
+
+    /** Datagram send attempts that could not be completed because socket send buffer was full */
+    uint64_t would_block    = 0;
+
+    /** Datagrams that could not be sent because of a socket error */
+    uint64_t failures       = 0;
+
+    /** Actions passed for sending per action id */
+    std::vector<ActionIdStats> actions;
+};
+
 /** Helper class for constructing and sending actions
  *
  * Actions are the method for fast one-way communication from API user to the API backend
  * Actions are used for transferring telemetry and effect pipeline data.
  *
- * Multiple actions can be constructed to one buffer before sending.
+ * Multiple actions can be constructed to one buffer before sending. When sent, actions are packed to as few datagrams
+ * as the session's plaintext and encrypted packet size limits allow. Actions are never split between datagrams.
  */
 class ActionBuilder {
+    friend class ActionBatch;
+
 public:
     ActionBuilder() = default;
     ActionBuilder(ActionBuilder&& builder) noexcept;
     explicit ActionBuilder(std::shared_ptr<Session> session);
     ~ActionBuilder()                               = default;
 
-    ActionBuilder& operator=(const ActionBuilder&) = default;
+    /** Copies the built actions and the session. Queue to the sender thread isn't shared between builders */
+    ActionBuilder& operator=(const ActionBuilder& builder);
     ActionBuilder& operator=(ActionBuilder&&) noexcept;
 
     void     init(std::shared_ptr<Session> session);
@@ -97,9 +159,93 @@ public:
 private:
     void finalize();
 
-    std::shared_ptr<Session> session_;
-    std::vector<uint8_t>     buffer_;
-    uint32_t                 cur_start_idx_ = 0;
+    /** Finalizes the current action and splits buffer to datagrams that respect session's packet size limits
+     *
+     * @param[out] datagram_ends End offset of each datagram in the buffer
+     * @return false, if some action alone is larger than the session's packet size limit. Nothing should be sent then
+     */
+    bool splitToDatagrams(std::vector<uint32_t>& datagram_ends);
+
+    /** Keep only datagrams whose latest result was ActionResult::would_block
+     *
+     * @return false, if there were no such datagrams and the builder was reset
+     */
+    bool retainBlockedDatagrams();
+
+    /** Reserve buffers based on the session limits so that building and sending doesn't allocate */
+    void reserveCapacity();
+
+    /** Queue built datagrams to the session's sender thread, if it is running
+     *
+     * @return ActionResult::inprogress, if sender thread is not running and the caller should send directly
+     */
+    ActionResult queueToSender(std::atomic<ActionResult>* result_status);
+
+    static constexpr std::size_t k_reserved_datagrams = 8;
+
+    std::shared_ptr<Session>  session_;
+    std::vector<uint8_t>      buffer_;
+    std::vector<uint32_t>     datagram_ends_;
+    std::vector<ActionResult> datagram_results_;
+    uint32_t                  cur_start_idx_  = 0;
+
+    /** Timestamp of the first action built after reset. Only set while action statistics are collected */
+    int64_t build_start_ns_ = 0;
+
+    /** Queue to the sender thread. Created when the first action is sent while the sender is running */
+    std::shared_ptr<internal::ActionRing> ring_;
+};
+
+/** Queue of finalized action datagrams that are sent together
+ *
+ * Actions of each ActionBuilder added to the batch are packed to as few datagrams as the session's packet size limits
+ * allow. flush() sends all queued datagrams with as few system calls as possible (single sendmmsg call on Linux), which
+ * is useful when multiple effect pipelines and telemetry update groups are updated on every tick.
+ */
+class ActionBatch {
+public:
+    ActionBatch() = default;
+    explicit ActionBatch(std::shared_ptr<Session> session);
+
+    void                     init(std::shared_ptr<Session> session);
+    std::shared_ptr<Session> getSession() const { return session_; }
+
+    /** Moves actions from the builder to this batch
+     *
+     * Actions are queued as one datagram, or as multiple datagrams if they don't fit to the session's packet size
+     * limits.
+     *
+     * Resets builder back to the empty state, also when the actions couldn't be added.
+     *
+     * @returns false, if the builder is empty or belongs to a different session
+     */
+    bool add(ActionBuilder& builder);
+
+    /** Number of currently queued datagrams */
+    std::size_t size() const { return datagram_ends_.size(); }
+    bool        empty() const { return datagram_ends_.empty(); }
+
+    /** Drops all queued datagrams */
+    void clear();
+
+    /** Sends all queued datagrams without blocking and clears the batch
+     *
+     * Results of the individual datagrams are available from getResults() until the next flush.
+     *
+     * @returns ActionResult::complete, if all datagrams were sent
+     *          ActionResult::failed, if sending any of the datagrams failed
+     *          ActionResult::would_block, if some datagrams were not sent because socket send buffer was full
+     */
+    ActionResult flush();
+
+    /** Per datagram results of the latest flush in the order datagrams were added */
+    const std::vector<ActionResult>& getResults() const { return results_; }
+
+private:
+    std::shared_ptr<Session>  session_;
+    std::vector<uint8_t>      buffer_;
+    std::vector<uint32_t>     datagram_ends_;
+    std::vector<ActionResult> results_;
 };
 
 }  // namespace sc_api::core
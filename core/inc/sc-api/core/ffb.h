@@ -7,11 +7,17 @@
 #ifndef SC_API_CORE_FFB_H_
 #define SC_API_CORE_FFB_H_
 
+#include <atomic>
 #include <cassert>
+#include <functional>
+#include <memory>
+#include <vector>
 
 #include "action.h"
 #include "device.h"
 #include "events.h"
+#include "ffb_lead_time.h"
+#include "session_fwd.h"
 #include "time.h"
 
 namespace sc_api::core {
@@ -60,6 +66,23 @@ enum class InterpolationType {
     linear,
 };
 
+/** Format that samples are sent to the device in
+ *
+ * Samples are always given as float values in the offset unit. 16-bit formats halve the size of the effect data, which
+ * allows sending twice as many samples in one datagram, but the values are quantized to PipelineConfig::gain range.
+ */
+enum class SampleFormat {
+    /** 32-bit float values sent as is. PipelineConfig::gain isn't used */
+    f32,
+
+    /** Signed 16-bit values, where full scale -32767 - 32767 maps to offset range -gain - gain */
+    i16,
+
+    /** Unsigned 16-bit values, where full scale 0 - 65535 maps to offset range 0 - gain. Negative values are clamped
+     * to zero */
+    u16,
+};
+
 /** Filtering that is applied to the sampled value post-interpolation
  *
  *  filter_parameter meaning depends on this type
@@ -87,9 +110,15 @@ struct PipelineConfig {
     OffsetType        offset_type;
     InterpolationType interpolation_type = InterpolationType::linear;
 
-    /** Gain multiplier that is applied to the offset samples */
+    /** Gain multiplier that is applied to the offset samples
+     *
+     * With 16-bit sample formats this is the full scale offset value and must not be zero.
+     */
     float gain                           = 1.0f;
 
+    /** @see SampleFormat */
+    SampleFormat sample_format           = SampleFormat::f32;
+
     /** @see FilterType */
     FilterType filter_type               = FilterType::none;
 
@@ -98,15 +127,85 @@ struct PipelineConfig {
 
     constexpr bool operator==(const PipelineConfig& b) const {
         return offset_type == b.offset_type && interpolation_type == b.interpolation_type && gain == b.gain &&
-               filter_type == b.filter_type && filter_parameter == b.filter_parameter;
+               sample_format == b.sample_format && filter_type == b.filter_type &&
+               filter_parameter == b.filter_parameter;
     }
     constexpr bool operator!=(const PipelineConfig& b) const { return !(*this == b); }
 };
 
+/** Build effect action with samples in the given format
+ *
+ * @param gain Full scale value used for quantizing samples to 16-bit formats. Should match the pipeline configuration
+ */
 bool buildEffectOffsetDataAction(ActionBuilder& builder, EffectPipelineRef pipeline, Clock::time_point start_timestamp,
-                                 Clock::duration sample_time, const float* samples, unsigned sample_count);
+                                 Clock::duration sample_time, const float* samples, unsigned sample_count,
+                                 SampleFormat format = SampleFormat::f32, float gain = 1.0f);
 bool buildEffectClearAction(ActionBuilder& builder, EffectPipelineRef pipeline);
 
+/** Writes effect samples directly to the action buffer
+ *
+ * Effect generators can synthesize samples straight to the effect action without a separate sample buffer:
+ *
+ *     EffectSampleWriter writer;
+ *     if (writer.begin(builder, ref, start, sample_time, count)) {
+ *         float* samples = writer.getF32Samples();
+ *         for (unsigned i = 0; i < count; ++i) samples[i] = generate(i);
+ *         writer.finish();
+ *         builder.sendNonBlocking();
+ *     }
+ *
+ * No other actions may be built to the builder between begin and finish, because that may move the buffer.
+ *
+ * Sample pointers are aligned for the sample type if the preceding actions in the builder have sizes that are
+ * multiples of four bytes, which is always the case when the effect is the first action in the builder.
+ */
+class EffectSampleWriter {
+public:
+    /** Start building effect action with sample_count samples to the builder
+     *
+     * Sample values are undefined until written. All samples must be written before finish() is called.
+     *
+     * @param gain Full scale value used by writeSamples for 16-bit formats. Should match the pipeline configuration
+     * @return false, if the action could not be started or gain is zero with a 16-bit format. Writer is left inactive
+     */
+    bool begin(ActionBuilder& builder, EffectPipelineRef pipeline, Clock::time_point start_timestamp,
+               Clock::duration sample_time, unsigned sample_count, SampleFormat format = SampleFormat::f32,
+               float gain = 1.0f);
+
+    /** Sample data of SampleFormat::f32 action. nullptr, if the format is different */
+    float* getF32Samples() const { return format_ == SampleFormat::f32 ? (float*)sample_data_ : nullptr; }
+
+    /** Raw quantized sample data of SampleFormat::i16 action. nullptr, if the format is different */
+    int16_t* getI16Samples() const { return format_ == SampleFormat::i16 ? (int16_t*)sample_data_ : nullptr; }
+
+    /** Raw quantized sample data of SampleFormat::u16 action. nullptr, if the format is different */
+    uint16_t* getU16Samples() const { return format_ == SampleFormat::u16 ? (uint16_t*)sample_data_ : nullptr; }
+
+    /** Write float samples starting from the offset, quantizing them if the format is 16-bit */
+    void writeSamples(unsigned offset, const float* samples, unsigned count);
+
+    /** Complete the action. Encrypts it in place, if the session uses encryption
+     *
+     * @return false, if the writer wasn't active
+     */
+    bool finish();
+
+    bool         isActive() const { return builder_ != nullptr; }
+    unsigned     getSampleCount() const { return sample_count_; }
+    SampleFormat getSampleFormat() const { return format_; }
+
+private:
+    ActionBuilder* builder_      = nullptr;
+    uint8_t*       payload_      = nullptr;
+    uint8_t*       sample_data_  = nullptr;
+    unsigned       sample_count_ = 0;
+
+    /** Size of the encrypted sample data with padding. 0, if the action isn't encrypted */
+    uint32_t     padded_size_    = 0;
+    SampleFormat format_         = SampleFormat::f32;
+    float        gain_           = 1.0f;
+};
+
 /** Handle to a single effect pipeline
  */
 class FfbPipeline {
@@ -130,6 +229,21 @@ public:
      */
     bool configure(const PipelineConfig& config);
 
+    /** Configure pipeline without waiting for the result
+     *
+     * Multiple pipelines can be configured at the same time, so that configuring all pipelines after a reconnect
+     * takes one command round trip instead of one per pipeline. Pipeline is inactive until the configuration
+     * completes, after which generateEffect starts to work with the new configuration.
+     *
+     * Must not be called while another configure or remove of this pipeline is in progress.
+     *
+     * @param result_cb Optional callback that is called with the command result after the pipeline state has been
+     *                  updated. Called from the thread that runs the session, see Session::asyncCommand
+     * @return true, if configuration command was sent and the callback will be called
+     */
+    bool asyncConfigure(const PipelineConfig&                          config,
+                        std::function<void(const AsyncCommandResult&)> result_cb = nullptr);
+
     /** Send new sample set to the configured pipeline
      *
      * Consecutive sample set timestamps must always be increasing.
@@ -149,6 +263,49 @@ public:
     bool generateEffect(Clock::time_point start_timestamp, Clock::duration sample_time, const float* samples,
                         unsigned sample_count);
 
+    /** Build new sample set and queue it to the batch instead of sending it immediately
+     *
+     * Same as generateEffect above, but samples are sent when ActionBatch::flush is called.
+     *
+     * @return true, if the samples were queued to the batch
+     *         false, if pipeline configuration hasn't completed yet or is invalid
+     */
+    bool generateEffect(ActionBatch& batch, Clock::time_point start_timestamp, Clock::duration sample_time,
+                        const float* samples, unsigned sample_count);
+
+    /** Send samples that start as soon as they can safely reach the device
+     *
+     * Start timestamp is the current time plus the lead time chosen by the lead time controller. If the samples end
+     * before the controller's effect duration, the last sample is repeated so that the effect lasts until the next
+     * call is expected to arrive. Duration of each send is measured and fed back to the controller.
+     *
+     * @return false, if lead time control isn't enabled, pipeline configuration hasn't completed yet or sending
+     *         failed
+     */
+    bool generateEffectNow(Clock::duration sample_time, const float* samples, unsigned sample_count);
+
+    /** Enable lead time controller that is used by generateEffectNow */
+    void enableLeadTimeControl(const LeadTimeConfig& config = LeadTimeConfig());
+    void disableLeadTimeControl();
+
+    /** @return nullptr, if lead time control isn't enabled */
+    LeadTimeController* getLeadTimeController() const { return lead_time_.get(); }
+
+    /** Start effect whose samples are written directly to the action buffer
+     *
+     * Writer uses the pipeline's sample format and gain. Write all samples and send the effect with sendEffect.
+     *
+     * @return false, if pipeline configuration hasn't completed yet or is invalid
+     */
+    bool beginEffect(EffectSampleWriter& writer, Clock::time_point start_timestamp, Clock::duration sample_time,
+                     unsigned sample_count);
+
+    /** Finish effect started with beginEffect and send it
+     *
+     * @return true, if the samples were sent to the API backend
+     */
+    bool sendEffect(EffectSampleWriter& writer);
+
     /** Will immediately stop currently active effect and clear all buffered samples, but won't clear pipeline
      * configuration */
     bool stop();
@@ -163,13 +320,22 @@ public:
      */
     bool remove();
 
+    /** Remove pipeline without waiting for the result
+     *
+     * Pipeline is inactive immediately. If the removal fails, previous configuration is restored.
+     *
+     * @see asyncConfigure
+     */
+    bool asyncRemove(std::function<void(const AsyncCommandResult&)> result_cb = nullptr);
+
     /**
      * Get id of the pipeline configured to device
-     * @return pipeline id
+     * @return pipeline id, or -1 if the pipeline isn't configured or configuration is in progress
      */
-    int8_t getPipelineId() { return pipeline_id_; }
+    int8_t getPipelineId() const { return state_->pipeline_id.load(std::memory_order_acquire); }
 
-    PipelineConfig getConfig() { return config_; }
+    /** Configuration of the pipeline. Should not be called while asynchronous configuration is in progress */
+    PipelineConfig getConfig() const { return *loadConfig(); }
 
     /** Get DeviceSessionId of the device this EffectPipelineHandle is assigned for
      */
@@ -178,11 +344,114 @@ public:
     std::shared_ptr<Session> getSession() const { return action_builder_.getSession(); }
 
 private:
+    /** Pipeline state that is shared with the asynchronous command callbacks, because they may be called after the
+     * handle has been destroyed */
+    struct State {
+        std::atomic<int8_t> pipeline_id{-1};
+
+        /** Handle was destroyed. Pipeline configured by a late result is freed */
+        std::atomic<bool> released{false};
+
+        /** Replaced as a whole with std::atomic_store, so effects are built from a consistent configuration while
+         * another thread configures the pipeline */
+        std::shared_ptr<const PipelineConfig> config = std::make_shared<const PipelineConfig>();
+    };
+
+    std::shared_ptr<const PipelineConfig> loadConfig() const { return std::atomic_load(&state_->config); }
+
+    void storeConfig(std::shared_ptr<const PipelineConfig> config) {
+        std::atomic_store(&state_->config, std::move(config));
+    }
+
+    /** Free pipeline that was configured or restored by an asynchronous result after the handle was destroyed */
+    static void freeIfReleased(State& state, const std::weak_ptr<Session>& weak_session, DeviceSessionId device);
+
     ActionBuilder action_builder_;
 
-    DeviceSessionId device_      = k_invalid_device_session_id;
-    int8_t          pipeline_id_ = -1;
-    PipelineConfig  config_;
+    DeviceSessionId        device_ = k_invalid_device_session_id;
+    std::shared_ptr<State> state_;
+
+    std::unique_ptr<LeadTimeController> lead_time_;
+};
+
+/** Submits effects of multiple pipelines together
+ *
+ * Effect actions of all pipelines in the group are built to one shared buffer and sent with a single send call, so
+ * that a rig with a wheelbase and multiple pedals sends one datagram per tick instead of one per pipeline. Actions are
+ * split to multiple datagrams only if they don't fit to the session's packet size limit.
+ *
+ * Group doesn't own the pipelines and they must outlive the group. All pipelines must belong to the same session as
+ * the group. Not thread-safe.
+ */
+class FfbPipelineGroup {
+public:
+    explicit FfbPipelineGroup(const std::shared_ptr<Session>& session);
+
+    FfbPipelineGroup(const FfbPipelineGroup&)            = delete;
+    FfbPipelineGroup& operator=(const FfbPipelineGroup&) = delete;
+
+    /** Add pipeline to the group
+     *
+     * @return Index of the pipeline in the group, used for the sample buffer order in generateEffects
+     */
+    unsigned addPipeline(FfbPipeline& pipeline);
+
+    /** Remove all pipelines and drop the effects that haven't been sent */
+    void clear();
+
+    std::size_t getPipelineCount() const { return pipelines_.size(); }
+
+    /** Build effect of a single pipeline to the current frame
+     *
+     * Pipeline doesn't have to be added to the group. Same rules apply as with FfbPipeline::generateEffect.
+     *
+     * @return false, if pipeline configuration hasn't completed yet or building failed
+     */
+    bool addEffect(FfbPipeline& pipeline, Clock::time_point start_timestamp, Clock::duration sample_time,
+                   const float* samples, unsigned sample_count);
+
+    /** Start effect of a single pipeline in the current frame with samples written directly to the frame buffer
+     *
+     * Writer must be finished with EffectSampleWriter::finish before the next effect is started or the frame is sent.
+     *
+     * @see EffectSampleWriter
+     */
+    bool beginEffect(EffectSampleWriter& writer, FfbPipeline& pipeline, Clock::time_point start_timestamp,
+                     Clock::duration sample_time, unsigned sample_count);
+
+    /** Build effects of all pipelines in the group to the current frame with the same timing
+     *
+     * @param samples Array of getPipelineCount() sample buffers in the order pipelines were added. Each buffer has
+     *                sample_count samples. nullptr buffer skips the pipeline
+     * @return Number of effects built. Pipelines that aren't configured are skipped
+     */
+    unsigned generateEffects(Clock::time_point start_timestamp, Clock::duration sample_time,
+                             const float* const* samples, unsigned sample_count);
+
+    /** Number of effects built to the current frame */
+    unsigned getEffectCount() const { return effect_count_; }
+
+    /** Send all built effects without blocking
+     *
+     * Frame is cleared unless the result is ActionResult::would_block, in which case the remaining datagrams can be
+     * retried with another send call or dropped with discardFrame.
+     *
+     * @returns ActionResult::complete, if all effects were sent or there was nothing to send
+     *          ActionResult::failed, if sending failed
+     *          ActionResult::would_block, if socket send buffer was full
+     */
+    ActionResult send();
+
+    /** Move built effects to the batch instead of sending them immediately */
+    bool send(ActionBatch& batch);
+
+    /** Drop effects built to the current frame */
+    void discardFrame();
+
+private:
+    ActionBuilder             action_builder_;
+    std::vector<FfbPipeline*> pipelines_;
+    unsigned                  effect_count_ = 0;
 };
 
 }  // namespace sc_api::core
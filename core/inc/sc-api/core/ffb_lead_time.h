@@ -0,0 +1,136 @@
+/**
+ * @file
+ * @brief Automatic selection of the effect start time lead
+ *
+ */
+
+#ifndef SC_API_CORE_FFB_LEAD_TIME_H_
+#define SC_API_CORE_FFB_LEAD_TIME_H_
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "time.h"
+
+namespace sc_api::core {
+
+/** Settings of LeadTimeController */
+struct LeadTimeConfig {
+    Clock::duration min_lead_time     = std::chrono::microseconds(500);
+    Clock::duration max_lead_time     = std::chrono::milliseconds(20);
+
+    /** Lead time and effect duration that are used until enough sends have been measured */
+    Clock::duration initial_lead_time = std::chrono::milliseconds(4);
+
+    /** Added to the measured send latency to cover transport from the API backend to the device, which can't be
+     * measured from the client */
+    Clock::duration transport_margin  = std::chrono::milliseconds(1);
+
+    /** Added to the measured interval between sends when choosing how long each effect should last */
+    Clock::duration min_overlap       = std::chrono::milliseconds(1);
+
+    /** Portion of the measured sends that the lead time and the effect duration should cover */
+    double percentile                 = 0.99;
+
+    /** Number of latest sends that are used for the estimates */
+    unsigned window_size              = 512;
+
+    /** Estimates are updated after this many sends */
+    unsigned update_interval          = 32;
+};
+
+/** Snapshot of LeadTimeController state */
+struct LeadTimeStats {
+    Clock::duration lead_time;
+
+    /** How long each effect should last so that the next effect starts before it ends */
+    Clock::duration effect_duration;
+
+    /** Send latency at the configured percentile */
+    Clock::duration send_latency;
+
+    /** Longest measured send latency */
+    Clock::duration max_send_latency;
+
+    uint64_t sends         = 0;
+
+    /** Sends that completed so late that the effect start time was closer than transport_margin */
+    uint64_t misses        = 0;
+
+    /** Sends that would have blocked or failed */
+    uint64_t send_failures = 0;
+};
+
+/** Chooses the smallest effect start time lead that covers the measured send path jitter
+ *
+ * Each send is recorded with the time the caller sampled the current time, the start time given to the effect and
+ * the time sending completed. Lead time follows the configured percentile of the measured latencies plus the
+ * transport margin. It grows immediately when latencies increase or a send misses, but shrinks gradually so that
+ * occasional quiet periods don't cause misses.
+ *
+ * Protocol doesn't acknowledge effect actions, so latency is measured until the datagram is passed to the socket or to
+ * the sender thread. Transport margin covers the rest.
+ *
+ * record* functions must be called from a single thread. Getters can be called from any thread.
+ */
+class LeadTimeController {
+public:
+    explicit LeadTimeController(const LeadTimeConfig& config = LeadTimeConfig());
+
+    Clock::duration getLeadTime() const { return Clock::duration(lead_time_ns_.load(std::memory_order_relaxed)); }
+
+    Clock::duration getEffectDuration() const {
+        return Clock::duration(effect_duration_ns_.load(std::memory_order_relaxed));
+    }
+
+    /** Start timestamp for an effect generated at now */
+    Clock::time_point getStartTimestamp(Clock::time_point now) const { return now + getLeadTime(); }
+
+    /** Record completed send
+     *
+     * @param now Current time that was used for choosing the start timestamp
+     * @param start_timestamp Start timestamp of the sent effect
+     * @param send_done Time when sending completed
+     */
+    void recordSend(Clock::time_point now, Clock::time_point start_timestamp, Clock::time_point send_done);
+
+    /** Record send that would have blocked or failed */
+    void recordSendFailure();
+
+    LeadTimeStats getStats() const;
+
+    /** Forget all measurements and return to the initial lead time */
+    void reset();
+
+    const LeadTimeConfig& getConfig() const { return config_; }
+
+private:
+    void updateEstimates();
+
+    /** Value at the configured percentile. Reorders values */
+    int64_t percentile(std::vector<int64_t>& values) const;
+
+    LeadTimeConfig config_;
+
+    // Ring buffers of the latest measurements in nanoseconds
+    std::vector<int64_t> latencies_;
+    std::vector<int64_t> intervals_;
+    std::vector<int64_t> scratch_;
+    unsigned             latency_idx_  = 0;
+    unsigned             interval_idx_ = 0;
+    unsigned             since_update_ = 0;
+    Clock::time_point    previous_send_;
+    bool                 has_previous_ = false;
+
+    std::atomic<int64_t>  lead_time_ns_;
+    std::atomic<int64_t>  effect_duration_ns_;
+    std::atomic<int64_t>  latency_ns_{0};
+    std::atomic<int64_t>  max_latency_ns_{0};
+    std::atomic<uint64_t> sends_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> send_failures_{0};
+};
+
+}  // namespace sc_api::core
+
+#endif  // SC_API_CORE_FFB_LEAD_TIME_H_
@@ -0,0 +1,98 @@
+/**
+ * @file
+ * @brief Mixing of multiple effect sources to a single effect pipeline
+ *
+ */
+
+#ifndef SC_API_CORE_FFB_MIXER_H_
+#define SC_API_CORE_FFB_MIXER_H_
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "ffb.h"
+
+namespace sc_api::core {
+
+/** Renders count samples of an effect to out. Previous contents of out are undefined and must be overwritten */
+using EffectSource = std::function<void(float* out, unsigned count)>;
+
+/** Sums many logical effects to one effect pipeline
+ *
+ * Each configured pipeline uses one of the limited pipeline slots of the device and sends its own effect actions, so
+ * running a separate pipeline for every game effect (engine, ABS, kerbs, collisions...) doesn't scale. Mixer renders
+ * all registered sources, applies per source gain and limit, sums them and sends the result as one sample stream.
+ *
+ * All sources share the offset type, sample format and sample time of the pipeline.
+ *
+ * Not thread-safe. Sources are called from the thread that renders the mixer.
+ */
+class FfbMixer {
+public:
+    using SourceId = uint32_t;
+
+    static constexpr SourceId k_invalid_source_id = 0;
+
+    /** Pipeline must outlive the mixer */
+    explicit FfbMixer(FfbPipeline& pipeline);
+
+    /** Register effect source
+     *
+     * @param gain Multiplier applied to the source samples
+     * @param limit Source samples are clamped to range [-limit, limit] before the gain is applied
+     * @return Id of the source
+     */
+    SourceId addSource(EffectSource source, float gain = 1.0f,
+                       float limit = std::numeric_limits<float>::infinity());
+
+    /** @return false, if there was no source with the id */
+    bool removeSource(SourceId id);
+
+    /** Source with zero gain is still rendered, so that a stateful source continues from the right point when the
+     * gain is raised again */
+    bool setSourceGain(SourceId id, float gain);
+    bool setSourceLimit(SourceId id, float limit);
+
+    /** Disabled sources aren't rendered at all, so their state pauses until they are enabled again */
+    bool setSourceEnabled(SourceId id, bool enabled);
+
+    std::size_t getSourceCount() const { return sources_.size(); }
+
+    /** Clamp the summed output to range [lo, hi] */
+    void setOutputLimits(float lo, float hi);
+
+    /** Render count samples of all enabled sources summed together to out */
+    void render(float* out, unsigned count);
+
+    /** Render sample_count samples and send them as one effect to the pipeline
+     *
+     * With SampleFormat::f32 samples are mixed directly to the effect action buffer.
+     *
+     * @return false, if pipeline configuration hasn't completed yet or sending failed
+     */
+    bool generateEffect(Clock::time_point start_timestamp, Clock::duration sample_time, unsigned sample_count);
+
+    FfbPipeline& getPipeline() const { return pipeline_; }
+
+private:
+    struct Source {
+        SourceId     id;
+        EffectSource render;
+        float        gain;
+        float        limit;
+        bool         enabled;
+    };
+
+    Source* findSource(SourceId id);
+
+    FfbPipeline&        pipeline_;
+    std::vector<Source> sources_;
+    SourceId            next_id_   = 1;
+    float               output_lo_ = -std::numeric_limits<float>::infinity();
+    float               output_hi_ = std::numeric_limits<float>::infinity();
+};
+
+}  // namespace sc_api::core
+
+#endif  // SC_API_CORE_FFB_MIXER_H_
@@ -0,0 +1,209 @@
+/**
+ * @file
+ * @brief Recording and replaying of effect action streams
+ *
+ */
+
+#ifndef SC_API_CORE_FFB_RECORDER_H_
+#define SC_API_CORE_FFB_RECORDER_H_
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "action.h"
+#include "ffb.h"
+#include "protocol/actions.h"
+#include "time.h"
+
+namespace sc_api::core {
+
+namespace internal {
+class MappedFile;
+}
+
+/** Records effect actions to an append-only memory mapped file
+ *
+ * File starts with a header that is followed by one record per action. Each record holds the Clock timestamp when the
+ * action was built, the action id and the plaintext action payload. File is grown in large steps by remapping, so
+ * recording an action is normally a single copy. Header is updated after every record, so a file left behind by a
+ * crashed process can be replayed up to the last complete record.
+ *
+ * Attach the recorder to a session with Session::setEffectRecorder to record all effects built for the session.
+ *
+ * Thread-safe.
+ */
+class EffectRecorder {
+public:
+    EffectRecorder();
+    ~EffectRecorder();
+
+    EffectRecorder(const EffectRecorder&)            = delete;
+    EffectRecorder& operator=(const EffectRecorder&) = delete;
+
+    /** Create or truncate the file
+     *
+     * @param initial_size Bytes reserved for the file up front. File grows by doubling when it is full
+     */
+    bool open(const char* path, std::size_t initial_size = 1024 * 1024);
+
+    /** Truncate the file to the recorded size and close it */
+    void close();
+
+    bool isOpen() const;
+
+    /** Append action payload to the file with the current time as the timestamp
+     *
+     * Called by the library for every built effect action of the session the recorder is attached to.
+     *
+     * @return false, if the recorder isn't open or the file couldn't be grown
+     */
+    bool record(SC_API_PROTOCOL_Action_t action_id, const uint8_t* payload, std::size_t payload_size);
+
+    bool record(Clock::time_point timestamp, SC_API_PROTOCOL_Action_t action_id, const uint8_t* payload,
+                std::size_t payload_size);
+
+    uint64_t getRecordCount() const;
+
+    /** Actions that couldn't be recorded because the file couldn't be grown */
+    uint64_t getDroppedCount() const;
+
+    /** Size of the file contents in bytes, including the header */
+    std::size_t getSize() const;
+
+private:
+    bool reserve(std::size_t size);
+
+    mutable std::mutex                    mutex_;
+    std::unique_ptr<internal::MappedFile> file_;
+    std::size_t                           used_    = 0;
+    uint64_t                              records_ = 0;
+    uint64_t                              dropped_ = 0;
+};
+
+/** Replays effect actions recorded with EffectRecorder
+ *
+ * Records are sent at their recorded intervals scaled by time scale, relative to the replay start time. Effect start
+ * timestamps and sample durations are shifted and scaled the same way, so the device plays the effects with the same
+ * timing relative to their arrival as in the recording. Effects are built again through ActionBuilder, so they are
+ * encrypted if the replaying session uses encryption.
+ *
+ * Recorded pipeline ids are only valid in the recorded session, so recorded pipelines are usually mapped to pipelines
+ * configured for replaying with mapPipeline. Without any mappings, effects are sent to the recorded device and pipeline
+ * ids.
+ *
+ *     EffectReplayer replayer(session);
+ *     replayer.open("effects.bin");
+ *     for (EffectPipelineRef ref : replayer.getRecordedPipelines()) replayer.mapPipeline(ref, pipeline);
+ *     replayer.start();
+ *     while (!replayer.isFinished()) {
+ *         std::this_thread::sleep_until(...replayer.getNextSendTime()...);
+ *         replayer.sendDue();
+ *     }
+ *
+ * Not thread-safe.
+ */
+class EffectReplayer {
+public:
+    explicit EffectReplayer(const std::shared_ptr<Session>& session);
+    ~EffectReplayer();
+
+    EffectReplayer(const EffectReplayer&)            = delete;
+    EffectReplayer& operator=(const EffectReplayer&) = delete;
+
+    /** Open recording and index its records
+     *
+     * @return false, if the file couldn't be opened or isn't a valid recording
+     */
+    bool open(const char* path);
+    void close();
+
+    std::size_t getRecordCount() const { return records_.size(); }
+
+    /** Time from the first to the last record of the recording */
+    Clock::duration getRecordedDuration() const;
+
+    /** Pipelines that have recorded effect or effect clear actions, in the order they first appear */
+    std::vector<EffectPipelineRef> getRecordedPipelines() const;
+
+    /** Send effects that were recorded for the recorded pipeline to the target pipeline
+     *
+     * Target pipeline id is read when effects are sent, so it can be configured after mapping. Effects of a target that
+     * isn't configured are skipped. Target must outlive the replayer or the mapping.
+     */
+    void mapPipeline(EffectPipelineRef recorded, FfbPipeline& target);
+    void clearPipelineMappings();
+
+    /** Rewind to the first record
+     *
+     * @param time_scale Multiplier for the recorded intervals. 1.0 replays in the original timing, 2.0 at half speed
+     */
+    void start(Clock::time_point start_time = Clock::now(), double time_scale = 1.0);
+
+    /** Send all records whose replay time has been reached in as few datagrams as possible
+     *
+     * @return Number of records that were sent
+     */
+    unsigned sendDue(Clock::time_point now = Clock::now());
+
+    /** Send the next record immediately, with the effect timing relative to now
+     *
+     * Useful for benchmarking the send path with recorded traffic.
+     *
+     * @return false, if replay has finished or sending failed
+     */
+    bool sendNext();
+
+    /** Replay time of the next record. Only valid if replay hasn't finished */
+    Clock::time_point getNextSendTime() const { return toReplayTime(recordTimestamp(next_)); }
+
+    bool isFinished() const { return next_ >= records_.size(); }
+
+    /** Records that couldn't be sent, because the send failed or the mapped pipeline wasn't configured */
+    uint64_t getSendFailures() const { return send_failures_; }
+
+private:
+    struct Mapping {
+        EffectPipelineRef recorded;
+        FfbPipeline*      target;
+    };
+
+    enum class BuildResult {
+        built,
+
+        /** Record isn't an effect action or its pipeline isn't mapped */
+        skipped,
+        failed,
+
+        /** Action was left half built, so the builder was reset and records built before it were dropped too */
+        discarded,
+    };
+
+    int64_t           recordTimestamp(std::size_t idx) const;
+    Clock::time_point toReplayTime(int64_t recorded_ns) const;
+
+    /** Build record to the builder */
+    BuildResult buildRecord(std::size_t idx);
+
+    /** Replace recorded pipeline with the mapped target pipeline
+     *
+     * @return BuildResult::skipped, if the pipeline isn't mapped and BuildResult::failed, if target isn't configured
+     */
+    BuildResult resolvePipeline(EffectPipelineRef& ref) const;
+
+    ActionBuilder                         builder_;
+    std::unique_ptr<internal::MappedFile> file_;
+
+    /** Offsets of the records in the file */
+    std::vector<std::size_t> records_;
+    std::vector<Mapping>     mappings_;
+    std::size_t              next_          = 0;
+    int64_t                  first_ns_      = 0;
+    Clock::time_point        start_time_;
+    double                   time_scale_    = 1.0;
+    uint64_t                 send_failures_ = 0;
+};
+
+}  // namespace sc_api::core
+
+#endif  // SC_API_CORE_FFB_RECORDER_H_
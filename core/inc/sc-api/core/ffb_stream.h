@@ -0,0 +1,144 @@
+/**
+ * @file
+ * @brief Streaming of continuous effect signals to an effect pipeline
+ *
+ */
+
+#ifndef SC_API_CORE_FFB_STREAM_H_
+#define SC_API_CORE_FFB_STREAM_H_
+#include <atomic>
+#include <memory>
+
+#include "ffb.h"
+#include "session.h"
+
+namespace sc_api::core {
+
+/** Settings of FfbStream */
+struct FfbStreamConfig {
+    /** Duration of each pushed sample */
+    Clock::duration sample_time = std::chrono::milliseconds(1);
+
+    /** How far ahead of the current time queued samples are sent
+     *
+     * Samples further in the future stay in the queue, so that multiple small pushes are combined to fuller effect
+     * actions. Longer lookahead means fewer datagrams, but also that more samples are already on the device if the
+     * signal has to change suddenly.
+     */
+    Clock::duration lookahead   = std::chrono::milliseconds(20);
+
+    /** Samples are sent at the latest when their start time is this close to the current time
+     *
+     * Must cover the time it takes for the effect to reach the device. Start of the signal, and the signal after the
+     * queue has run empty, is scheduled this far from the current time.
+     */
+    Clock::duration lead_time   = std::chrono::milliseconds(3);
+
+    /** Maximum number of samples in one effect action
+     *
+     * 0 picks the largest count that fits to a single datagram, at most
+     * SC_API_PROTOCOL_COMMAND_EFFECT_MAX_SAMPLE_COUNT.
+     */
+    unsigned max_chunk_samples  = 0;
+
+    /** Number of samples the queue can hold. Rounded up to the next power of two */
+    unsigned queue_capacity     = 4096;
+};
+
+/** Continuous sample stream to an effect pipeline
+ *
+ * Application pushes samples at its own cadence and the stream takes care of splitting them to effect actions with
+ * consecutive start timestamps. Signals can be of any length, so for example road texture or engine vibration can be
+ * generated in blocks that are convenient for the application without timestamp bookkeeping.
+ *
+ * push() and service() may be called from different threads without locking: samples are passed through a single
+ * producer single consumer queue. Only one thread may push and only one thread may service, either by calling
+ * service() directly or by running the timer started with startTimer() in the session's event loop.
+ *
+ * The pipeline must be configured before samples are serviced and it must outlive the stream. Pipeline sample format
+ * and gain are read when each action is built.
+ */
+class FfbStream {
+public:
+    explicit FfbStream(FfbPipeline& pipeline, const FfbStreamConfig& config = FfbStreamConfig());
+    ~FfbStream();
+
+    FfbStream(const FfbStream&)            = delete;
+    FfbStream& operator=(const FfbStream&) = delete;
+
+    /** Queue samples to the end of the stream
+     *
+     * Thread-safe with service(), but only one thread may push.
+     *
+     * @return Number of queued samples. Less than count if the queue is full
+     */
+    unsigned push(const float* samples, unsigned count);
+
+    /** Send queued samples whose start time is within the lookahead
+     *
+     * Samples are held back until a full action can be sent, or until the first held sample is within lead_time from
+     * now. If the queue runs empty and the stream falls behind the current time, the stream restarts lead_time from
+     * now and the event is counted as an underrun.
+     *
+     * @param now Current time
+     * @return false, if sending failed or the pipeline isn't configured
+     */
+    bool service(Clock::time_point now = Clock::now());
+
+    /** Call service() periodically from the session's event loop
+     *
+     * Timer callbacks run in the thread that runs the session (Session::runUntilStateChanges or Api thread), so no
+     * other thread may call service() while the timer is running.
+     */
+    void startTimer(std::chrono::milliseconds period);
+
+    /** Stop the timer. Waits for a service() call that is running in the event loop thread */
+    void stopTimer();
+
+    /** Drop all queued samples and restart the stream timeline
+     *
+     * Not thread-safe: push() and service() must not be running at the same time.
+     */
+    void reset();
+
+    /** Number of samples that are queued but not yet sent */
+    unsigned getQueuedSampleCount() const;
+
+    /** Number of times the stream ran empty and had to restart */
+    uint64_t getUnderrunCount() const { return underruns_.load(std::memory_order_relaxed); }
+
+    /** Number of effect actions sent */
+    uint64_t getSentChunkCount() const { return sent_chunks_.load(std::memory_order_relaxed); }
+
+    const FfbStreamConfig& getConfig() const { return config_; }
+
+private:
+    /** Largest number of samples that fits to one datagram with the current pipeline and session settings */
+    unsigned maxChunkSamples();
+
+    FfbPipeline&    pipeline_;
+    FfbStreamConfig config_;
+    ActionBuilder   builder_;
+
+    std::unique_ptr<float[]> queue_;
+    uint32_t                 mask_ = 0;
+
+    /** Written only by push() */
+    alignas(64) std::atomic<uint32_t> head_{0};
+    /** Written only by service() */
+    alignas(64) std::atomic<uint32_t> tail_{0};
+
+    // Accessed only by service()
+    Clock::time_point next_time_;
+    bool              has_timeline_ = false;
+    bool              send_pending_ = false;
+
+    std::atomic<uint64_t> underruns_{0};
+    std::atomic<uint64_t> sent_chunks_{0};
+
+    Session::PeriodicTimerHandle timer_;
+};
+
+}  // namespace sc_api::core
+
+#endif  // SC_API_CORE_FFB_STREAM_H_
@@ -0,0 +1,193 @@
+/**
+ * @file
+ * @brief Generators for rendering common force feedback effect signals
+ *
+ */
+
+#ifndef SC_API_CORE_FFB_SYNTHESIS_H_
+#define SC_API_CORE_FFB_SYNTHESIS_H_
+#include <cstdint>
+
+#include "time.h"
+
+namespace sc_api::core::synthesis {
+
+/** Shape of a periodic signal. All shapes are generated between offset - amplitude and offset + amplitude, except
+ * pulse and bump, which are between offset and offset + amplitude */
+enum class Waveform {
+    sine,
+
+    /** Amplitude for duty cycle portion of the period, -amplitude for the rest */
+    square,
+
+    triangle,
+
+    /** Rises from -amplitude to amplitude over the period */
+    sawtooth,
+
+    /** Amplitude for duty cycle portion of the period and zero for the rest. For example ABS pulses */
+    pulse,
+
+    /** Positive half sine over duty cycle portion of the period and zero for the rest. For example kerb bumps */
+    bump,
+};
+
+/** Periodic signal generator
+ *
+ * Phase continues from block to block, so consecutive render calls produce continuous signal also when the frequency
+ * is changed between blocks.
+ */
+class Oscillator {
+public:
+    explicit Oscillator(Waveform waveform = Waveform::sine, Clock::duration sample_time = std::chrono::milliseconds(1));
+
+    void setWaveform(Waveform waveform) { waveform_ = waveform; }
+    void setSampleTime(Clock::duration sample_time);
+    void setFrequency(float hz) { frequency_hz_ = hz; }
+    void setAmplitude(float amplitude) { amplitude_ = amplitude; }
+    void setOffset(float offset) { offset_ = offset; }
+
+    /** Portion of the period in range [0, 1] that square, pulse and bump waveforms are high */
+    void setDutyCycle(float duty_cycle);
+
+    /** Phase in turns, range [0, 1) */
+    void  setPhase(float phase);
+    float getPhase() const { return (float)phase_; }
+
+    float getFrequency() const { return frequency_hz_; }
+    float getAmplitude() const { return amplitude_; }
+
+    /** Write count samples to out */
+    void render(float* out, unsigned count);
+
+    /** Add count samples to the existing values in out */
+    void mix(float* out, unsigned count);
+
+private:
+    template <bool k_mix>
+    void generate(float* out, unsigned count);
+
+    template <Waveform k_waveform, bool k_mix>
+    static void generateWaveform(float* out, unsigned count, const Oscillator& osc, float phase_step);
+
+    Waveform waveform_;
+    double   sample_time_s_;
+    double   phase_        = 0.0;
+    float    frequency_hz_ = 1.0f;
+    float    amplitude_    = 1.0f;
+    float    offset_       = 0.0f;
+    float    duty_cycle_   = 0.5f;
+};
+
+/** Low-pass filtered white noise
+ *
+ * White noise is uniformly distributed in range [-amplitude, amplitude] and filtered with a first order low-pass
+ * filter. Filtering lowers the signal level, more the lower the cut-off frequency is.
+ */
+class NoiseGenerator {
+public:
+    explicit NoiseGenerator(uint32_t seed = 1, Clock::duration sample_time = std::chrono::milliseconds(1));
+
+    void setSampleTime(Clock::duration sample_time);
+    void setAmplitude(float amplitude) { amplitude_ = amplitude; }
+
+    /** Cut-off frequency of the low-pass filter. 0 or negative disables filtering */
+    void setCutoffFrequency(float hz);
+
+    void render(float* out, unsigned count);
+    void mix(float* out, unsigned count);
+
+private:
+    template <bool k_mix>
+    void generate(float* out, unsigned count);
+
+    /** Independent xorshift generators so that four values can be generated at once */
+    uint32_t state_[4];
+    double   sample_time_s_;
+    float    amplitude_ = 1.0f;
+    float    cutoff_hz_ = 0.0f;
+    float    alpha_     = 1.0f;
+    float    filtered_  = 0.0f;
+};
+
+/** Attack-sustain-release envelope that is used to fade effects in and out
+ *
+ * When gate is on, level rises linearly to 1 in attack time and stays there. When gate is off, level falls linearly
+ * to 0 in release time.
+ */
+class Envelope {
+public:
+    explicit Envelope(Clock::duration sample_time = std::chrono::milliseconds(1));
+
+    void setSampleTime(Clock::duration sample_time);
+    void setAttack(Clock::duration attack);
+    void setRelease(Clock::duration release);
+
+    void setGate(bool on) { gate_ = on; }
+    bool getGate() const { return gate_; }
+
+    float getLevel() const { return level_; }
+
+    /** Envelope has fully released and apply would only write zeros */
+    bool isIdle() const { return !gate_ && level_ <= 0.0f; }
+
+    /** Multiply count samples in inout by the envelope level */
+    void apply(float* inout, unsigned count);
+
+private:
+    void updateSteps();
+
+    double sample_time_s_;
+    double attack_s_     = 0.0;
+    double release_s_    = 0.0;
+    float  attack_step_  = 1.0f;
+    float  release_step_ = 1.0f;
+    float  level_        = 0.0f;
+    bool   gate_         = false;
+};
+
+/** Speed dependent bump pattern with rumble, for example for kerbs and rumble strips
+ *
+ * Bumps are spaced spacing_m apart, so their frequency follows the vehicle speed. Filtered noise with amplitude
+ * relative to the bump amplitude adds roughness. No signal is generated at zero speed.
+ */
+class KerbGenerator {
+public:
+    explicit KerbGenerator(Clock::duration sample_time = std::chrono::milliseconds(1));
+
+    void setSampleTime(Clock::duration sample_time);
+
+    /** Distance between the starts of two bumps */
+    void setSpacing(float spacing_m) { spacing_m_ = spacing_m; }
+
+    /** Portion of the spacing that is covered by a bump */
+    void setBumpWidth(float portion) { bumps_.setDutyCycle(portion); }
+
+    void setAmplitude(float amplitude);
+
+    /** Amount of noise relative to the amplitude */
+    void setRoughness(float roughness);
+
+    void setSpeed(float speed_m_s) { speed_m_s_ = speed_m_s; }
+
+    void render(float* out, unsigned count);
+    void mix(float* out, unsigned count);
+
+private:
+    Oscillator     bumps_;
+    NoiseGenerator rumble_;
+    float          spacing_m_ = 0.25f;
+    float          speed_m_s_ = 0.0f;
+    float          amplitude_ = 1.0f;
+    float          roughness_ = 0.2f;
+};
+
+/** Multiply count samples in inout by gain */
+void scale(float* inout, unsigned count, float gain);
+
+/** Clamp count samples in inout to range [lo, hi] */
+void clamp(float* inout, unsigned count, float lo, float hi);
+
+}  // namespace sc_api::core::synthesis
+
+#endif  // SC_API_CORE_FFB_SYNTHESIS_H_
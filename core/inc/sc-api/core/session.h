@@ -15,6 +15,7 @@
 #include <string>
 #include <vector>
 
+#include "action.h"
 #include "device_info_fwd.h"
 #include "protocol/security.h"
 #include "result.h"
@@ -32,6 +33,7 @@ class SimDataUpdateBuilder;
 }
 
 class FfbPipeline;
+class EffectRecorder;
 
 /** Different options for establishing secure session that are supported by the current version of the backend
  */
@@ -49,6 +51,26 @@ struct SecureSessionOptions {
     bool isValid() const { return !options.empty(); }
 };
 
+/** Settings for the dedicated action sender thread
+ *
+ * @see Session::startActionSender
+ */
+struct ActionSenderConfig {
+    /** CPU core that the sender thread is pinned to. Negative value leaves thread unpinned */
+    int cpu                              = -1;
+
+    /** Number of datagram slots in each producer queue. Rounded up to the next power of two */
+    uint32_t ring_slots                  = 64;
+
+    /** How long the sender thread sleeps when there was nothing to send
+     *
+     * Thread polls the queues, so a datagram that is queued while the thread sleeps waits up to this long before it is
+     * sent, on top of the scheduler's timer slack. Shorter sleep lowers that latency but uses more CPU, and 0 keeps
+     * the thread spinning on its core.
+     */
+    std::chrono::microseconds idle_sleep = std::chrono::microseconds(50);
+};
+
 enum class SecureSessionKeyExchangeResult {
     ok,
 
@@ -309,6 +331,7 @@ public:
         PeriodicTimerHandle() = default;
         ~PeriodicTimerHandle() { destroy(); }
         PeriodicTimerHandle(PeriodicTimerHandle&& h) noexcept {
+            std::swap(h.session_, session_);
             std::swap(h.handle_, handle_);
             h.destroy();
         }
@@ -319,11 +342,17 @@ public:
                 return *this;
             }
 
+            std::swap(h.session_, session_);
             std::swap(h.handle_, handle_);
             return *this;
         }
         PeriodicTimerHandle& operator=(const PeriodicTimerHandle&) = delete;
 
+        /** Stop the timer
+         *
+         * Callback isn't called after this returns. If the callback is running in another thread, this waits for it
+         * to return, so the callback must not wait for locks that the caller holds.
+         */
         void destroy() noexcept;
 
     private:
@@ -336,6 +365,57 @@ public:
 
     PeriodicTimerHandle createPeriodicTimer(std::chrono::milliseconds period, std::function<void()> callback);
 
+    /** Start dedicated thread that sends actions to the backend
+     *
+     * While the sender is running, ActionBuilder::sendNonBlocking and ActionBuilder::asyncSend only copy the built
+     * datagrams to a lock-free queue of the builder and the sender thread sends queued datagrams of all builders in
+     * batches. Producers never block or take a lock, except once per builder when its queue is created.
+     * ActionResult::complete then means that the datagrams were queued, and ActionResult::would_block that the
+     * queue is full. ActionBuilder::sendBlocking and ActionBatch::flush still send directly.
+     *
+     * Must not be called while other threads are sending actions.
+     *
+     * @return false, if the sender is already running
+     */
+    bool startActionSender(const ActionSenderConfig& config = ActionSenderConfig());
+
+    /** Stop the sender thread started by startActionSender
+     *
+     * Waits for producers that are queuing datagrams at the same time. Datagrams that were already queued are sent
+     * once more and the ones that still would block are reported as ActionResult::failed.
+     */
+    void stopActionSender();
+
+    /** Enable or disable collecting statistics of the action send path
+     *
+     * Collects build, encryption and socket send durations, send results and bytes per action id of all actions
+     * sent through this session. Statistics are disabled by default, because collecting them adds a few clock reads
+     * to every send. Counters keep their values while disabled.
+     *
+     * @note Thread-safe
+     */
+    void setActionStatsEnabled(bool enabled);
+
+    /** Snapshot of the action send statistics collected since enabling them or the last resetActionStats call
+     *
+     * @note Thread-safe
+     */
+    ActionStats getActionStats() const;
+
+    /** Reset action send statistics counters to zero */
+    void resetActionStats();
+
+    /** Record all effect actions built for this session
+     *
+     * Effect and effect clear actions are recorded before encryption when they are built, also if sending them fails
+     * later. nullptr stops recording.
+     *
+     * Must not be called while other threads are building effect actions.
+     */
+    void setEffectRecorder(std::shared_ptr<EffectRecorder> recorder);
+
+    std::shared_ptr<EffectRecorder> getEffectRecorder() const;
+
     Internal& getInternal() { return *p_; }
 
 private:
@@ -9,10 +9,12 @@
 #include <cstring>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "action.h"
 #include "events.h"
+#include "time.h"
 #include "type.h"
 
 namespace sc_api::core {
@@ -73,6 +75,15 @@ public:
     const std::string& getName() const { return name_; }
     Type               getType() const { return type_; }
 
+    /** Set how much the value must change from the last sent value before an update group with change tracking sends
+     * it again
+     *
+     * Changes of at most deadband are ignored. 0 sends every change. Ignored for boolean telemetries. Takes effect when
+     * the update group is configured.
+     */
+    void   setDeadband(double deadband) { deadband_ = deadband; }
+    double getDeadband() const { return deadband_; }
+
     virtual const uint8_t* getSerializedValueBuf() const  = 0;
     virtual std::size_t    getSerializedValueSize() const = 0;
 
@@ -82,6 +93,8 @@ protected:
 
     Type        type_;
 
+    double      deadband_ = 0.0;
+
     /** This is filled and used by TelemetryUpdateGroup when it finds matching telemetry */
     struct RefState {
         uint16_t id;
@@ -186,12 +199,70 @@ public:
      */
     bool configure(std::vector<TelemetryBase*> telemetries, const TelemetryDefinitions& definitions);
 
+    /** Same as configure, but the group is registered with ActionBuilder::sendNonBlocking
+     *
+     * configure waits for the register action to be sent, which deadlocks in the session's event loop thread when
+     * the socket send buffer is full. This can be called from Session::createPeriodicTimer callbacks instead.
+     *
+     * @return ActionResult::would_block, if the registration couldn't be sent now. Call again to retry
+     */
+    ActionResult configureNonBlocking(const TelemetryDefinitions& definitions);
+
     /** Send all currently configured telemetries to the API backend
      *
      * configure must have completed successfully before this can succeed
+     *
+     * @return ActionResult::complete also when change tracking skipped the update
      */
     ActionResult send();
 
+    /** Build value update of all currently configured telemetries and queue it to the batch
+     *
+     * Values are read during this call, but they are sent when ActionBatch::flush is called.
+     *
+     * With change tracking the update counts as sent once it is queued. If the flush fails, call markChanged() so that
+     * the next update isn't skipped.
+     *
+     * @return true, if the update was queued to the batch or change tracking skipped it
+     */
+    bool send(ActionBatch& batch);
+
+    /** Build value update of all currently configured telemetries to the given builder
+     *
+     * Allows packing telemetry values together with other actions, for example effect data, so that they are sent
+     * in the same datagram.
+     *
+     * With change tracking the update counts as sent once it is built. If sending the builder fails, call
+     * markChanged() so that the next update isn't skipped.
+     *
+     * @return true, if the update action was added to the builder. false also when change tracking skipped the update,
+     *         which wasSkipped() tells apart from a failure
+     */
+    bool build(ActionBuilder& builder);
+
+    /** Only send updates when some value has changed
+     *
+     * Updates are skipped while all values are within their deadbands from the last sent update, see
+     * TelemetryBase::setDeadband. Update is still sent at least once per keep_alive, so that values are eventually
+     * refreshed also if an update datagram was lost.
+     */
+    void enableChangeTracking(Clock::duration keep_alive = std::chrono::seconds(1));
+    void disableChangeTracking();
+    bool isChangeTrackingEnabled() const { return change_tracking_; }
+
+    /** Send the next update even if nothing has changed
+     *
+     * Needed after an update from send(ActionBatch&) or build() failed to send, because this group doesn't see the
+     * result.
+     */
+    void markChanged() { has_sent_ = false; }
+
+    /** Number of updates that change tracking has skipped */
+    uint64_t getSkippedUpdateCount() const { return skipped_updates_; }
+
+    /** True, if change tracking skipped the latest update of send() or build() */
+    bool wasSkipped() const { return last_skipped_; }
+
     /** Get list of telemetries that have been added to this group
      *
      * Order of telemetries is undefined and can change when new telemetries are added or configure is called.
@@ -206,15 +277,77 @@ public:
      */
     ActionResult disable();
 
+    /** Same as disable, but doesn't wait when the socket send buffer is full. See configureNonBlocking
+     *
+     * @return ActionResult::would_block, if the action couldn't be sent now. Call again to retry
+     */
+    ActionResult disableNonBlocking();
+
 private:
+    enum class BuildResult {
+        built,
+        unchanged,
+        failed,
+    };
+
+    /** Value that is compared with a deadband by change tracking */
+    struct DeadbandCheck {
+        uint16_t       offset;
+        Type::BaseType type;
+        double         deadband;
+    };
+
+    /** Payload range that change tracking compares exactly */
+    struct PayloadRange {
+        uint16_t offset;
+        uint16_t size;
+    };
+
+    /** Resolve the telemetries and build the register action to action_builder_ */
+    bool buildRegistration(const TelemetryDefinitions& definitions);
+
+    /** Build register action of an empty group to action_builder_ */
+    bool buildDisable();
+
+    BuildResult buildUpdate(ActionBuilder& builder);
+
+    /** Write set telemetry group payload of set_payload_size_ bytes */
+    void packPayload(uint8_t* payload) const;
+
+    bool hasChanged(const uint8_t* payload) const;
+
+    /** Values of the same size whose serialized buffers follow each other in memory, so they are copied at once */
+    struct PackSegment {
+        const uint8_t* src;
+        uint32_t       count;
+    };
+
     std::vector<TelemetryBase*> telemetries_;
-    std::vector<const uint8_t*> base_value_bufs_;
+
+    // Packing plan compiled by configure: boolean value buffers in bit order and segments of the other values in
+    // payload order, grouped by value size from 8 to 1 bytes
+    std::vector<const uint8_t*> bool_bufs_;
+    std::vector<PackSegment>    value_segments_;
+    uint16_t                    segments_by_size_[4] = {};
+
     ActionBuilder               action_builder_;
     uint16_t                    base_value_entries_by_size_[5];
     uint16_t                    set_payload_size_ = 0;
     uint16_t                    group_id_         = 0;
     bool                        prepared_         = false;
     bool                        enabled_          = false;
+
+    // Change tracking state. Payloads are set_payload_size_ bytes after configure
+    std::vector<uint8_t>       packed_payload_;
+    std::vector<uint8_t>       sent_payload_;
+    std::vector<DeadbandCheck> deadband_checks_;
+    std::vector<PayloadRange>  exact_ranges_;
+    Clock::duration            keep_alive_{0};
+    Clock::time_point          last_sent_time_;
+    uint64_t                   skipped_updates_ = 0;
+    bool                       change_tracking_ = false;
+    bool                       has_sent_        = false;
+    bool                       last_skipped_    = false;
 };
 
 /** List of all available telemetries
@@ -256,7 +389,26 @@ public:
 
 private:
     struct DefStorage {
+        static constexpr uint32_t k_no_index = UINT32_MAX;
+
+        struct NameSlot {
+            std::size_t hash    = 0;
+            uint32_t    def_idx = k_no_index;
+        };
+
         std::vector<TelemetryDefinition> defs;
+
+        /** Linear probing hash table of definition indices keyed by name. Size is a power of two. Definitions with the
+         * same name are in the order of defs, so the first match is the same as with a linear search */
+        std::vector<NameSlot> name_index;
+
+        /** Definition index by telemetry id */
+        std::vector<uint32_t> id_index;
+
+        /** Rebuild the indices after defs have changed */
+        void buildIndex();
+
+        const TelemetryDefinition* findByName(std::string_view name, const Type* type) const;
     };
 
     explicit TelemetryDefinitions(const std::shared_ptr<DefStorage>& defs, const std::shared_ptr<Session>& session);
@@ -0,0 +1,157 @@
+/**
+ * @file
+ * @brief Automatic rate tiers for telemetry updates
+ *
+ */
+
+#ifndef SC_API_CORE_TELEMETRY_SCHEDULER_H_
+#define SC_API_CORE_TELEMETRY_SCHEDULER_H_
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "session.h"
+#include "telemetry.h"
+#include "time.h"
+
+namespace sc_api::core {
+
+/** Settings of TelemetryScheduler */
+struct TelemetrySchedulerConfig {
+    /** Send period of telemetries that definitions flag as used for effects */
+    std::chrono::milliseconds effect_period      = std::chrono::milliseconds(2);
+
+    /** Send period of the rest of the telemetries */
+    std::chrono::milliseconds display_period     = std::chrono::milliseconds(20);
+
+    /** Update group ids of the tiers. Must not be used by other update groups of the session */
+    uint16_t                  effect_group_id    = 0xff00;
+    uint16_t                  display_group_id   = 0xff01;
+
+    /** Display tier is sent only when values change, but at least once per keep-alive. 0 sends the display tier every
+     * period. See TelemetryUpdateGroup::enableChangeTracking */
+    Clock::duration           display_keep_alive = std::chrono::milliseconds(500);
+};
+
+/** Sends a flat set of telemetries in update groups split by rate
+ *
+ * Telemetries are partitioned by the flags of their definitions: telemetries used for effects
+ * (SC_API_PROTOCOL_TELEMETRY_USED_FOR_EFFECTS) go to the effect tier and all other telemetries to the display tier.
+ * Each tier is an own TelemetryUpdateGroup that is sent by an own Session::createPeriodicTimer timer, so the
+ * application doesn't need to know which telemetries the backend wants with low latency.
+ *
+ * Telemetries are partitioned again when new definitions appear, so telemetries that didn't have a definition yet
+ * are sent once the backend defines them.
+ *
+ *     TelemetryScheduler scheduler(session);
+ *     scheduler.add({&rpm, &speed, &gear});
+ *     scheduler.start();
+ *     // Update values with Telemetry::setValue from the simulation loop
+ *
+ * Timer callbacks run in the thread that runs the session (Session::runUntilStateChanges or Api thread). Telemetry
+ * values are read in that thread the same way as when TelemetryUpdateGroup::send is called from another thread.
+ * Tier groups are registered without waiting for the socket while the lock is held. configure() retries a
+ * registration that would block until it completes, and the timer retries it on the next display tick. Other
+ * functions are thread-safe.
+ */
+class TelemetryScheduler {
+public:
+    explicit TelemetryScheduler(const std::shared_ptr<Session>& session,
+                                const TelemetrySchedulerConfig& config = TelemetrySchedulerConfig());
+    ~TelemetryScheduler();
+
+    TelemetryScheduler(const TelemetryScheduler&)            = delete;
+    TelemetryScheduler& operator=(const TelemetryScheduler&) = delete;
+
+    /** Set the telemetries that are sent. configure or start must be called before the change takes effect */
+    void set(std::vector<TelemetryBase*> telemetries);
+    void add(TelemetryBase* telemetry);
+    void add(const std::initializer_list<TelemetryBase*>& telemetries);
+
+    /** Partition telemetries with the current definitions of the session and configure the tier groups
+     *
+     * Telemetries that don't have a matching definition are left out until the definitions change.
+     *
+     * @return false, if configuring a tier group failed
+     */
+    bool configure();
+
+    /** Configure and start sending the tiers periodically
+     *
+     * Timers are started also if configuring failed, and configuring is retried when definitions change.
+     *
+     * @return Result of configure
+     */
+    bool start();
+
+    /** Stop the timers
+     *
+     * Waits for a timer callback that is running in another thread, so the scheduler isn't used after this returns.
+     * Can also be called from a timer callback.
+     */
+    void stop();
+    bool isRunning() const;
+
+    /** Send the effect tier immediately. Called by the effect tier timer
+     *
+     * @return ActionResult::failed, if the tier has no configured telemetries
+     */
+    ActionResult sendEffectTier();
+
+    /** Send the display tier immediately. Called by the display tier timer
+     *
+     * @return ActionResult::failed, if the tier has no configured telemetries
+     */
+    ActionResult sendDisplayTier();
+
+    /** Number of times telemetries have been partitioned to the tiers */
+    uint64_t getPartitionCount() const;
+
+    /** Telemetries that are currently in the effect tier */
+    std::vector<TelemetryBase*> getEffectTierTelemetries() const;
+
+    /** Telemetries that are currently in the display tier */
+    std::vector<TelemetryBase*> getDisplayTierTelemetries() const;
+
+    const TelemetrySchedulerConfig& getConfig() const { return config_; }
+
+private:
+    struct Tier {
+        explicit Tier(uint16_t group_id) : group(group_id) {}
+
+        TelemetryUpdateGroup group;
+        bool                 active = false;
+    };
+
+    /** Tier groups are registered without waiting for the socket, because the timer callbacks hold the lock */
+    bool         configureLocked();
+    ActionResult configureTier(Tier& tier, std::vector<TelemetryBase*>&& telemetries,
+                               const TelemetryDefinitions& definitions);
+    ActionResult sendTier(Tier& tier);
+
+    /** Called by the display tier timer */
+    void displayTick();
+
+    std::shared_ptr<Session> session_;
+    TelemetrySchedulerConfig config_;
+
+    mutable std::mutex          mutex_;
+    std::vector<TelemetryBase*> telemetries_;
+    Tier                        effect_tier_;
+    Tier                        display_tier_;
+
+    /** Number of definitions when the tiers were last partitioned */
+    std::size_t                 definition_count_    = 0;
+    uint64_t                    partitions_          = 0;
+    bool                        running_             = false;
+    /** Registering a tier would have blocked in the timer, so it is retried on the next display tick */
+    bool                        reconfigure_pending_ = false;
+
+    Session::PeriodicTimerHandle effect_timer_;
+    Session::PeriodicTimerHandle display_timer_;
+};
+
+}  // namespace sc_api::core
+
+#endif  // SC_API_CORE_TELEMETRY_SCHEDULER_H_
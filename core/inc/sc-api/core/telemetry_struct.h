@@ -0,0 +1,307 @@
+/**
+ * @file
+ * @brief Telemetry update group bound to the fields of a plain struct at compile time
+ *
+ */
+
+#ifndef SC_API_CORE_TELEMETRY_STRUCT_H_
+#define SC_API_CORE_TELEMETRY_STRUCT_H_
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "action.h"
+#include "telemetry.h"
+
+namespace sc_api::core {
+
+namespace internal {
+
+/** Offset of a value that doesn't have a matching definition */
+inline constexpr uint16_t k_unresolved_telemetry = 0xffff;
+
+/** Index of the size class of the value in set telemetry group payload. -1 for types that can't be sent */
+constexpr int telemetrySizeIndex(Type::BaseType type) {
+    switch (type) {
+        case Type::boolean:
+            return 0;
+        case Type::i64:
+        case Type::f64:
+            return 1;
+        case Type::i32:
+        case Type::u32:
+        case Type::f32:
+            return 2;
+        case Type::i16:
+        case Type::u16:
+            return 3;
+        case Type::i8:
+        case Type::u8:
+            return 4;
+        default:
+            return -1;
+    }
+}
+
+/** Compute positions of values in set telemetry group payload
+ *
+ * Booleans are packed to 32-bit words after the 4 byte header and the other values follow from the largest to the
+ * smallest, aligned to 8 bytes. Values of the same size are in the given order.
+ *
+ * @param size_idx telemetrySizeIndex of each value, or -1 to leave the value out
+ * @param offsets Receives the bit index of each boolean, the byte offset of the other values or
+ *                k_unresolved_telemetry
+ * @param bool_words Receives the number of 32-bit words used by booleans
+ * @return Size of the payload, as registered for the group
+ */
+constexpr uint32_t computeTelemetryPayloadLayout(const int* size_idx, std::size_t count, uint16_t* offsets,
+                                                 uint32_t* bool_words) {
+    uint32_t counts[5] = {};
+    for (std::size_t i = 0; i < count; ++i) {
+        if (size_idx[i] >= 0) ++counts[size_idx[i]];
+    }
+
+    *bool_words        = (counts[0] + 31) / 32;
+    uint32_t starts[5] = {};
+    starts[1]          = (4 + *bool_words * 4 + 7) & ~7u;
+    starts[2]          = starts[1] + counts[1] * 8;
+    starts[3]          = starts[2] + counts[2] * 4;
+    starts[4]          = starts[3] + counts[3] * 2;
+    const uint32_t end = starts[4] + counts[4];
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const int idx = size_idx[i];
+        if (idx < 0) {
+            offsets[i] = k_unresolved_telemetry;
+            continue;
+        }
+        offsets[i] = (uint16_t)starts[idx];
+        starts[idx] += idx == 0 ? 1 : 8u >> (idx - 1);
+    }
+    return end;
+}
+
+template <typename T>
+struct member_pointer_traits;
+
+template <typename C, typename M>
+struct member_pointer_traits<M C::*> {
+    using class_type  = C;
+    using member_type = M;
+};
+
+}  // namespace internal
+
+/** Binds a struct member to a telemetry
+ *
+ *     TelemetryField<&CarState::rpm, telemetry::engine_rpm>
+ *
+ * Member type must be the value type of the reference.
+ */
+template <auto Member, const auto& Ref>
+struct TelemetryField {
+    using struct_type = typename internal::member_pointer_traits<decltype(Member)>::class_type;
+    using value_type  = typename std::decay_t<decltype(Ref)>::type;
+
+    static_assert(std::is_same_v<typename internal::member_pointer_traits<decltype(Member)>::member_type, value_type>,
+                  "Member type must match the telemetry type");
+
+    static constexpr auto             member    = Member;
+    static constexpr std::string_view name      = Ref.name;
+    static constexpr Type::BaseType   base_type = get_base_type<value_type>::value;
+};
+
+/** Non-template part of TelemetryStructGroup */
+class TelemetryStructGroupBase {
+public:
+    /** Name and type of a field, in the order of the fields */
+    struct FieldInfo {
+        std::string_view name;
+        Type::BaseType   type;
+    };
+
+    TelemetryStructGroupBase(const TelemetryStructGroupBase&)            = delete;
+    TelemetryStructGroupBase& operator=(const TelemetryStructGroupBase&) = delete;
+
+    uint16_t getId() const { return group_id_; }
+
+    /** True, if all fields matched a definition and values are packed with the compile-time layout */
+    bool isComplete() const { return complete_; }
+
+    /** Number of fields that matched a definition in the latest configure */
+    unsigned getResolvedFieldCount() const { return resolved_count_; }
+
+    /** Disable this update group
+     *
+     * These telemetry values wont affect until configure() is called again.
+     */
+    ActionResult disable();
+
+protected:
+    explicit TelemetryStructGroupBase(uint16_t group_id);
+    ~TelemetryStructGroupBase();
+
+    /** Resolve the fields, register the group and compute the payload layout of the resolved fields to offsets
+     *
+     * Layout is the same as the compile-time layout, if all fields are resolved.
+     */
+    bool configureFields(const TelemetryDefinitions& definitions, const FieldInfo* fields, std::size_t count,
+                         uint16_t* offsets);
+
+    /** Start set telemetry group action and write everything except the values
+     *
+     * @return Payload or nullptr, if the group isn't configured or building failed
+     */
+    uint8_t* startSet(ActionBuilder& builder);
+
+    ActionBuilder action_builder_;
+    uint32_t      set_payload_size_ = 0;
+    uint32_t      bool_words_       = 0;
+    uint16_t      group_id_;
+    uint16_t      resolved_count_   = 0;
+    bool          prepared_         = false;
+    bool          complete_         = false;
+};
+
+/** Update group that sends the fields of a plain struct
+ *
+ * Where TelemetryUpdateGroup reads each value through a TelemetryBase pointer, this group knows the fields at compile
+ * time. Payload layout is computed at compile time and send copies the values straight from the struct to the
+ * payload, without virtual calls or per-value pointers. Game can fill the struct in its own update loop and send it
+ * as is.
+ *
+ *     struct CarState {
+ *         float  rpm;
+ *         int8_t gear;
+ *         bool   abs_active;
+ *     };
+ *
+ *     TelemetryStructGroup<CarState,
+ *                          TelemetryField<&CarState::rpm, telemetry::engine_rpm>,
+ *                          TelemetryField<&CarState::gear, telemetry::transmission_gear>,
+ *                          TelemetryField<&CarState::abs_active, telemetry::abs_active>> group(1);
+ *     group.configure(session->getTelemetries());
+ *     group.send(car_state);
+ *
+ * Fields that don't have a matching definition in the session are left out. Then the layout of the resolved fields
+ * is computed in configure and values are packed with offsets read from a table.
+ */
+template <typename Struct, typename... Fields>
+class TelemetryStructGroup : public TelemetryStructGroupBase {
+    static constexpr std::size_t k_count = sizeof...(Fields);
+
+    static_assert(k_count > 0, "Group must have at least one field");
+    static_assert((std::is_base_of_v<typename Fields::struct_type, Struct> && ...),
+                  "Fields must be members of the struct");
+    static_assert(((internal::telemetrySizeIndex(Fields::base_type) >= 0) && ...), "Field type can't be sent");
+
+    struct Layout {
+        uint16_t offsets[k_count] = {};
+        uint32_t bool_words       = 0;
+        uint32_t payload_size     = 0;
+    };
+
+    static constexpr Layout computeLayout() {
+        const int size_idx[k_count] = {internal::telemetrySizeIndex(Fields::base_type)...};
+        Layout    layout;
+        layout.payload_size =
+            internal::computeTelemetryPayloadLayout(size_idx, k_count, layout.offsets, &layout.bool_words);
+        return layout;
+    }
+
+    static constexpr bool hasUniqueNames() {
+        const std::string_view names[k_count] = {Fields::name...};
+        for (std::size_t i = 0; i < k_count; ++i) {
+            for (std::size_t j = i + 1; j < k_count; ++j) {
+                if (names[i] == names[j]) return false;
+            }
+        }
+        return true;
+    }
+
+    static_assert(hasUniqueNames(), "Same telemetry is bound to multiple fields");
+
+    static constexpr Layout k_layout = computeLayout();
+
+public:
+    explicit TelemetryStructGroup(uint16_t group_id) : TelemetryStructGroupBase(group_id) {}
+
+    /** Resolve fields using the definitions and register the group
+     *
+     * @return false, if none of the fields have a definition or registering failed
+     */
+    bool configure(const TelemetryDefinitions& definitions) {
+        static constexpr FieldInfo k_fields[k_count] = {FieldInfo{Fields::name, Fields::base_type}...};
+        return configureFields(definitions, k_fields, k_count, offsets_.data());
+    }
+
+    /** Send values of the struct to the API backend */
+    ActionResult send(const Struct& values) {
+        if (!build(values, action_builder_)) return ActionResult::failed;
+        return action_builder_.sendNonBlocking();
+    }
+
+    /** Build value update from the struct and queue it to the batch */
+    bool send(const Struct& values, ActionBatch& batch) {
+        return build(values, action_builder_) && batch.add(action_builder_);
+    }
+
+    /** Build value update from the struct to the given builder
+     *
+     * @return true, if the update action was added to the builder
+     */
+    bool build(const Struct& values, ActionBuilder& builder) {
+        uint8_t* payload = startSet(builder);
+        if (!payload) return false;
+
+        if (complete_) {
+            packStatic(values, payload, std::index_sequence_for<Fields...>());
+        } else {
+            packResolved(values, payload, std::index_sequence_for<Fields...>());
+        }
+        return true;
+    }
+
+private:
+    template <std::size_t I>
+    using FieldAt = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    template <std::size_t I>
+    static void packField(const Struct& values, uint8_t* payload, uint32_t* bool_words, uint16_t offset) {
+        using Field = FieldAt<I>;
+        if (offset == internal::k_unresolved_telemetry) return;
+
+        const auto& value = values.*(Field::member);
+        if constexpr (Field::base_type == Type::boolean) {
+            bool_words[offset / 32] |= (uint32_t)(value ? 1u : 0u) << (offset % 32);
+        } else {
+            std::memcpy(payload + offset, &value, sizeof(value));
+        }
+    }
+
+    template <std::size_t... I>
+    static void packStatic(const Struct& values, uint8_t* payload, std::index_sequence<I...>) {
+        // Offsets are template arguments, so every value is a single load and store
+        uint32_t bool_words[k_layout.bool_words + 1] = {};
+        (packField<I>(values, payload, bool_words, std::integral_constant<uint16_t, k_layout.offsets[I]>::value), ...);
+        std::memcpy(payload + 4, bool_words, k_layout.bool_words * 4);
+    }
+
+    template <std::size_t... I>
+    void packResolved(const Struct& values, uint8_t* payload, std::index_sequence<I...>) const {
+        uint32_t bool_words[k_layout.bool_words + 1] = {};
+        (packField<I>(values, payload, bool_words, offsets_[I]), ...);
+        std::memcpy(payload + 4, bool_words, bool_words_ * 4);
+    }
+
+    /** Layout of the resolved fields from the latest configure */
+    std::array<uint16_t, k_count> offsets_{};
+};
+
+}  // namespace sc_api::core
+
+#endif  // SC_API_CORE_TELEMETRY_STRUCT_H_
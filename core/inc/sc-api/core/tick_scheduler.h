@@ -0,0 +1,119 @@
+/**
+ * @file
+ * @brief Periodic tick timing for effect update loops
+ *
+ */
+
+#ifndef SC_API_CORE_TICK_SCHEDULER_H_
+#define SC_API_CORE_TICK_SCHEDULER_H_
+#include <cstdint>
+#include <memory>
+
+#include "action.h"
+#include "time.h"
+
+namespace sc_api::core {
+
+/** Settings of TickScheduler */
+struct TickSchedulerConfig {
+    Clock::duration period            = std::chrono::milliseconds(1);
+
+    /** Limits of the time that is busy waited before each deadline. Actual spin time is calibrated from the measured
+     * sleep overshoot, so that the thread wakes up from sleep before the deadline */
+    Clock::duration min_spin          = std::chrono::microseconds(20);
+    Clock::duration max_spin          = std::chrono::microseconds(200);
+
+    /** SCHED_FIFO priority of the loop thread on Linux, or time critical thread priority on Windows, when greater
+     * than 0. Usually requires elevated privileges */
+    int             realtime_priority = 0;
+
+    /** CPU core that the loop thread is pinned to, or -1 to not pin */
+    int             cpu               = -1;
+
+    /** When the loop falls behind by more than a period, skip the missed deadlines instead of running the ticks
+     * back to back */
+    bool            skip_missed_ticks = true;
+};
+
+/** Snapshot of TickScheduler statistics */
+struct TickStats {
+    uint64_t           ticks         = 0;
+
+    /** Deadlines that were skipped because the loop fell behind */
+    uint64_t           skipped_ticks = 0;
+
+    /** Distribution of how late waitNextTick returned after the deadline */
+    ActionLatencyStats lateness;
+
+    /** Spin time that is currently used before each deadline */
+    Clock::duration    spin_time{0};
+};
+
+/** Wakes up a loop thread at fixed period with low jitter
+ *
+ * Sleeping alone wakes up tens to hundreds of microseconds late depending on the OS timer slack and scheduling, and
+ * busy waiting the whole period wastes a CPU core. TickScheduler sleeps until a short while before the deadline,
+ * on Linux with an absolute clock_nanosleep and on Windows with a high resolution waitable timer, and busy waits on
+ * Clock the rest. Windows versions before 10 1803 don't have high resolution timers, so there the whole period is
+ * busy waited.
+ *
+ * Deadlines are absolute, so time spent in the loop body doesn't accumulate as drift.
+ *
+ * waitNextTick must be called from a single thread. getStats can be called from any thread.
+ */
+class TickScheduler {
+public:
+    explicit TickScheduler(const TickSchedulerConfig& config = TickSchedulerConfig());
+    ~TickScheduler();
+
+    TickScheduler(const TickScheduler&)            = delete;
+    TickScheduler& operator=(const TickScheduler&) = delete;
+
+    /** Apply realtime_priority and cpu settings to the calling thread
+     *
+     * @return false, if some of the requested settings couldn't be applied. Loop still works without them.
+     */
+    bool applyThreadSettings();
+
+    /** Set the deadline of the first tick. Called automatically by the first waitNextTick */
+    void start(Clock::time_point first_deadline = Clock::now());
+
+    /** Block until the next deadline
+     *
+     * @return Deadline of the tick, which should be used as the tick time instead of reading the clock again
+     */
+    Clock::time_point waitNextTick();
+
+    /** Deadline of the latest tick */
+    Clock::time_point getDeadline() const { return deadline_; }
+
+    Clock::duration getPeriod() const { return config_.period; }
+
+    /** Call f(Clock::time_point deadline) on every tick until it returns false */
+    template <typename Func>
+    void run(Func&& f) {
+        while (f(waitNextTick())) {
+        }
+    }
+
+    TickStats getStats() const;
+    void      resetStats();
+
+    const TickSchedulerConfig& getConfig() const { return config_; }
+
+private:
+    struct Stats;
+
+    /** Sleep until roughly the given time, which may be slightly after it */
+    static void sleepUntil(Clock::time_point t);
+
+    TickSchedulerConfig    config_;
+    Clock::time_point      deadline_;
+    bool                   started_  = false;
+    int64_t                spin_ns_;
+    std::unique_ptr<Stats> stats_;
+};
+
+}  // namespace sc_api::core
+
+#endif  // SC_API_CORE_TICK_SCHEDULER_H_
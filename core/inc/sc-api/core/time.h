@@ -11,8 +11,8 @@
 
 /** API functions for measuring and calculating timestamps for commands requiring them
  *
- * Simucube API has commands that cause effects at specific precise timepoint. All devices are synchronized to same
- * clock which allows specifying timestamps that all connected devices can use.
+ * Simucube API has commands that cause effects at specific precise timepoint. Backend synchronizes the devices to the
+ * clock of the host, which allows specifying timestamps that all connected devices can use.
  */
 namespace sc_api::core {
 
@@ -22,16 +22,57 @@ namespace clock_source {
 /** Get current timestamp of the monotonic clock that is used as reference time for the API commands
  *
  * The timestamp tick rate can be queried with getTimestampFrequency.
- * This clock source is synchronized to all connected devices.
  *
- * QueryPerformanceCounter is used to implement this and has usually 10MHz tick rate giving
- * 100ns timestamp accuracy.
+ * On Windows QueryPerformanceCounter is used to implement this and has usually 10MHz tick rate giving
+ * 100ns timestamp accuracy. This is the clock that the backend synchronizes the devices to.
+ *
+ * On other platforms timestamps are nanoseconds of CLOCK_MONOTONIC_RAW. On x86-64 CPUs with invariant TSC, the TSC
+ * is calibrated against CLOCK_MONOTONIC_RAW (takes ~20ms, see initialize) and read directly after that. The TSC
+ * conversion is anchored again to CLOCK_MONOTONIC_RAW once per second, so it stays within microseconds of it
+ * instead of drifting by the calibration error. The call that does the anchoring takes about a microsecond longer.
  */
 int64_t getTimestamp();
 
+/** Calibrate the clock source, if it needs calibration
+ *
+ * Called when a session is opened so that the calibration doesn't delay the first timestamp read in a time critical
+ * loop. Calling again does nothing.
+ */
+void initialize();
+
 /** Get how much the timestamp value increases within a second. */
 int64_t getTimestampFrequencyHz();
 
+/** Underlying clock that getTimestamp reads */
+enum class SourceType {
+    /** Windows QueryPerformanceCounter */
+    query_performance_counter,
+
+    /** clock_gettime(CLOCK_MONOTONIC_RAW), may be a system call depending on the kernel clocksource */
+    monotonic_raw,
+
+    /** rdtsc instruction converted to CLOCK_MONOTONIC_RAW time base with periodically anchored multiplier and shift */
+    tsc,
+};
+
+struct SourceInfo {
+    SourceType type         = SourceType::monotonic_raw;
+
+    /** Same as getTimestampFrequencyHz() */
+    int64_t    frequency_hz = 0;
+
+    /** Measured average duration of a single getTimestamp call in nanoseconds */
+    double     read_cost_ns = 0.0;
+};
+
+/** Get the clock source that is used and its measured read cost
+ *
+ * Read cost is measured on the first call.
+ */
+SourceInfo getSourceInfo();
+
+const char* toString(SourceType type);
+
 }  // namespace clock_source
 
 /** Clock that is used to represent time in SC-API. Fills C++ TrivialClock requirements.
@@ -50,10 +91,12 @@ struct Clock {
         std::int64_t freq                = clock_source::getTimestampFrequencyHz();
         std::int64_t ticks               = clock_source::getTimestamp();
 
-        // Optimized for common QPC frequencies
+        // Optimized for nanosecond sources and common QPC frequencies
         constexpr std::int64_t freq10MHz = 10000000;
         constexpr std::int64_t freq24MHz = 24000000;
-        if (freq == freq10MHz) {
+        if (freq == period::den) {
+            return time_point(duration(ticks));
+        } else if (freq == freq10MHz) {
             static_assert(period::den % freq10MHz == 0);
             return time_point(duration(ticks * (period::den / freq10MHz)));
         } else if (freq == freq24MHz) {
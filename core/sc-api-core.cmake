@@ -14,6 +14,9 @@ add_library(sc-api-core
     src/device_info_internal.h src/device_info.cpp
     src/shm_bson_data_provider.h src/shm_bson_data_provider.cpp
     inc/sc-api/core/action.h src/action.cpp
+    src/action_sender.h src/action_sender.cpp
+    src/action_stats.h src/action_stats.cpp
+    src/sample_quantization.h src/sample_quantization.cpp
 
     src/crypto/gcm.h
     src/crypto/gcm.c
@@ -32,6 +35,10 @@ add_library(sc-api-core
 
     inc/sc-api/core/telemetry.h
     src/telemetry.cpp
+    inc/sc-api/core/telemetry_scheduler.h
+    src/telemetry_scheduler.cpp
+    inc/sc-api/core/telemetry_struct.h
+    src/telemetry_struct.cpp
     src/security_impl.h
     src/security_impl.cpp
     inc/sc-api/core/api_core.h
@@ -40,6 +47,19 @@ add_library(sc-api-core
     src/api_core.cpp
     inc/sc-api/core/ffb.h
     src/ffb.cpp
+    inc/sc-api/core/ffb_lead_time.h
+    src/ffb_lead_time.cpp
+    inc/sc-api/core/ffb_stream.h
+    src/ffb_stream.cpp
+    inc/sc-api/core/ffb_synthesis.h
+    src/ffb_synthesis.cpp
+    inc/sc-api/core/ffb_mixer.h
+    src/ffb_mixer.cpp
+    inc/sc-api/core/ffb_recorder.h
+    src/ffb_recorder.cpp
+    src/effect_action.h
+    inc/sc-api/core/tick_scheduler.h
+    src/tick_scheduler.cpp
     inc/sc-api/core/time.h
     src/time.cpp
     inc/sc-api/core/compatibility.h
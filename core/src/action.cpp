@@ -1,23 +1,91 @@
 #include "sc-api/core/action.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "api_internal.h"
 #include "sc-api/core/session.h"
 
 namespace sc_api::core {
 
+namespace {
+
+/** Send single datagram and block if socket send buffer is full */
+ActionResult sendDatagramBlocking(Session::Internal& h, const uint8_t* data, std::size_t size) {
+    internal::ActionStatsCollector* stats = h.actionStats();
+
+    asio::error_code ec;
+    {
+        std::lock_guard lock(h.high_prio_mutex);
+        const int64_t   start = stats ? internal::ActionStatsCollector::now() : 0;
+        h.high_priority_socket.send_to(asio::const_buffer(data, size), h.high_priority_socket_target, 0, ec);
+        if (stats) stats->recordSend(internal::ActionStatsCollector::now() - start);
+    }
+
+    if (!ec) {
+        if (stats) stats->addDatagramResult(ActionResult::complete);
+        return ActionResult::complete;
+    }
+
+    if (ec != asio::error::would_block) {
+        if (stats) stats->addDatagramResult(ActionResult::failed);
+        return ActionResult::failed;
+    }
+    if (stats) stats->addDatagramResult(ActionResult::would_block);
+
+    // Synchronize this to non-blocking operation
+    ActionResult result = ActionResult::inprogress;
+    {
+        std::unique_lock lock(h.high_prio_mutex);
+        h.high_priority_socket.async_send_to(asio::const_buffer(data, size), h.high_priority_socket_target,
+                                             [&](asio::error_code ec, std::size_t sent_bytes) {
+                                                 {
+                                                     std::lock_guard lock(h.high_prio_mutex);
+                                                     if (!ec) {
+                                                         result = ActionResult::complete;
+                                                     } else {
+                                                         result = ActionResult::failed;
+                                                     }
+                                                 }
+                                                 if (stats) stats->addDatagramResult(result);
+                                                 h.high_prio_sync_cv.notify_all();
+                                             });
+
+        h.high_prio_sync_cv.wait(lock, [&]() { return result != ActionResult::inprogress; });
+    }
+    return result;
+}
+
+}  // namespace
+
 ActionBuilder::ActionBuilder(ActionBuilder&& builder) noexcept
     : session_(std::move(builder.session_)),
       buffer_(std::move(builder.buffer_)),
-      cur_start_idx_(builder.cur_start_idx_) {}
+      cur_start_idx_(builder.cur_start_idx_),
+      build_start_ns_(builder.build_start_ns_),
+      ring_(std::move(builder.ring_)) {}
 
 ActionBuilder::ActionBuilder(std::shared_ptr<Session> session) { init(std::move(session)); }
 
+ActionBuilder& ActionBuilder::operator=(const ActionBuilder& builder) {
+    if (this == &builder) return *this;
+
+    // Ring has a single producer, so this builder keeps its own
+    session_        = builder.session_;
+    buffer_         = builder.buffer_;
+    cur_start_idx_  = builder.cur_start_idx_;
+    build_start_ns_ = builder.build_start_ns_;
+    return *this;
+}
+
 ActionBuilder& ActionBuilder::operator=(ActionBuilder&& builder) noexcept {
     if (this == &builder) return *this;
 
     session_               = std::move(builder.session_);
     buffer_                = std::move(builder.buffer_);
     cur_start_idx_         = builder.cur_start_idx_;
+    build_start_ns_        = builder.build_start_ns_;
+    ring_                  = std::move(builder.ring_);
     builder.cur_start_idx_ = 0;
     return *this;
 }
@@ -25,25 +93,30 @@ ActionBuilder& ActionBuilder::operator=(ActionBuilder&& builder) noexcept {
 void ActionBuilder::init(std::shared_ptr<Session> session) {
     session_ = std::move(session);
     reset();
+    reserveCapacity();
+}
+
+void ActionBuilder::reserveCapacity() {
+    if (!session_) return;
+
+    // Typical frame fits to one datagram, so reserving that much avoids reallocations during steady state
+    buffer_.reserve(session_->getInternal().maxPlaintextDatagramSize());
+    datagram_ends_.reserve(k_reserved_datagrams);
+    datagram_results_.reserve(k_reserved_datagrams);
 }
 
 void ActionBuilder::reset() {
     buffer_.resize(0);
-    cur_start_idx_ = 0;
+    cur_start_idx_  = 0;
+    build_start_ns_ = 0;
 }
 
 bool ActionBuilder::build(SC_API_PROTOCOL_Action_t action_id, const uint8_t* payload, size_t payload_size,
                           uint16_t flags) {
-    if (!session_ || session_->getControllerId() == 0u) return false;
+    uint8_t* payload_buf = startBuilding(action_id, payload_size, flags);
+    if (!payload_buf) return false;
 
-    cur_start_idx_ = (uint32_t)buffer_.size();
-    buffer_.resize(buffer_.size() + sizeof(SC_API_PROTOCOL_ActionHeader_t) + payload_size);
-    SC_API_PROTOCOL_ActionHeader_t* hdr = new (&buffer_[cur_start_idx_]) SC_API_PROTOCOL_ActionHeader_t();
-    hdr->action_id                      = action_id;
-    hdr->controller_id                  = session_->getControllerId();
-    hdr->flags                          = flags;
-    hdr->size                           = (uint16_t)(sizeof(SC_API_PROTOCOL_ActionHeader_t) + payload_size);
-    std::memcpy(&buffer_[cur_start_idx_ + sizeof(SC_API_PROTOCOL_ActionHeader_t)], payload, payload_size);
+    std::memcpy(payload_buf, payload, payload_size);
     return true;
 }
 
@@ -51,9 +124,16 @@ uint8_t* ActionBuilder::startBuilding(SC_API_PROTOCOL_Action_t action_id, std::s
                                       uint16_t flags) {
     if (!session_ || session_->getControllerId() == 0u) return nullptr;
 
+    // Previous action may have been resized after it was started
+    if (!buffer_.empty()) {
+        finalize();
+    } else if (session_->getInternal().actionStats()) {
+        build_start_ns_ = internal::ActionStatsCollector::now();
+    }
+
     cur_start_idx_ = (uint32_t)buffer_.size();
     buffer_.resize(cur_start_idx_ + sizeof(SC_API_PROTOCOL_ActionHeader_t) + initial_payload_size);
-    SC_API_PROTOCOL_ActionHeader_t* hdr = new (buffer_.data()) SC_API_PROTOCOL_ActionHeader_t();
+    SC_API_PROTOCOL_ActionHeader_t* hdr = new (&buffer_[cur_start_idx_]) SC_API_PROTOCOL_ActionHeader_t();
     hdr->action_id                      = action_id;
     hdr->controller_id                  = session_->getControllerId();
     hdr->flags                          = flags;
@@ -74,24 +154,67 @@ void ActionBuilder::asyncSend(std::atomic<ActionResult>& result_status) {
         return;
     }
 
-    finalize();
+    if (!splitToDatagrams(datagram_ends_)) {
+        reset();
+        result_status.store(ActionResult::failed, std::memory_order_release);
+        return;
+    }
 
     auto& h = session_->getInternal();
 
     result_status.store(ActionResult::inprogress, std::memory_order_release);
+    ActionResult queued = queueToSender(&result_status);
+    if (queued != ActionResult::inprogress) {
+        if (queued != ActionResult::complete) {
+            reset();
+            result_status.store(queued, std::memory_order_release);
+        }
+        return;
+    }
+
+    bool failed = false;
+    if (h.preferBatchSend()) {
+        // Send immediately what can be sent and only continue asynchronously with datagrams that would block
+        datagram_results_.assign(datagram_ends_.size(), ActionResult::failed);
+        h.sendHighPrioBatch(buffer_.data(), datagram_ends_.data(), datagram_ends_.size(), datagram_results_.data());
+        failed = std::find(datagram_results_.begin(), datagram_results_.end(), ActionResult::failed) !=
+                 datagram_results_.end();
+
+        if (!retainBlockedDatagrams()) {
+            result_status.store(failed ? ActionResult::failed : ActionResult::complete, std::memory_order_release);
+            return;
+        }
+    }
+
+    // Swap with a recycled buffer so that this builder gets back storage that already has capacity
+    Session::Internal::AsyncSendBuffer* send_buffer = h.acquireSendBuffer();
+    send_buffer->data.swap(buffer_);
+    send_buffer->remaining = datagram_ends_.size();
+    send_buffer->failed    = failed;
+    reset();
+    reserveCapacity();
+
     {
-        cur_start_idx_      = 0;
-        auto            buf = asio::const_buffer(buffer_.data(), buffer_.size());
         std::lock_guard lock(h.high_prio_mutex);
-        h.high_priority_socket.async_send_to(
-            buf, h.high_priority_socket_target,
-            [&result_status, buf_life_time = std::move(buffer_)](asio::error_code ec, std::size_t sent_bytes) {
-                if (!ec) {
-                    result_status.store(ActionResult::complete, std::memory_order_release);
-                } else {
-                    result_status.store(ActionResult::failed, std::memory_order_release);
-                }
-            });
+        uint32_t        start = 0;
+        for (uint32_t end : datagram_ends_) {
+            h.high_priority_socket.async_send_to(
+                asio::const_buffer(send_buffer->data.data() + start, end - start), h.high_priority_socket_target,
+                [&result_status, &h, send_buffer](asio::error_code ec, std::size_t sent_bytes) {
+                    if (ec) {
+                        send_buffer->failed = true;
+                    }
+                    if (internal::ActionStatsCollector* stats = h.actionStats()) {
+                        stats->addDatagramResult(ec ? ActionResult::failed : ActionResult::complete);
+                    }
+                    if (send_buffer->remaining.fetch_sub(1) == 1) {
+                        result_status.store(send_buffer->failed ? ActionResult::failed : ActionResult::complete,
+                                            std::memory_order_release);
+                        h.releaseSendBuffer(send_buffer);
+                    }
+                });
+            start = end;
+        }
     }
 }
 
@@ -101,26 +224,85 @@ ActionResult ActionBuilder::sendNonBlocking() {
         return ActionResult::failed;
     }
 
-    finalize();
+    if (!splitToDatagrams(datagram_ends_)) {
+        reset();
+        return ActionResult::failed;
+    }
     auto& h = session_->getInternal();
 
-    asio::error_code ec;
-    {
-        std::lock_guard lock(h.high_prio_mutex);
-        h.high_priority_socket.send_to(asio::const_buffer(buffer_.data(), buffer_.size()),
-                                       h.high_priority_socket_target, 0, ec);
+    ActionResult queued = queueToSender(nullptr);
+    if (queued != ActionResult::inprogress) {
+        return queued;
     }
-    if (!ec) {
-        reset();
-        return ActionResult::complete;
+
+    if (datagram_ends_.size() == 1 && !h.preferBatchSend()) {
+        internal::ActionStatsCollector* stats = h.actionStats();
+
+        asio::error_code ec;
+        {
+            std::lock_guard lock(h.high_prio_mutex);
+            const int64_t   start = stats ? internal::ActionStatsCollector::now() : 0;
+            h.high_priority_socket.send_to(asio::const_buffer(buffer_.data(), buffer_.size()),
+                                           h.high_priority_socket_target, 0, ec);
+            if (stats) stats->recordSend(internal::ActionStatsCollector::now() - start);
+        }
+
+        const ActionResult result = !ec                               ? ActionResult::complete
+                                    : ec == asio::error::would_block ? ActionResult::would_block
+                                                                     : ActionResult::failed;
+        if (stats) stats->addDatagramResult(result);
+
+        if (result != ActionResult::would_block) {
+            reset();
+        }
+        return result;
     }
 
-    if (ec == asio::error::would_block) {
-        return ActionResult::would_block;
+    std::vector<ActionResult>& results = datagram_results_;
+    results.assign(datagram_ends_.size(), ActionResult::failed);
+    h.sendHighPrioBatch(buffer_.data(), datagram_ends_.data(), datagram_ends_.size(), results.data());
+
+    bool failed = std::find(results.begin(), results.end(), ActionResult::failed) != results.end();
+
+    // Keep datagrams that would block in the buffer so that they can be retried
+    if (!retainBlockedDatagrams()) {
+        return failed ? ActionResult::failed : ActionResult::complete;
     }
+    return failed ? ActionResult::failed : ActionResult::would_block;
+}
 
-    reset();
-    return ActionResult::failed;
+bool ActionBuilder::retainBlockedDatagrams() {
+    uint32_t    write_idx = 0;
+    uint32_t    start     = 0;
+    std::size_t kept      = 0;
+    for (std::size_t i = 0; i < datagram_ends_.size(); ++i) {
+        const uint32_t end = datagram_ends_[i];
+        if (datagram_results_[i] == ActionResult::would_block) {
+            std::memmove(buffer_.data() + write_idx, buffer_.data() + start, end - start);
+            write_idx += end - start;
+            datagram_ends_[kept++] = write_idx;
+        }
+        start = end;
+    }
+
+    if (kept == 0) {
+        reset();
+        return false;
+    }
+
+    datagram_ends_.resize(kept);
+    buffer_.resize(write_idx);
+
+    // Find the last action so that builder can continue from it
+    uint32_t idx = kept > 1 ? datagram_ends_[kept - 2] : 0;
+    for (;;) {
+        SC_API_PROTOCOL_ActionHeader_t hdr;
+        std::memcpy(&hdr, &buffer_[idx], sizeof(hdr));
+        if (idx + hdr.size >= write_idx) break;
+        idx += hdr.size;
+    }
+    cur_start_idx_ = idx;
+    return true;
 }
 
 ActionResult ActionBuilder::sendBlocking() {
@@ -129,49 +311,61 @@ ActionResult ActionBuilder::sendBlocking() {
         return ActionResult::failed;
     }
 
-    finalize();
+    if (!splitToDatagrams(datagram_ends_)) {
+        reset();
+        return ActionResult::failed;
+    }
     auto& h = session_->getInternal();
 
-    asio::error_code ec;
-    {
-        std::lock_guard lock(h.high_prio_mutex);
-        h.high_priority_socket.send_to(asio::const_buffer(buffer_.data(), buffer_.size()),
-                                       h.high_priority_socket_target, 0, ec);
+    ActionResult result = ActionResult::complete;
+    if (datagram_ends_.size() == 1) {
+        result = sendDatagramBlocking(h, buffer_.data(), buffer_.size());
+    } else {
+        std::vector<ActionResult>& results = datagram_results_;
+        results.assign(datagram_ends_.size(), ActionResult::failed);
+        h.sendHighPrioBatch(buffer_.data(), datagram_ends_.data(), datagram_ends_.size(), results.data());
+
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            if (results[i] == ActionResult::would_block) {
+                uint32_t start = i == 0 ? 0 : datagram_ends_[i - 1];
+                results[i]     = sendDatagramBlocking(h, buffer_.data() + start, datagram_ends_[i] - start);
+            }
+            if (results[i] != ActionResult::complete) {
+                result = ActionResult::failed;
+            }
+        }
     }
 
-    if (!ec) {
-        reset();
-        return ActionResult::complete;
-    }
+    reset();
+    return result;
+}
 
-    if (ec != asio::error::would_block) {
-        reset();
-        return ActionResult::failed;
+ActionResult ActionBuilder::queueToSender(std::atomic<ActionResult>* result_status) {
+    internal::ActionSenderUse use(session_->getInternal());
+    internal::ActionSender*   sender = use.get();
+    if (!sender) {
+        return ActionResult::inprogress;
     }
 
-    // Synchronize this to non-blocking operation
-    ActionResult result = ActionResult::inprogress;
-    {
-        std::unique_lock lock(h.high_prio_mutex);
-        h.high_priority_socket.async_send_to(asio::const_buffer(buffer_.data(), buffer_.size()),
-                                             h.high_priority_socket_target,
-                                             [&](asio::error_code ec, std::size_t sent_bytes) {
-                                                 {
-                                                     std::lock_guard lock(h.high_prio_mutex);
-                                                     if (!ec) {
-                                                         result = ActionResult::complete;
-                                                     } else {
-                                                         result = ActionResult::failed;
-                                                     }
-                                                 }
-                                                 h.high_prio_sync_cv.notify_all();
-                                             });
+    // Compared by generation, because a new sender may be allocated to the address of the previous one
+    if (!ring_ || ring_->getGeneration() != sender->getGeneration()) {
+        ring_ = sender->createRing();
+    }
 
-        h.high_prio_sync_cv.wait(lock, [&]() { return result != ActionResult::inprogress; });
+    if (!ring_->tryPush(buffer_.data(), datagram_ends_.data(), datagram_ends_.size(), result_status)) {
+        // Builder is kept as is so that it can be retried, unless it can never fit to the queue
+        for (std::size_t i = 0; i < datagram_ends_.size(); ++i) {
+            uint32_t start = i == 0 ? 0 : datagram_ends_[i - 1];
+            if (datagram_ends_[i] - start > session_->getInternal().maxPlaintextDatagramSize()) {
+                reset();
+                return ActionResult::failed;
+            }
+        }
+        return ActionResult::would_block;
     }
 
     reset();
-    return result;
+    return ActionResult::complete;
 }
 
 void ActionBuilder::finalize() {
@@ -180,4 +374,121 @@ void ActionBuilder::finalize() {
     hdr->size = (uint16_t)(buffer_.size() - cur_start_idx_);
 }
 
+bool ActionBuilder::splitToDatagrams(std::vector<uint32_t>& datagram_ends) {
+    finalize();
+    datagram_ends.resize(0);
+
+    const auto& h = session_->getInternal();
+
+    // Datagrams that are retried after would_block are split again, but build_start_ns_ is only set for new actions
+    if (build_start_ns_ != 0) {
+        if (internal::ActionStatsCollector* stats = h.actionStats()) {
+            stats->recordBuild(internal::ActionStatsCollector::now() - build_start_ns_);
+            stats->addActions(buffer_.data(), buffer_.size());
+        }
+        build_start_ns_ = 0;
+    }
+
+
+    const uint32_t plaintext_limit = h.maxPlaintextDatagramSize();
+    const uint32_t encrypted_limit = h.maxEncryptedDatagramSize();
+
+    uint32_t datagram_start     = 0;
+    bool     datagram_encrypted = false;
+    uint32_t idx                = 0;
+    while (idx < buffer_.size()) {
+        SC_API_PROTOCOL_ActionHeader_t hdr;
+        std::memcpy(&hdr, &buffer_[idx], sizeof(hdr));
+
+        // Whole datagram must fit to the encrypted limit if it contains any encrypted actions
+        const bool action_encrypted = (hdr.flags & SC_API_PROTOCOL_ACTION_FLAG_ENCRYPTED) != 0;
+        bool       encrypted        = datagram_encrypted || action_encrypted;
+        uint32_t   limit            = encrypted ? encrypted_limit : plaintext_limit;
+        if (idx != datagram_start && idx + hdr.size - datagram_start > limit) {
+            datagram_ends.push_back(idx);
+            datagram_start = idx;
+            encrypted      = action_encrypted;
+        }
+
+        // Backend would reject the datagram, so fail before sending anything
+        if (hdr.size > (action_encrypted ? encrypted_limit : plaintext_limit)) {
+            datagram_ends.resize(0);
+            return false;
+        }
+
+        datagram_encrypted = encrypted;
+        idx += hdr.size;
+    }
+    datagram_ends.push_back(idx);
+    return true;
+}
+
+ActionBatch::ActionBatch(std::shared_ptr<Session> session) { init(std::move(session)); }
+
+void ActionBatch::init(std::shared_ptr<Session> session) {
+    session_ = std::move(session);
+    clear();
+    results_.clear();
+
+    if (session_) {
+        buffer_.reserve(session_->getInternal().maxPlaintextDatagramSize());
+    }
+}
+
+bool ActionBatch::add(ActionBuilder& builder) {
+    if (!builder.session_ || builder.buffer_.empty()) {
+        builder.reset();
+        return false;
+    }
+
+    if (!session_) {
+        session_ = builder.session_;
+    } else if (session_ != builder.session_) {
+        builder.reset();
+        return false;
+    }
+
+    if (!builder.splitToDatagrams(builder.datagram_ends_)) {
+        builder.reset();
+        return false;
+    }
+
+    const uint32_t offset = (uint32_t)buffer_.size();
+    buffer_.insert(buffer_.end(), builder.buffer_.begin(), builder.buffer_.end());
+    for (uint32_t end : builder.datagram_ends_) {
+        datagram_ends_.push_back(offset + end);
+    }
+    builder.reset();
+    return true;
+}
+
+void ActionBatch::clear() {
+    buffer_.resize(0);
+    datagram_ends_.resize(0);
+}
+
+ActionResult ActionBatch::flush() {
+    results_.assign(datagram_ends_.size(), ActionResult::failed);
+    if (datagram_ends_.empty()) {
+        return ActionResult::complete;
+    }
+
+    if (session_) {
+        session_->getInternal().sendHighPrioBatch(buffer_.data(), datagram_ends_.data(), datagram_ends_.size(),
+                                                  results_.data());
+    }
+    clear();
+
+    ActionResult result = ActionResult::complete;
+    for (ActionResult r : results_) {
+        if (r == ActionResult::failed) {
+            return ActionResult::failed;
+        }
+        if (r == ActionResult::would_block) {
+            result = ActionResult::would_block;
+        }
+    }
+    return result;
+}
+
 }  // namespace sc_api::core
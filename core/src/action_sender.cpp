@@ -0,0 +1,164 @@
+#include "action_sender.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "api_internal.h"
+
+namespace sc_api::core::internal {
+
+ActionRing::ActionRing(uint64_t generation, uint32_t slot_count, uint32_t slot_size)
+    : generation_(generation), slots_(slot_count), mask_(slot_count - 1), slot_size_(slot_size) {
+    data_.reset(static_cast<uint8_t*>(alignedAlloc(64, (std::size_t)slot_count * slot_size)));
+}
+
+bool ActionRing::tryPush(const uint8_t* data, const uint32_t* datagram_ends, std::size_t count,
+                         std::atomic<ActionResult>* result) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    const uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (count == 0 || count > slots_.size() - (head - tail)) {
+        return false;
+    }
+
+    uint32_t start = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (datagram_ends[i] - start > slot_size_) {
+            return false;
+        }
+        start = datagram_ends[i];
+    }
+
+    start = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const uint32_t idx  = (head + (uint32_t)i) & mask_;
+        Slot&          slot = slots_[idx];
+        slot.size           = datagram_ends[i] - start;
+        slot.group_end      = i + 1 == count;
+        slot.result         = slot.group_end ? result : nullptr;
+        std::memcpy(data_.get() + (std::size_t)idx * slot_size_, data + start, slot.size);
+        start = datagram_ends[i];
+    }
+
+    head_.store(head + (uint32_t)count, std::memory_order_release);
+    return true;
+}
+
+ActionSender::ActionSender(Session::Internal& h, const ActionSenderConfig& config, uint64_t generation)
+    : h_(h), config_(config), slot_size_(h.maxPlaintextDatagramSize()), generation_(generation) {
+    // Ring indexing requires power of two slot count
+    uint32_t slots = 1;
+    while (slots < std::max<uint32_t>(config_.ring_slots, 2)) {
+        slots <<= 1;
+    }
+    config_.ring_slots = slots;
+
+    thread_ = std::thread([this]() { run(); });
+}
+
+ActionSender::~ActionSender() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    // Producers have stopped, so this sees everything that was queued
+    if (collectBatch()) {
+        sendBatch(false);
+    }
+}
+
+std::shared_ptr<ActionRing> ActionSender::createRing() {
+    auto ring = std::make_shared<ActionRing>(generation_, config_.ring_slots, slot_size_);
+
+    {
+        std::lock_guard lock(new_rings_mutex_);
+        new_rings_.push_back(ring);
+        has_new_rings_.store(true, std::memory_order_release);
+    }
+
+    // Producer's reference closes the ring when the last copy of it is dropped, after the last push
+    return std::shared_ptr<ActionRing>(ring.get(), [ring](ActionRing* r) { r->close(); });
+}
+
+void ActionSender::run() {
+    if (config_.cpu >= 0) {
+        setCurrentThreadAffinity(config_.cpu);
+    }
+
+    while (running_.load(std::memory_order_relaxed)) {
+        if (!collectBatch()) {
+            std::this_thread::sleep_for(config_.idle_sleep);
+            continue;
+        }
+
+        sendBatch(true);
+    }
+}
+
+bool ActionSender::collectBatch() {
+    if (has_new_rings_.load(std::memory_order_acquire)) {
+        std::lock_guard lock(new_rings_mutex_);
+        rings_.insert(rings_.end(), new_rings_.begin(), new_rings_.end());
+        new_rings_.clear();
+        has_new_rings_.store(false, std::memory_order_relaxed);
+    }
+
+    batch_buffer_.resize(0);
+    batch_ends_.resize(0);
+    batch_pending_.resize(0);
+    for (auto& ring : rings_) {
+        // Closed is checked before consuming, so the last push of a released ring is consumed too
+        const bool closed = ring->isClosed();
+        ring->consume([this](const uint8_t* data, uint32_t size, bool group_end, std::atomic<ActionResult>* result) {
+            batch_buffer_.insert(batch_buffer_.end(), data, data + size);
+            batch_ends_.push_back((uint32_t)batch_buffer_.size());
+            batch_pending_.push_back({result, group_end});
+        });
+        if (closed) ring.reset();
+    }
+    rings_.erase(std::remove(rings_.begin(), rings_.end(), nullptr), rings_.end());
+
+    return !batch_ends_.empty();
+}
+
+void ActionSender::sendBatch(bool retry) {
+    batch_results_.assign(batch_ends_.size(), ActionResult::failed);
+    h_.sendHighPrioBatch(batch_buffer_.data(), batch_ends_.data(), batch_ends_.size(), batch_results_.data());
+
+    // Socket send buffer was full. Everything after the first datagram that would block would block too, so send the
+    // rest again once the kernel has had time to drain the buffer
+    std::size_t first = 0;
+    while (retry) {
+        while (first < batch_results_.size() && batch_results_[first] != ActionResult::would_block) ++first;
+        if (first == batch_results_.size() || !running_.load(std::memory_order_relaxed)) break;
+
+        std::this_thread::yield();
+
+        const uint32_t start = first == 0 ? 0 : batch_ends_[first - 1];
+        for (std::size_t i = first; i < batch_ends_.size(); ++i) batch_ends_[i] -= start;
+        h_.sendHighPrioBatch(batch_buffer_.data() + start, batch_ends_.data() + first, batch_ends_.size() - first,
+                             batch_results_.data() + first);
+        for (std::size_t i = first; i < batch_ends_.size(); ++i) batch_ends_[i] += start;
+    }
+
+    for (std::size_t i = 0; i < batch_pending_.size(); ++i) {
+        group_failed_ |= batch_results_[i] != ActionResult::complete;
+        if (!batch_pending_[i].group_end) continue;
+
+        if (batch_pending_[i].result) {
+            batch_pending_[i].result->store(group_failed_ ? ActionResult::failed : ActionResult::complete,
+                                            std::memory_order_release);
+        }
+        group_failed_ = false;
+    }
+}
+
+ActionSenderUse::ActionSenderUse(Session::Internal& h) : h_(h) {
+    // Sequentially consistent, so that stopActionSender either sees the counter or this sees nullptr
+    h_.action_sender_users.fetch_add(1);
+    sender_ = h_.active_action_sender.load();
+}
+
+ActionSenderUse::~ActionSenderUse() { h_.action_sender_users.fetch_sub(1, std::memory_order_release); }
+
+}  // namespace sc_api::core::internal
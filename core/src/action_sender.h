@@ -0,0 +1,172 @@
+/**
+ * @file
+ * @brief Dedicated sender thread for high priority actions
+ *
+ */
+
+#ifndef SC_API_INTERNAL_ACTION_SENDER_H_
+#define SC_API_INTERNAL_ACTION_SENDER_H_
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "compatibility.h"
+#include "sc-api/core/action.h"
+#include "sc-api/core/session.h"
+
+namespace sc_api::core::internal {
+
+/** Single producer single consumer queue of fixed size datagram slots
+ *
+ * Producer is an ActionBuilder and consumer is the ActionSender thread. Neither side takes locks.
+ */
+class ActionRing {
+public:
+    ActionRing(uint64_t generation, uint32_t slot_count, uint32_t slot_size);
+
+    /** Generation of the sender that this ring is registered to */
+    uint64_t getGeneration() const { return generation_; }
+
+    /** Push datagrams stored back to back in data as one group
+     *
+     * Either all or none of the datagrams are pushed.
+     *
+     * @param result Updated when the last datagram of the group has been sent. May be nullptr
+     * @return false, if there isn't enough free slots or some of the datagrams don't fit to a slot
+     */
+    bool tryPush(const uint8_t* data, const uint32_t* datagram_ends, std::size_t count,
+                 std::atomic<ActionResult>* result);
+
+    /** Consume all currently available datagrams
+     *
+     * @param f Functor void(const uint8_t* data, uint32_t size, bool group_end, std::atomic<ActionResult>* result)
+     * @return number of consumed datagrams
+     */
+    template <typename Func>
+    std::size_t consume(Func&& f) {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        const uint32_t head = head_.load(std::memory_order_acquire);
+        for (uint32_t i = tail; i != head; ++i) {
+            const Slot& slot = slots_[i & mask_];
+            f(data_.get() + (std::size_t)(i & mask_) * slot_size_, slot.size, slot.group_end, slot.result);
+        }
+        tail_.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed); }
+
+    /** Called when the producer releases the ring. Nothing is pushed after this */
+    void close() { closed_.store(true, std::memory_order_release); }
+
+    /** If true, everything the producer pushed is visible to the consumer */
+    bool isClosed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+    struct Slot {
+        uint32_t                   size      = 0;
+        bool                       group_end = false;
+        std::atomic<ActionResult>* result    = nullptr;
+    };
+
+    uint64_t                  generation_;
+    AlignedUniquePtr<uint8_t> data_;
+    std::vector<Slot>         slots_;
+    uint32_t                  mask_;
+    uint32_t                  slot_size_;
+
+    /** Written only by the producer */
+    alignas(64) std::atomic<uint32_t> head_{0};
+    std::atomic<bool>                 closed_{false};
+    /** Written only by the consumer */
+    alignas(64) std::atomic<uint32_t> tail_{0};
+};
+
+/** Thread that drains ActionRings of all producers and sends them to the high priority socket in batches
+ *
+ * Datagrams that would block are retried until they are sent. When the sender is destroyed, datagrams that are still
+ * queued are sent once more and the ones that would block are reported failed, so no result is left in progress.
+ */
+class ActionSender {
+public:
+    /** @param generation Unique for each sender of the session, so that rings of a previous sender can be recognized */
+    ActionSender(Session::Internal& h, const ActionSenderConfig& config, uint64_t generation);
+    ~ActionSender();
+
+    uint64_t getGeneration() const { return generation_; }
+
+    ActionSender(const ActionSender&)            = delete;
+    ActionSender& operator=(const ActionSender&) = delete;
+
+    /** Create new ring for a producer
+     *
+     * Takes a lock, so this should be done once per producer and not on every send.
+     * Ring is closed when the producer drops its reference to it, and released once all queued datagrams have been
+     * sent.
+     */
+    std::shared_ptr<ActionRing> createRing();
+
+private:
+    struct PendingResult {
+        std::atomic<ActionResult>* result;
+        bool                       group_end;
+    };
+
+    void run();
+
+    /** Move datagrams of all rings to the batch
+     *
+     * @return false, if there was nothing to send
+     */
+    bool collectBatch();
+
+    /** Send the batch. Datagrams that would block are retried while retry is true and reported failed otherwise */
+    void sendBatch(bool retry);
+
+    Session::Internal& h_;
+    ActionSenderConfig config_;
+    uint32_t           slot_size_;
+    uint64_t           generation_;
+
+    std::mutex                               new_rings_mutex_;
+    std::vector<std::shared_ptr<ActionRing>> new_rings_;
+    std::atomic_bool                         has_new_rings_{false};
+    std::atomic_bool                         running_{true};
+
+    // Only accessed from the sender thread
+    std::vector<std::shared_ptr<ActionRing>> rings_;
+    std::vector<uint8_t>                     batch_buffer_;
+    std::vector<uint32_t>                    batch_ends_;
+    std::vector<ActionResult>                batch_results_;
+    std::vector<PendingResult>               batch_pending_;
+    bool                                     group_failed_ = false;
+
+    std::thread thread_;
+};
+
+/** Keeps the active sender of the session alive while a producer queues to it
+ *
+ * Producers only increment a counter, and Session::stopActionSender waits for the counter to reach zero before it
+ * frees the sender.
+ */
+class ActionSenderUse {
+public:
+    explicit ActionSenderUse(Session::Internal& h);
+    ~ActionSenderUse();
+
+    ActionSenderUse(const ActionSenderUse&)            = delete;
+    ActionSenderUse& operator=(const ActionSenderUse&) = delete;
+
+    /** Active sender or nullptr, if the sender thread isn't running */
+    ActionSender* get() const { return sender_; }
+
+private:
+    Session::Internal& h_;
+    ActionSender*      sender_;
+};
+
+}  // namespace sc_api::core::internal
+
+#endif  // SC_API_INTERNAL_ACTION_SENDER_H_
@@ -0,0 +1,144 @@
+#include "action_stats.h"
+
+#include <cstring>
+
+namespace sc_api::core::internal {
+
+void LatencyHistogram::record(int64_t ns) {
+    const uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+
+    int bucket       = 0;
+    while (bucket + 1 < ActionLatencyStats::k_bucket_count && v >= ((uint64_t)2 << bucket)) ++bucket;
+
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(v, std::memory_order_relaxed);
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t prev_max = max_ns_.load(std::memory_order_relaxed);
+    while (v > prev_max && !max_ns_.compare_exchange_weak(prev_max, v, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::copyTo(ActionLatencyStats& out) const {
+    out.count    = count_.load(std::memory_order_relaxed);
+    out.total_ns = total_ns_.load(std::memory_order_relaxed);
+    out.max_ns   = max_ns_.load(std::memory_order_relaxed);
+    for (int i = 0; i < ActionLatencyStats::k_bucket_count; ++i) {
+        out.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::reset() {
+    count_.store(0, std::memory_order_relaxed);
+    total_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+    for (auto& b : buckets_) {
+        b.store(0, std::memory_order_relaxed);
+    }
+}
+
+void ActionStatsCollector::addDatagramResult(ActionResult result) {
+    switch (result) {
+        case ActionResult::complete:
+            datagrams_sent_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ActionResult::would_block:
+            would_block_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ActionResult::failed:
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ActionResult::inprogress:
+            break;
+    }
+}
+
+void ActionStatsCollector::addDatagramResults(const ActionResult* results, std::size_t count) {
+    uint64_t sent = 0, would_block = 0, failed = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        sent += results[i] == ActionResult::complete;
+        would_block += results[i] == ActionResult::would_block;
+        failed += results[i] == ActionResult::failed;
+    }
+
+    if (sent) datagrams_sent_.fetch_add(sent, std::memory_order_relaxed);
+    if (would_block) would_block_.fetch_add(would_block, std::memory_order_relaxed);
+    if (failed) failures_.fetch_add(failed, std::memory_order_relaxed);
+}
+
+ActionStatsCollector::ActionIdCounter& ActionStatsCollector::counterFor(uint16_t action_id) {
+    const uint32_t key = (uint32_t)action_id + 1;
+    for (int i = 0; i < k_action_id_slots; ++i) {
+        uint32_t slot_key = action_ids_[i].key.load(std::memory_order_acquire);
+        if (slot_key == 0 && action_ids_[i].key.compare_exchange_strong(slot_key, key, std::memory_order_acq_rel)) {
+            return action_ids_[i];
+        }
+        if (slot_key == key) return action_ids_[i];
+    }
+
+    return other_actions_;
+}
+
+void ActionStatsCollector::addActions(const uint8_t* data, std::size_t size) {
+    std::size_t idx = 0;
+    while (idx + sizeof(SC_API_PROTOCOL_ActionHeader_t) <= size) {
+        SC_API_PROTOCOL_ActionHeader_t hdr;
+        std::memcpy(&hdr, data + idx, sizeof(hdr));
+        if (hdr.size < sizeof(hdr)) break;
+
+        ActionIdCounter& counter = counterFor(hdr.action_id);
+        counter.actions.fetch_add(1, std::memory_order_relaxed);
+        counter.bytes.fetch_add(hdr.size, std::memory_order_relaxed);
+        idx += hdr.size;
+    }
+}
+
+ActionStats ActionStatsCollector::snapshot() const {
+    ActionStats s;
+    build_.copyTo(s.build);
+    encrypt_.copyTo(s.encrypt);
+    send_.copyTo(s.send);
+    s.datagrams_sent = datagrams_sent_.load(std::memory_order_relaxed);
+    s.would_block    = would_block_.load(std::memory_order_relaxed);
+    s.failures       = failures_.load(std::memory_order_relaxed);
+
+    for (const ActionIdCounter& c : action_ids_) {
+        const uint32_t key = c.key.load(std::memory_order_acquire);
+        if (key == 0) continue;
+
+        ActionIdStats id_stats;
+        id_stats.action_id = (uint16_t)(key - 1);
+        id_stats.actions   = c.actions.load(std::memory_order_relaxed);
+        id_stats.bytes     = c.bytes.load(std::memory_order_relaxed);
+        s.actions.push_back(id_stats);
+    }
+
+    const uint64_t other = other_actions_.actions.load(std::memory_order_relaxed);
+    if (other != 0) {
+        ActionIdStats id_stats;
+        id_stats.action_id = ActionIdStats::k_other;
+        id_stats.actions   = other;
+        id_stats.bytes     = other_actions_.bytes.load(std::memory_order_relaxed);
+        s.actions.push_back(id_stats);
+    }
+    return s;
+}
+
+void ActionStatsCollector::reset() {
+    build_.reset();
+    encrypt_.reset();
+    send_.reset();
+    datagrams_sent_.store(0, std::memory_order_relaxed);
+    would_block_.store(0, std::memory_order_relaxed);
+    failures_.store(0, std::memory_order_relaxed);
+
+    // Slot ids are kept so that concurrent senders never see a slot changing owner
+    for (ActionIdCounter& c : action_ids_) {
+        c.actions.store(0, std::memory_order_relaxed);
+        c.bytes.store(0, std::memory_order_relaxed);
+    }
+    other_actions_.actions.store(0, std::memory_order_relaxed);
+    other_actions_.bytes.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace sc_api::core::internal
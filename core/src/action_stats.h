@@ -0,0 +1,81 @@
+/**
+ * @file
+ * @brief Opt-in statistics of the action send path
+ *
+ */
+
+#ifndef SC_API_INTERNAL_ACTION_STATS_H_
+#define SC_API_INTERNAL_ACTION_STATS_H_
+#include <atomic>
+#include <cstdint>
+
+#include "sc-api/core/action.h"
+#include "sc-api/core/time.h"
+
+namespace sc_api::core::internal {
+
+/** Power of two bucket histogram of durations that can be recorded from any thread without locks */
+class LatencyHistogram {
+public:
+    void record(int64_t ns);
+    void copyTo(ActionLatencyStats& out) const;
+    void reset();
+
+private:
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> total_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+    std::atomic<uint64_t> buckets_[ActionLatencyStats::k_bucket_count] = {};
+};
+
+/** Collects ActionStats from any number of sending threads without locks
+ *
+ * Counters are relaxed atomics, so a snapshot taken during sending may be slightly inconsistent between counters.
+ */
+class ActionStatsCollector {
+public:
+    static int64_t now() { return Clock::now().time_since_epoch().count(); }
+
+    void recordBuild(int64_t ns) { build_.record(ns); }
+    void recordEncrypt(int64_t ns) { encrypt_.record(ns); }
+    void recordSend(int64_t ns) { send_.record(ns); }
+
+    void addDatagramResult(ActionResult result);
+    void addDatagramResults(const ActionResult* results, std::size_t count);
+
+    /** Count all actions in the given buffer of back to back actions */
+    void addActions(const uint8_t* data, std::size_t size);
+
+    ActionStats snapshot() const;
+    void        reset();
+
+private:
+    struct ActionIdCounter {
+        /** Action id + 1 so that zero marks a free slot */
+        std::atomic<uint32_t> key{0};
+        std::atomic<uint64_t> actions{0};
+        std::atomic<uint64_t> bytes{0};
+    };
+
+    /** Only a handful of action ids exist, so ids that don't fit are counted to other_actions_ */
+    static constexpr int k_action_id_slots = 16;
+
+    ActionIdCounter& counterFor(uint16_t action_id);
+
+    LatencyHistogram build_;
+    LatencyHistogram encrypt_;
+    LatencyHistogram send_;
+
+    std::atomic<uint64_t> datagrams_sent_{0};
+    std::atomic<uint64_t> would_block_{0};
+    std::atomic<uint64_t> failures_{0};
+
+    ActionIdCounter action_ids_[k_action_id_slots];
+
+    /** Reported as ActionIdStats::k_other. key isn't used */
+    ActionIdCounter other_actions_;
+};
+
+}  // namespace sc_api::core::internal
+
+#endif  // SC_API_INTERNAL_ACTION_STATS_H_
@@ -37,6 +37,9 @@ ApiCore::Impl::~Impl() {
 }
 
 ResultCode ApiCore::Impl::openSession() {
+    // Calibrate clock before any time critical code reads it
+    clock_source::initialize();
+
     std::lock_guard lock(m_);
     if (session_state_ != Session::State::invalid) return ResultCode::error_invalid_session_state;
 
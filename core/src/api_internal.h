@@ -3,17 +3,26 @@
 #include <asio.hpp>
 #include <asio/ip/tcp.hpp>
 #include <asio/ip/udp.hpp>
+#include <atomic>
 #include <chrono>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "action_sender.h"
+#include "action_stats.h"
 #include "compatibility.h"
 #include "device_info_internal.h"
+#include "sc-api/core/action.h"
 #include "sc-api/core/api_core.h"
 #include "sc-api/core/protocol/core.h"
 #include "sc-api/core/variables.h"
 #include "sim_data_internal.h"
+#ifdef SC_API_IO_URING
+#include "uring_transport.h"
+#endif
 #include "telemetry_internal.h"
 #include "variables_internal.h"
 
@@ -40,6 +49,46 @@ struct Session::Internal {
     asio::ip::udp::endpoint high_priority_socket_target;
     asio::ip::udp::socket   high_priority_socket{io_ctx};
 
+    /** Buffer that holds action data while asynchronous send is in progress */
+    struct AsyncSendBuffer {
+        std::vector<uint8_t>     data;
+        std::atomic<std::size_t> remaining{0};
+        std::atomic_bool         failed{false};
+    };
+
+    /** Send buffers are recycled so that steady state asynchronous sends don't need heap allocations */
+    std::mutex                                    send_buffer_pool_mutex;
+    std::vector<std::unique_ptr<AsyncSendBuffer>> send_buffers;
+    std::vector<AsyncSendBuffer*>                 free_send_buffers;
+
+#ifdef SC_API_IO_URING
+    /** Used instead of the socket send calls when the running kernel supports it. Protected by high_prio_mutex */
+    std::unique_ptr<internal::UringTransport> uring_transport;
+#endif
+    std::atomic_bool batch_transport_active{false};
+
+    /** Optional dedicated sender thread. Declared after the socket so that it is stopped before the socket closes */
+    std::unique_ptr<internal::ActionSender> action_sender;
+    std::atomic<internal::ActionSender*>    active_action_sender{nullptr};
+
+    /** Producers that are currently using active_action_sender. See internal::ActionSenderUse */
+    std::atomic<uint32_t> action_sender_users{0};
+    uint64_t              action_sender_generation = 0;
+
+    /** Action send statistics. Collector is kept until the session is freed once statistics have been enabled */
+    std::unique_ptr<internal::ActionStatsCollector> action_stats_storage;
+    std::atomic<internal::ActionStatsCollector*>    action_stats{nullptr};
+
+    /** Active statistics collector or nullptr, if statistics aren't collected */
+    internal::ActionStatsCollector* actionStats() const { return action_stats.load(std::memory_order_acquire); }
+
+    /** Recorder of the built effect actions. Storage keeps the recorder alive while it is in use */
+    std::shared_ptr<EffectRecorder> effect_recorder_storage;
+    std::atomic<EffectRecorder*>    effect_recorder{nullptr};
+
+    /** Active effect recorder or nullptr, if effects aren't recorded */
+    EffectRecorder* effectRecorder() const { return effect_recorder.load(std::memory_order_acquire); }
+
     asio::ip::tcp::socket                                                   main_socket{io_ctx};
     std::vector<std::vector<uint8_t>>                                       main_socket_tx_queue;
     std::unordered_map<int, std::function<void(const AsyncCommandResult&)>> command_result_handlers;
@@ -57,6 +106,11 @@ struct Session::Internal {
     std::unordered_map<int32_t, asio::steady_timer> periodic_timers;
     int32_t                                         periodic_timer_id_counter = 0;
 
+    /** Timers whose callback is running and the thread that runs it. PeriodicTimerHandle::destroy waits for the
+     * callback to return, unless it is called from the callback */
+    std::unordered_map<int32_t, std::thread::id> running_periodic_timers;
+    std::condition_variable                      periodic_timer_cv;
+
     std::shared_ptr<util::EventProducer<Event>> api_event_producer_;
 
     internal::SimDataProvider sim_data_provider;
@@ -66,6 +120,34 @@ struct Session::Internal {
 
     bool sendHighPrio(const char* raw_data, std::size_t length);
 
+    /** Single datagrams should also be sent through sendHighPrioBatch because it uses a faster transport */
+    bool preferBatchSend() const { return batch_transport_active.load(std::memory_order_relaxed); }
+
+    AsyncSendBuffer* acquireSendBuffer();
+    void             releaseSendBuffer(AsyncSendBuffer* buffer);
+
+    /** Largest datagram size that backend accepts for plaintext actions */
+    uint32_t maxPlaintextDatagramSize() const {
+        return udp_max_plaintext_payload != 0 ? udp_max_plaintext_payload
+                                              : SC_API_PROTOCOL_UDP_CONTROL_MIN_PLAINTEXT_PACKET_SIZE_LIMIT;
+    }
+
+    /** Largest datagram size that backend accepts if it contains any encrypted actions */
+    uint32_t maxEncryptedDatagramSize() const {
+        return udp_max_encrypted_payload != 0 ? udp_max_encrypted_payload
+                                              : SC_API_PROTOCOL_UDP_CONTROL_MIN_ENCRYPTED_PACKET_SIZE_LIMIT;
+    }
+
+    /** Send multiple datagrams that are stored back to back in data without blocking
+     *
+     * @param data Buffer that contains all datagrams
+     * @param datagram_ends End offset of each datagram in the data buffer
+     * @param count Number of datagrams
+     * @param[out] results Result of each datagram. Must have space for count entries
+     */
+    void sendHighPrioBatch(const uint8_t* data, const uint32_t* datagram_ends, std::size_t count,
+                           ActionResult* results);
+
     bool startSendCommand(std::vector<uint8_t> tx_data, int32_t cmd_id,
                           std::function<void(const AsyncCommandResult&)> cb);
     void startNextSend();
@@ -74,7 +156,10 @@ struct Session::Internal {
     void tryParsePacket();
     void parsePacket(const uint8_t* data, int32_t size);
 
-    void startPeriodicTimer(asio::steady_timer& timer, std::chrono::milliseconds period, std::function<void()>&& cb);
+    /** Timer is looked up by id before and after each callback, because it may have been destroyed while the
+     * expired handler was queued or by the callback itself */
+    void startPeriodicTimer(asio::steady_timer& timer, int32_t id, std::chrono::milliseconds period,
+                            std::function<void()>&& cb);
 };
 
 class ApiCore::Impl {
@@ -5,14 +5,40 @@
 #include <Windows.h>
 #include <winnt.h>
 #else
+#include <fcntl.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+
+#include <string>
 #define INVALID_HANDLE_VALUE nullptr
 #endif
+#include <algorithm>
 #include <cstdlib>
 
 namespace sc_api::core::internal {
 
+#ifndef _WIN32
+namespace {
+
+/** POSIX shared memory object names must start with a slash, but Windows file mapping names used in the protocol
+ * don't have it. Same path strings are used on both platforms so that backend can publish identical references.
+ */
+std::string toPosixShmName(const char* path) {
+    std::string name;
+    if (path[0] != '/') name.push_back('/');
+    name.append(path);
+    return name;
+}
+
+}  // namespace
+#endif
+
 // NOLINTBEGIN(readability-convert-member-functions-to-static)
 
 SharedMemory::SharedMemory() noexcept : shm_handle_(INVALID_HANDLE_VALUE), shm_buffer_(nullptr) {}
@@ -45,7 +71,12 @@ bool SharedMemory::openForReadOnly(const char* path, uint32_t size) {
 
     return mapBufferOrClose(size, FILE_MAP_READ);
 #else
-    return false;
+    shm_fd_ = shm_open(toPosixShmName(path).c_str(), O_RDONLY, 0);
+    if (shm_fd_ < 0) {
+        return false;
+    }
+
+    return mapBufferOrClose(size, PROT_READ);
 #endif
 }
 
@@ -64,7 +95,12 @@ bool SharedMemory::openForReadWrite(const char *path, size_t size)
 
     return mapBufferOrClose(size, FILE_MAP_ALL_ACCESS);
 #else
-    return false;
+    shm_fd_ = shm_open(toPosixShmName(path).c_str(), O_RDWR, 0);
+    if (shm_fd_ < 0) {
+        return false;
+    }
+
+    return mapBufferOrClose(size, PROT_READ | PROT_WRITE);
 #endif
 }
 
@@ -86,7 +122,21 @@ bool SharedMemory::createForReadWrite(const char *path, size_t size)
 
     return mapBufferOrClose(size, FILE_MAP_ALL_ACCESS);
 #else
-    return false;
+    // Same semantics as CreateFileMappingA: existing object is opened instead of failing, but it is grown to the
+    // requested size if it is smaller
+    shm_fd_ = shm_open(toPosixShmName(path).c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    if (shm_fd_ < 0) {
+        return false;
+    }
+
+    struct stat st {};
+    if (fstat(shm_fd_, &st) != 0 || ((std::size_t)st.st_size < size && ftruncate(shm_fd_, (off_t)size) != 0)) {
+        ::close(shm_fd_);
+        shm_fd_ = -1;
+        return false;
+    }
+
+    return mapBufferOrClose(size, PROT_READ | PROT_WRITE);
 #endif
 }
 
@@ -99,7 +149,8 @@ bool SharedMemory::openOrCreateForReadWrite(const char *path, size_t size)
 
     return openForReadWrite(path, size);
 #else
-    return false;
+    // createForReadWrite already opens existing objects
+    return createForReadWrite(path, size);
 #endif
 }
 
@@ -116,6 +167,21 @@ void SharedMemory::close()
         shm_handle_ = INVALID_HANDLE_VALUE;
     }
     size_ = 0;
+#else
+    if (shm_buffer_) {
+        munmap(shm_buffer_, size_);
+        shm_buffer_ = nullptr;
+    }
+    size_ = 0;
+#endif
+}
+
+bool SharedMemory::remove(const char* path) {
+#ifdef _WIN32
+    (void)path;
+    return true;
+#else
+    return shm_unlink(toPosixShmName(path).c_str()) == 0;
 #endif
 }
 
@@ -133,7 +199,188 @@ bool SharedMemory::mapBufferOrClose(size_t size, uint32_t access)
     size_ = (uint32_t)size;
     return true;
 #else
-    return false;
+    struct stat st {};
+    if (fstat(shm_fd_, &st) != 0) {
+        ::close(shm_fd_);
+        shm_fd_ = -1;
+        return false;
+    }
+
+    // MapViewOfFile maps the whole object when size is 0, do the same here
+    if (size == 0) {
+        size = (std::size_t)st.st_size;
+    }
+
+    // Mapping past the end of the object would cause SIGBUS when the pages are touched
+    if (size == 0 || (std::size_t)st.st_size < size) {
+        ::close(shm_fd_);
+        shm_fd_ = -1;
+        return false;
+    }
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    // Prefault the pages so that first reads in the data paths don't take page faults
+    flags |= MAP_POPULATE;
+#endif
+
+    void* buf = mmap(nullptr, size, (int)access, flags, shm_fd_, 0);
+
+    // Mapping keeps the shared memory object alive so the descriptor isn't needed anymore
+    ::close(shm_fd_);
+    shm_fd_ = -1;
+
+    if (buf == MAP_FAILED) {
+        return false;
+    }
+
+#if defined(SC_API_SHM_HUGEPAGES) && defined(MADV_HUGEPAGE)
+    // Only a hint, requires /sys/kernel/mm/transparent_hugepage/shmem_enabled to be "advise" or "always"
+    madvise(buf, size, MADV_HUGEPAGE);
+#endif
+
+    shm_buffer_ = buf;
+    size_       = (uint32_t)size;
+    return true;
+#endif
+}
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::create(const char* path, std::size_t size) {
+    close();
+    if (size == 0) return false;
+
+    writable_ = true;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    file_handle_ = file;
+#else
+    fd_ = ::open(path, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd_ < 0) return false;
+#endif
+    if (!resize(size)) {
+        close(0);
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::openForReadOnly(const char* path) {
+    close();
+
+    writable_ = false;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    file_handle_ = file;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || !map((std::size_t)file_size.QuadPart)) {
+        close();
+        return false;
+    }
+#else
+    fd_ = ::open(path, O_RDONLY);
+    if (fd_ < 0) return false;
+
+    struct stat st {};
+    if (fstat(fd_, &st) != 0 || !map((std::size_t)st.st_size)) {
+        close();
+        return false;
+    }
+#endif
+    return true;
+}
+
+bool MappedFile::resize(std::size_t size) {
+    if (!writable_ || size == 0) return false;
+
+    // Current mapping is replaced only after the new one exists, so it stays usable if growing fails
+    void* const       old_buffer = buffer_;
+    const std::size_t old_size   = size_;
+#ifdef _WIN32
+    if (!file_handle_) return false;
+    if (size < old_size) {
+        // File that has a mapped view can't be truncated
+        unmap();
+        LARGE_INTEGER file_size;
+        file_size.QuadPart = (LONGLONG)size;
+        if (!SetFilePointerEx(file_handle_, file_size, NULL, FILE_BEGIN) || !SetEndOfFile(file_handle_)) return false;
+        return map(size);
+    }
+    // Mapping object that is larger than the file extends it
+#else
+    if (fd_ < 0 || ftruncate(fd_, (off_t)size) != 0) return false;
+#endif
+    if (!map(size)) return false;
+
+    unmapView(old_buffer, old_size);
+    return true;
+}
+
+bool MappedFile::map(std::size_t size) {
+    if (size == 0) return false;
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(file_handle_, NULL, writable_ ? PAGE_READWRITE : PAGE_READONLY,
+                                        (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+    if (!mapping) return false;
+
+    void* buf = MapViewOfFile(mapping, writable_ ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, size);
+
+    // View keeps the mapping object alive
+    CloseHandle(mapping);
+    if (!buf) return false;
+#else
+    void* buf = mmap(nullptr, size, writable_ ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd_, 0);
+    if (buf == MAP_FAILED) return false;
+#endif
+    buffer_ = buf;
+    size_   = size;
+    return true;
+}
+
+void MappedFile::unmap() {
+    unmapView(buffer_, size_);
+    buffer_ = nullptr;
+    size_   = 0;
+}
+
+void MappedFile::unmapView(void* buffer, std::size_t size) {
+    if (!buffer) return;
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(buffer);
+#else
+    munmap(buffer, size);
+#endif
+}
+
+void MappedFile::close(std::size_t final_size) {
+    const std::size_t mapped_size = size_;
+    unmap();
+#ifdef _WIN32
+    if (file_handle_) {
+        if (writable_ && final_size < mapped_size) {
+            LARGE_INTEGER file_size;
+            file_size.QuadPart = (LONGLONG)final_size;
+            SetFilePointerEx(file_handle_, file_size, NULL, FILE_BEGIN);
+            SetEndOfFile(file_handle_);
+        }
+        CloseHandle(file_handle_);
+        file_handle_ = nullptr;
+    }
+#else
+    if (fd_ >= 0) {
+        if (writable_ && final_size < mapped_size && ftruncate(fd_, (off_t)final_size) != 0) {
+            // File keeps the unused tail, readers use the size in the file header
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
 #endif
 }
 
@@ -179,6 +426,35 @@ uint32_t getCurrentProcessId()
 #endif
 }
 
+bool setCurrentThreadAffinity(int cpu) {
+    if (cpu < 0) return false;
+#if defined(_WIN32)
+    if (cpu >= (int)(sizeof(DWORD_PTR) * 8)) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+    if (cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+bool setCurrentThreadRealtimePriority(int priority) {
+    if (priority <= 0) return false;
+#if defined(_WIN32)
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+#elif defined(__linux__)
+    sched_param param{};
+    param.sched_priority = std::clamp(priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#else
+    return false;
+#endif
+}
+
 void* alignedAlloc(std::size_t alignment, std::size_t size) {
     size = (size + alignment - 1) & ~(alignment - 1);
 
@@ -7,6 +7,7 @@
 #ifndef SC_API_INTERNAL_COMPATIBILITYR_H_
 #define SC_API_INTERNAL_COMPATIBILITYR_H_
 #include <atomic>
+#include <cstdint>
 #include <memory>
 
 #include "sc-api/core/protocol/core.h"
@@ -38,6 +39,13 @@ public:
     bool openOrCreateForReadWrite(const char* path, std::size_t size);
     void close();
 
+    /** Remove the shared memory object name so that it can't be opened anymore
+     *
+     * Existing mappings stay valid. Only needed on POSIX systems as Windows file mappings are destroyed when the last
+     * handle is closed, so this is a no-op there.
+     */
+    static bool remove(const char* path);
+
     bool isOpen() const { return shm_buffer_ != nullptr; }
 
     void* getBuffer() const { return shm_buffer_; }
@@ -50,6 +58,60 @@ protected:
     void*    shm_handle_;
     void*    shm_buffer_;
     uint32_t size_ = 0;
+#ifndef _WIN32
+    /** File descriptor from shm_open. Only valid between opening and mapBufferOrClose, mapping stays valid after the
+     * descriptor has been closed */
+    int shm_fd_    = -1;
+#endif
+};
+
+/** Memory mapped regular file
+ *
+ * Writable files are grown by remapping, so pointers to the buffer are invalidated by resize.
+ */
+class MappedFile {
+public:
+    MappedFile() noexcept = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /** Create or truncate file and map size bytes of it for reading and writing */
+    bool create(const char* path, std::size_t size);
+
+    /** Map the whole existing file for reading */
+    bool openForReadOnly(const char* path);
+
+    /** Grow or shrink writable file and map it again
+     *
+     * If growing fails, the current mapping is kept.
+     */
+    bool resize(std::size_t size);
+
+    /** Unmap and close the file. Writable file is truncated to final_size first, if it is smaller than the mapping */
+    void close(std::size_t final_size = SIZE_MAX);
+
+    bool isOpen() const { return buffer_ != nullptr; }
+
+    void* getBuffer() const { return buffer_; }
+
+    std::size_t getSize() const { return size_; }
+
+private:
+    /** Map size bytes of the file. buffer_ and size_ are replaced only on success, without unmapping the old view */
+    bool map(std::size_t size);
+    void unmap();
+
+    static void unmapView(void* buffer, std::size_t size);
+
+    void*       buffer_   = nullptr;
+    std::size_t size_     = 0;
+    bool        writable_ = false;
+#ifdef _WIN32
+    void* file_handle_    = nullptr;
+#else
+    int fd_               = -1;
+#endif
 };
 
 class ShmBlock {
@@ -127,6 +189,19 @@ static bool shmTryAtomicDataAccess(const SC_API_PROTOCOL_ShmBlockHeader_t* shm_b
 
 uint32_t getCurrentProcessId();
 
+/** Pin calling thread to the given CPU core
+ *
+ * @return false, if pinning failed or is not supported on this platform
+ */
+bool setCurrentThreadAffinity(int cpu);
+
+/** Raise calling thread to realtime scheduling. SCHED_FIFO with the given priority on Linux and time critical
+ * priority on Windows
+ *
+ * @return false, if it failed, which usually means missing privileges, or is not supported on this platform
+ */
+bool setCurrentThreadRealtimePriority(int priority);
+
 }  // namespace sc_api::core::internal
 
 #endif  // SC_API_INTERNAL_COMPATIBILITYR_H_
@@ -0,0 +1,32 @@
+/**
+ * @file
+ * @brief Payload layouts of the effect actions
+ *
+ */
+
+#ifndef SC_API_INTERNAL_EFFECT_ACTION_H_
+#define SC_API_INTERNAL_EFFECT_ACTION_H_
+#include <cstdint>
+
+#include "sc-api/core/protocol/actions.h"
+
+namespace sc_api::core::internal {
+
+/** Plaintext part of SC_API_PROTOCOL_ACTION_FB_EFFECT payload. Followed by the samples. When the action is encrypted,
+ * this is preceded by SC_API_PROTOCOL_EncryptedActionHeader_t */
+struct EffectHeader {
+    SC_API_PROTOCOL_ActionFbEffect_AAD_s aad;
+    uint16_t                             device;
+    SC_API_PROTOCOL_ActionFbEffect_Enc_t data;
+};
+
+/** SC_API_PROTOCOL_ACTION_FB_EFFECT_CLEAR payload. Never encrypted */
+struct EffectClearPayload {
+    SC_API_PROTOCOL_ActionFbEffect_AAD_s aad;
+    uint16_t                             device;
+    SC_API_PROTOCOL_ActionFbClear_Enc_t  data;
+};
+
+}  // namespace sc_api::core::internal
+
+#endif  // SC_API_INTERNAL_EFFECT_ACTION_H_
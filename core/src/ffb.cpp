@@ -1,39 +1,56 @@
 #include "sc-api/core/ffb.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <functional>
 
+#include "api_internal.h"
 #include "crypto/gcm.h"
+#include "effect_action.h"
+#include "sample_quantization.h"
 #include "sc-api/core/command.h"
+#include "sc-api/core/ffb_recorder.h"
 #include "sc-api/core/protocol/actions.h"
 #include "sc-api/core/session.h"
 #include "sc-api/core/util/bson_reader.h"
 
 namespace sc_api::core {
 
-bool buildEffectOffsetDataAction(ActionBuilder& builder, EffectPipelineRef pipeline, Clock::time_point timestamp,
-                                 Clock::duration sample_time, const float* samples, unsigned sample_count) {
-    if (sample_count == 0 || sample_count > 256) return false;
+namespace {
 
-    struct Header {
-        SC_API_PROTOCOL_ActionFbEffect_AAD_s aad;
-        uint16_t                             device;
-        SC_API_PROTOCOL_ActionFbEffect_Enc_t data;
-    };
+uint8_t toProtocolSampleFormat(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::i16:
+            return SC_API_PROTOCOL_FB_SAMPLE_FORMAT_I16;
+        case SampleFormat::u16:
+            return SC_API_PROTOCOL_FB_SAMPLE_FORMAT_U16;
+        case SampleFormat::f32:
+            break;
+    }
+    return SC_API_PROTOCOL_FB_SAMPLE_FORMAT_F32;
+}
 
-    uint8_t* payload                       = nullptr;
+uint32_t sampleSize(SampleFormat format) { return format == SampleFormat::f32 ? sizeof(float) : sizeof(uint16_t); }
 
-    Header* hdr                            = nullptr;
+using internal::EffectHeader;
 
-    uint32_t samples_size                  = sizeof(float) * sample_count;
+}  // namespace
 
-    bool                    encrypt        = false;
-    SecureSessionInterface* secure_session = builder.getSession()->getSecureSession();
+bool EffectSampleWriter::begin(ActionBuilder& builder, EffectPipelineRef pipeline, Clock::time_point timestamp,
+                               Clock::duration sample_time, unsigned sample_count, SampleFormat format, float gain) {
+    builder_ = nullptr;
+    if (sample_count == 0 || sample_count > 256) return false;
+    if (format != SampleFormat::f32 && gain == 0.0f) return false;
 
-    if (secure_session) {
-        encrypt = true;
-    }
+    uint8_t*      payload                  = nullptr;
+    EffectHeader* hdr                      = nullptr;
+
+    const uint32_t data_size               = sampleSize(format) * sample_count;
+    uint32_t       samples_size            = data_size;
+
+    SecureSessionInterface* secure_session = builder.getSession()->getSecureSession();
+    const bool              encrypt        = secure_session != nullptr;
 
     if (encrypt) {
         if (samples_size % 16 > 0) {
@@ -42,20 +59,20 @@ bool buildEffectOffsetDataAction(ActionBuilder& builder, EffectPipelineRef pipel
 
         payload =
             builder.startBuilding(SC_API_PROTOCOL_ACTION_FB_EFFECT,
-                                  sizeof(Header) + samples_size + sizeof(SC_API_PROTOCOL_EncryptedActionHeader_t) +
+                                  sizeof(EffectHeader) + samples_size +
+                                      sizeof(SC_API_PROTOCOL_EncryptedActionHeader_t) +
                                       sizeof(SC_API_PROTOCOL_EncryptedActionFooter_t),
                                   SC_API_PROTOCOL_ACTION_FLAG_ENCRYPTED);
 
         if (!payload) return false;
 
-        hdr = new (payload + sizeof(SC_API_PROTOCOL_EncryptedActionHeader_t)) Header();
+        hdr = new (payload + sizeof(SC_API_PROTOCOL_EncryptedActionHeader_t)) EffectHeader();
     } else {
-        payload =
-            builder.startBuilding(SC_API_PROTOCOL_ACTION_FB_EFFECT, sizeof(Header) + sizeof(float) * sample_count);
+        payload = builder.startBuilding(SC_API_PROTOCOL_ACTION_FB_EFFECT, sizeof(EffectHeader) + samples_size);
 
         if (!payload) return false;
 
-        hdr = new (payload) Header();
+        hdr = new (payload) EffectHeader();
     }
 
     hdr->aad.fb_pipeline_idx       = pipeline.pipeline_id;
@@ -63,7 +80,7 @@ bool buildEffectOffsetDataAction(ActionBuilder& builder, EffectPipelineRef pipel
 
     hdr->device                    = pipeline.device_logical_id;
 
-    hdr->data.sample_format        = SC_API_PROTOCOL_FB_SAMPLE_FORMAT_F32;
+    hdr->data.sample_format        = toProtocolSampleFormat(format);
     hdr->data.sample_count_minus_1 = sample_count - 1;
     int64_t raw_timestamp          = timestamp.time_since_epoch().count();
     hdr->data.start_time_low       = raw_timestamp & 0xffffffffu;
@@ -71,50 +88,102 @@ bool buildEffectOffsetDataAction(ActionBuilder& builder, EffectPipelineRef pipel
     hdr->data.sample_duration      = sample_time.count() & 0xffffffff;
     hdr->data.sample_duration_high = (sample_time.count() >> 32) & 0xff;
 
+    builder_                       = &builder;
+    payload_                       = payload;
+    sample_data_                   = (uint8_t*)hdr + sizeof(EffectHeader);
+    sample_count_                  = sample_count;
+    padded_size_                   = encrypt ? samples_size : 0;
+    format_                        = format;
+    gain_                          = gain;
+
     if (encrypt) {
-        std::memcpy(&payload[sizeof(SC_API_PROTOCOL_EncryptedActionHeader_t) + sizeof(Header)], samples, samples_size);
-        secure_session->encrypt(payload, (uint8_t*)&hdr->aad, sizeof(SC_API_PROTOCOL_ActionFbEffect_AAD_t),
-                                (uint8_t*)&hdr->data, sizeof(SC_API_PROTOCOL_ActionFbEffect_Enc_t) + samples_size,
-                                (uint8_t*)&hdr->data + sizeof(SC_API_PROTOCOL_ActionFbEffect_Enc_t) + samples_size);
-    } else {
-        std::memcpy(&payload[sizeof(Header)], samples, samples_size);
+        // Padding of the encrypted data
+        std::memset(sample_data_ + data_size, 0, samples_size - data_size);
     }
+    return true;
+}
 
+void EffectSampleWriter::writeSamples(unsigned offset, const float* samples, unsigned count) {
+    assert(builder_ && offset + count <= sample_count_);
+    uint8_t* out = sample_data_ + offset * sampleSize(format_);
+    switch (format_) {
+        case SampleFormat::f32:
+            std::memcpy(out, samples, count * sizeof(float));
+            break;
+        case SampleFormat::i16:
+            internal::quantizeToI16(samples, count, 32767.0f / gain_, out);
+            break;
+        case SampleFormat::u16:
+            internal::quantizeToU16(samples, count, 65535.0f / gain_, out);
+            break;
+    }
+}
+
+bool EffectSampleWriter::finish() {
+    if (!builder_) return false;
+
+    ActionBuilder& builder = *builder_;
+    builder_               = nullptr;
+
+    const bool    encrypt  = padded_size_ != 0;
+    EffectHeader* hdr      = (EffectHeader*)(encrypt ? payload_ + sizeof(SC_API_PROTOCOL_EncryptedActionHeader_t)
+                                                     : payload_);
+
+    // Recorded before encryption, so that recordings can be replayed with any session
+    if (EffectRecorder* recorder = builder.getSession()->getInternal().effectRecorder()) {
+        recorder->record(SC_API_PROTOCOL_ACTION_FB_EFFECT, (const uint8_t*)hdr,
+                         sizeof(EffectHeader) + sample_count_ * sampleSize(format_));
+    }
+
+    if (!encrypt) return true;
+
+    SecureSessionInterface* secure_session = builder.getSession()->getSecureSession();
+    if (!secure_session) return false;
+
+    internal::ActionStatsCollector* stats = builder.getSession()->getInternal().actionStats();
+    const int64_t                   start = stats ? internal::ActionStatsCollector::now() : 0;
+    secure_session->encrypt(payload_, (uint8_t*)&hdr->aad, sizeof(SC_API_PROTOCOL_ActionFbEffect_AAD_t),
+                            (uint8_t*)&hdr->data, sizeof(SC_API_PROTOCOL_ActionFbEffect_Enc_t) + padded_size_,
+                            (uint8_t*)&hdr->data + sizeof(SC_API_PROTOCOL_ActionFbEffect_Enc_t) + padded_size_);
+    if (stats) stats->recordEncrypt(internal::ActionStatsCollector::now() - start);
     return true;
 }
 
+bool buildEffectOffsetDataAction(ActionBuilder& builder, EffectPipelineRef pipeline, Clock::time_point timestamp,
+                                 Clock::duration sample_time, const float* samples, unsigned sample_count,
+                                 SampleFormat format, float gain) {
+    EffectSampleWriter writer;
+    if (!writer.begin(builder, pipeline, timestamp, sample_time, sample_count, format, gain)) return false;
+
+    writer.writeSamples(0, samples, sample_count);
+    return writer.finish();
+}
+
 bool buildEffectClearAction(ActionBuilder& builder, EffectPipelineRef pipeline) {
-    struct Payload {
-        SC_API_PROTOCOL_ActionFbEffect_AAD_s aad;
-        uint16_t                             device;
-        SC_API_PROTOCOL_ActionFbClear_Enc_t  data;
-    } payload;
+    internal::EffectClearPayload payload{};
 
     payload.device                      = pipeline.device_logical_id;
     payload.data.cleared_pipeline_count = 1;
     payload.data.fb_pipelines[0]        = pipeline.pipeline_id;
 
-    uint8_t* payload_buf = builder.startBuilding(SC_API_PROTOCOL_ACTION_FB_EFFECT_CLEAR, sizeof(Payload));
+    uint8_t* payload_buf = builder.startBuilding(SC_API_PROTOCOL_ACTION_FB_EFFECT_CLEAR, sizeof(payload));
     if (!payload_buf) return false;
     std::memcpy(payload_buf, &payload, sizeof(payload));
-    return true;
-}
 
-FfbPipeline::FfbPipeline(const std::shared_ptr<Session>& session, DeviceSessionId device)
-    : action_builder_(session), device_(device) {
-    assert(device);
-}
-
-FfbPipeline::~FfbPipeline() {
-    if (isActive()) {
-        sc_api::core::CommandRequest req("ffb", "free_pipeline");
-        req.docAddElement("device_session_id", device_.id);
-        req.docAddElement("pipeline_id", pipeline_id_);
-        action_builder_.getSession()->asyncCommand(std::move(req), [](const sc_api::core::AsyncCommandResult&) {});
+    if (EffectRecorder* recorder = builder.getSession()->getInternal().effectRecorder()) {
+        recorder->record(SC_API_PROTOCOL_ACTION_FB_EFFECT_CLEAR, payload_buf, sizeof(payload));
     }
+    return true;
 }
 
-bool FfbPipeline::configure(const PipelineConfig& config) {
+namespace {
+
+/** Build configure_pipeline request
+ *
+ * @return false, if the configuration is invalid
+ */
+bool buildConfigureRequest(CommandRequest& req, DeviceSessionId device, int8_t pipeline_id,
+                           const PipelineConfig& config) {
     std::string offset_type_str, interpolation_type_str, filter_type_str;
 
     switch (config.offset_type) {
@@ -153,41 +222,237 @@ bool FfbPipeline::configure(const PipelineConfig& config) {
             break;
     }
 
-    CommandRequest req{"ffb", "configure_pipeline"};
-    req.docAddElement("device_session_id", device_.id);
+    req.initialize("ffb", "configure_pipeline");
+    req.docAddElement("device_session_id", device.id);
     req.docAddElement("offset_mode", offset_type_str);
     req.docAddElement("interpolation_mode", interpolation_type_str);
     req.docAddElement("filter_mode", filter_type_str);
     req.docAddElement("filter_parameter", config.filter_parameter);
 
-    if (pipeline_id_ >= 0) {
-        req.docAddElement("pipeline_id", pipeline_id_);
+    // 16-bit samples are relative to the full scale, so backend needs the gain to scale them back to offset units
+    if (config.sample_format != SampleFormat::f32) {
+        if (config.gain == 0.0f) return false;
+        req.docAddElement("gain", config.gain);
+    }
+
+    if (pipeline_id >= 0) {
+        req.docAddElement("pipeline_id", pipeline_id);
+    }
+    return true;
+}
+
+void buildFreeRequest(CommandRequest& req, DeviceSessionId device, int8_t pipeline_id) {
+    req.initialize("ffb", "free_pipeline");
+    req.docAddElement("device_session_id", device.id);
+    req.docAddElement("pipeline_id", pipeline_id);
+}
+
+int8_t getConfiguredPipelineId(const uint8_t* payload, std::size_t size) {
+    sc_api::core::util::BsonReader reader(payload, size);
+
+    int32_t pipeline_id = -1;
+    reader.tryFindAndGet("pipeline_id", pipeline_id);
+    return (int8_t)pipeline_id;
+}
+
+}  // namespace
+
+void FfbPipeline::freeIfReleased(State& state, const std::weak_ptr<Session>& weak_session, DeviceSessionId device) {
+    // Handle was destroyed while the command was in progress, so nobody else is going to free the pipeline
+    if (!state.released.load()) return;
+
+    const int8_t             pipeline_id = state.pipeline_id.exchange(-1);
+    std::shared_ptr<Session> session     = weak_session.lock();
+    if (pipeline_id >= 0 && session) {
+        CommandRequest req;
+        buildFreeRequest(req, device, pipeline_id);
+        session->asyncCommand(std::move(req), [](const AsyncCommandResult&) {});
+    }
+}
+
+FfbPipeline::FfbPipeline(const std::shared_ptr<Session>& session, DeviceSessionId device)
+    : action_builder_(session), device_(device), state_(std::make_shared<State>()) {
+    assert(device);
+}
+
+FfbPipeline::~FfbPipeline() {
+    state_->released.store(true);
+    const int8_t pipeline_id = state_->pipeline_id.exchange(-1);
+    if (pipeline_id >= 0 && action_builder_.getSession()->getState() == SessionState::connected_control) {
+        CommandRequest req;
+        buildFreeRequest(req, device_, pipeline_id);
+        action_builder_.getSession()->asyncCommand(std::move(req), [](const sc_api::core::AsyncCommandResult&) {});
     }
+}
+
+bool FfbPipeline::configure(const PipelineConfig& config) {
+    CommandRequest req;
+    if (!buildConfigureRequest(req, device_, getPipelineId(), config)) return false;
 
     sc_api::core::CommandResult result = action_builder_.getSession()->blockingCommand(std::move(req));
     if (result.isSuccess()) {
-        sc_api::core::util::BsonReader reader(result.getPayload().data(), result.getPayload().size());
+        // Pipeline is inactive while the configuration is replaced
+        state_->pipeline_id.store(-1, std::memory_order_release);
+        storeConfig(std::make_shared<const PipelineConfig>(config));
+        state_->pipeline_id.store(getConfiguredPipelineId(result.getPayload().data(), result.getPayload().size()),
+                                  std::memory_order_release);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+bool FfbPipeline::asyncConfigure(const PipelineConfig&                          config,
+                                 std::function<void(const AsyncCommandResult&)> result_cb) {
+    const int8_t   previous_id = getPipelineId();
+    CommandRequest req;
+    if (!buildConfigureRequest(req, device_, previous_id, config)) return false;
+
+    state_->pipeline_id.store(-1, std::memory_order_release);
+    std::shared_ptr<const PipelineConfig> previous_config = loadConfig();
+    storeConfig(std::make_shared<const PipelineConfig>(config));
+
+    auto on_result = [state = state_, weak_session = std::weak_ptr<Session>(action_builder_.getSession()),
+                      device = device_, previous_id, previous_config,
+                      cb = std::move(result_cb)](const AsyncCommandResult& r) {
+        if (r.isSuccess()) {
+            const uint8_t* payload = r.getPayload();
+            state->pipeline_id.store(
+                getConfiguredPipelineId(payload, sc_api::core::util::BsonReader::getTotalDocumentSize(payload)),
+                std::memory_order_release);
+        } else {
+            std::atomic_store(&state->config, previous_config);
+            state->pipeline_id.store(previous_id, std::memory_order_release);
+        }
+        freeIfReleased(*state, weak_session, device);
+
+        if (cb) cb(r);
+    };
 
-        int32_t pipeline_id = -1;
-        reader.tryFindAndGet("pipeline_id", pipeline_id);
+    if (!action_builder_.getSession()->asyncCommand(std::move(req), std::move(on_result))) {
+        storeConfig(std::move(previous_config));
+        state_->pipeline_id.store(previous_id, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
 
-        pipeline_id_ = (int8_t)pipeline_id;
-        config_      = config;
+bool FfbPipeline::asyncRemove(std::function<void(const AsyncCommandResult&)> result_cb) {
+    const int8_t previous_id = state_->pipeline_id.exchange(-1);
+    if (previous_id < 0) {
         return true;
-    } else {
+    }
+
+    auto on_result = [state = state_, weak_session = std::weak_ptr<Session>(action_builder_.getSession()),
+                      device = device_, previous_id, cb = std::move(result_cb)](const AsyncCommandResult& r) {
+        if (!r.isSuccess()) {
+            state->pipeline_id.store(previous_id, std::memory_order_release);
+            freeIfReleased(*state, weak_session, device);
+        }
+
+        if (cb) cb(r);
+    };
+
+    CommandRequest req;
+    buildFreeRequest(req, device_, previous_id);
+    if (!action_builder_.getSession()->asyncCommand(std::move(req), std::move(on_result))) {
+        state_->pipeline_id.store(previous_id, std::memory_order_release);
         return false;
     }
+    return true;
 }
 
 bool FfbPipeline::generateEffect(Clock::time_point start_timestamp, Clock::duration sample_time, const float* samples,
                                  unsigned sample_count) {
     assert(sample_count <= 256);
-    if (pipeline_id_ < 0) return false;
+    const int8_t pipeline_id = getPipelineId();
+    if (pipeline_id < 0) return false;
 
-    EffectPipelineRef ref = {device_.id, (uint8_t)pipeline_id_};
+    const std::shared_ptr<const PipelineConfig> config = loadConfig();
+    EffectPipelineRef                           ref    = {device_.id, (uint8_t)pipeline_id};
 
     if (!sc_api::core::buildEffectOffsetDataAction(action_builder_, ref, start_timestamp, sample_time, samples,
-                                             sample_count)) {
+                                                   sample_count, config->sample_format, config->gain)) {
+        return false;
+    }
+
+    return action_builder_.sendNonBlocking() == ActionResult::complete;
+}
+
+bool FfbPipeline::generateEffect(ActionBatch& batch, Clock::time_point start_timestamp, Clock::duration sample_time,
+                                 const float* samples, unsigned sample_count) {
+    assert(sample_count <= 256);
+    const int8_t pipeline_id = getPipelineId();
+    if (pipeline_id < 0) return false;
+
+    const std::shared_ptr<const PipelineConfig> config = loadConfig();
+    EffectPipelineRef                           ref    = {device_.id, (uint8_t)pipeline_id};
+
+    if (!sc_api::core::buildEffectOffsetDataAction(action_builder_, ref, start_timestamp, sample_time, samples,
+                                                   sample_count, config->sample_format, config->gain)) {
+        return false;
+    }
+
+    return batch.add(action_builder_);
+}
+
+bool FfbPipeline::generateEffectNow(Clock::duration sample_time, const float* samples, unsigned sample_count) {
+    if (!lead_time_ || sample_count == 0 || sample_count > 256 || sample_time.count() <= 0) return false;
+
+    const int8_t pipeline_id = getPipelineId();
+    if (pipeline_id < 0) return false;
+
+    const Clock::time_point now   = Clock::now();
+    const Clock::time_point start = lead_time_->getStartTimestamp(now);
+
+    // Hold the last sample until the next effect is expected to start
+    const auto     covered_count = (lead_time_->getEffectDuration() + sample_time - Clock::duration(1)) / sample_time;
+    const unsigned total_count   = (unsigned)std::clamp<int64_t>(covered_count, sample_count, 256);
+
+    const std::shared_ptr<const PipelineConfig> config = loadConfig();
+    EffectPipelineRef                           ref    = {device_.id, (uint8_t)pipeline_id};
+    EffectSampleWriter                          writer;
+    if (!writer.begin(action_builder_, ref, start, sample_time, total_count, config->sample_format, config->gain)) {
+        return false;
+    }
+    writer.writeSamples(0, samples, sample_count);
+    for (unsigned i = sample_count; i < total_count; ++i) {
+        writer.writeSamples(i, &samples[sample_count - 1], 1);
+    }
+    if (!writer.finish()) {
+        // Don't leave a half built action to be sent with the next effect
+        action_builder_.reset();
+        return false;
+    }
+
+    if (action_builder_.sendNonBlocking() != ActionResult::complete) {
+        lead_time_->recordSendFailure();
+        return false;
+    }
+    lead_time_->recordSend(now, start, Clock::now());
+    return true;
+}
+
+void FfbPipeline::enableLeadTimeControl(const LeadTimeConfig& config) {
+    lead_time_ = std::make_unique<LeadTimeController>(config);
+}
+
+void FfbPipeline::disableLeadTimeControl() { lead_time_.reset(); }
+
+bool FfbPipeline::beginEffect(EffectSampleWriter& writer, Clock::time_point start_timestamp,
+                              Clock::duration sample_time, unsigned sample_count) {
+    const int8_t pipeline_id = getPipelineId();
+    if (pipeline_id < 0) return false;
+
+    const std::shared_ptr<const PipelineConfig> config = loadConfig();
+    EffectPipelineRef                           ref    = {device_.id, (uint8_t)pipeline_id};
+    return writer.begin(action_builder_, ref, start_timestamp, sample_time, sample_count, config->sample_format,
+                        config->gain);
+}
+
+bool FfbPipeline::sendEffect(EffectSampleWriter& writer) {
+    if (!writer.finish()) {
+        action_builder_.reset();
         return false;
     }
 
@@ -195,30 +460,112 @@ bool FfbPipeline::generateEffect(Clock::time_point start_timestamp, Clock::durat
 }
 
 bool FfbPipeline::stop() {
-    if (pipeline_id_ < 0) return false;
+    const int8_t pipeline_id = getPipelineId();
+    if (pipeline_id < 0) return false;
 
-    EffectPipelineRef ref = {device_.id, (uint8_t)pipeline_id_};
+    EffectPipelineRef ref = {device_.id, (uint8_t)pipeline_id};
     sc_api::core::buildEffectClearAction(action_builder_, ref);
     return action_builder_.sendNonBlocking() == ActionResult::complete;
 }
 
 bool FfbPipeline::isActive() const {
-    return pipeline_id_ != -1 && action_builder_.getSession()->getState() == SessionState::connected_control;
+    return getPipelineId() != -1 && action_builder_.getSession()->getState() == SessionState::connected_control;
 }
 
 bool FfbPipeline::remove() {
-    if (pipeline_id_ < 0) return true;
+    const int8_t pipeline_id = getPipelineId();
+    if (pipeline_id < 0) return true;
 
-    sc_api::core::CommandRequest req("ffb", "free_pipeline");
-    req.docAddElement("device_session_id", device_.id);
-    req.docAddElement("pipeline_id", pipeline_id_);
+    CommandRequest req;
+    buildFreeRequest(req, device_, pipeline_id);
     CommandResult result = action_builder_.getSession()->blockingCommand(std::move(req));
 
     if (result.isSuccess()) {
-        pipeline_id_ = -1;
+        state_->pipeline_id.store(-1, std::memory_order_release);
         return true;
     }
     return false;
 }
 
+FfbPipelineGroup::FfbPipelineGroup(const std::shared_ptr<Session>& session) : action_builder_(session) {}
+
+unsigned FfbPipelineGroup::addPipeline(FfbPipeline& pipeline) {
+    assert(pipeline.getSession() == action_builder_.getSession());
+    pipelines_.push_back(&pipeline);
+    return (unsigned)pipelines_.size() - 1;
+}
+
+void FfbPipelineGroup::clear() {
+    pipelines_.clear();
+    discardFrame();
+}
+
+bool FfbPipelineGroup::addEffect(FfbPipeline& pipeline, Clock::time_point start_timestamp, Clock::duration sample_time,
+                                 const float* samples, unsigned sample_count) {
+    assert(sample_count <= 256);
+    const int8_t pipeline_id = pipeline.getPipelineId();
+    if (pipeline_id < 0) return false;
+
+    const PipelineConfig config = pipeline.getConfig();
+    EffectPipelineRef    ref    = {pipeline.getDevice().id, (uint8_t)pipeline_id};
+
+    if (!buildEffectOffsetDataAction(action_builder_, ref, start_timestamp, sample_time, samples, sample_count,
+                                     config.sample_format, config.gain)) {
+        return false;
+    }
+
+    ++effect_count_;
+    return true;
+}
+
+bool FfbPipelineGroup::beginEffect(EffectSampleWriter& writer, FfbPipeline& pipeline, Clock::time_point start_timestamp,
+                                   Clock::duration sample_time, unsigned sample_count) {
+    const int8_t pipeline_id = pipeline.getPipelineId();
+    if (pipeline_id < 0) return false;
+
+    const PipelineConfig config = pipeline.getConfig();
+    EffectPipelineRef    ref    = {pipeline.getDevice().id, (uint8_t)pipeline_id};
+
+    if (!writer.begin(action_builder_, ref, start_timestamp, sample_time, sample_count, config.sample_format,
+                      config.gain)) {
+        return false;
+    }
+
+    ++effect_count_;
+    return true;
+}
+
+unsigned FfbPipelineGroup::generateEffects(Clock::time_point start_timestamp, Clock::duration sample_time,
+                                           const float* const* samples, unsigned sample_count) {
+    unsigned built = 0;
+    for (std::size_t i = 0; i < pipelines_.size(); ++i) {
+        if (samples[i] && addEffect(*pipelines_[i], start_timestamp, sample_time, samples[i], sample_count)) {
+            ++built;
+        }
+    }
+    return built;
+}
+
+ActionResult FfbPipelineGroup::send() {
+    if (effect_count_ == 0) return ActionResult::complete;
+
+    ActionResult result = action_builder_.sendNonBlocking();
+    if (result != ActionResult::would_block) {
+        discardFrame();
+    }
+    return result;
+}
+
+bool FfbPipelineGroup::send(ActionBatch& batch) {
+    if (effect_count_ == 0) return false;
+
+    effect_count_ = 0;
+    return batch.add(action_builder_);
+}
+
+void FfbPipelineGroup::discardFrame() {
+    action_builder_.reset();
+    effect_count_ = 0;
+}
+
 }  // namespace sc_api::core
@@ -0,0 +1,120 @@
+#include "sc-api/core/ffb_lead_time.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sc_api::core {
+
+LeadTimeController::LeadTimeController(const LeadTimeConfig& config)
+    : config_(config),
+      lead_time_ns_(config.initial_lead_time.count()),
+      effect_duration_ns_(config.initial_lead_time.count()) {
+    config_.window_size     = std::max(config_.window_size, 1u);
+    config_.update_interval = std::max(config_.update_interval, 1u);
+    latencies_.reserve(config_.window_size);
+    intervals_.reserve(config_.window_size);
+    scratch_.reserve(config_.window_size);
+}
+
+void LeadTimeController::recordSend(Clock::time_point now, Clock::time_point start_timestamp,
+                                    Clock::time_point send_done) {
+    const int64_t latency = (send_done - now).count();
+    if (latencies_.size() < config_.window_size) {
+        latencies_.push_back(latency);
+    } else {
+        latencies_[latency_idx_] = latency;
+    }
+    latency_idx_ = (latency_idx_ + 1) % config_.window_size;
+
+    if (has_previous_) {
+        const int64_t interval = (now - previous_send_).count();
+        if (intervals_.size() < config_.window_size) {
+            intervals_.push_back(interval);
+        } else {
+            intervals_[interval_idx_] = interval;
+        }
+        interval_idx_ = (interval_idx_ + 1) % config_.window_size;
+    }
+    previous_send_ = now;
+    has_previous_  = true;
+
+    sends_.fetch_add(1, std::memory_order_relaxed);
+    if (latency > max_latency_ns_.load(std::memory_order_relaxed)) {
+        max_latency_ns_.store(latency, std::memory_order_relaxed);
+    }
+
+    // Miss raises the lead time right away instead of waiting for the next update
+    if (send_done + config_.transport_margin > start_timestamp) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        const int64_t required = std::min<int64_t>(latency + config_.transport_margin.count(),
+                                                   config_.max_lead_time.count());
+        if (required > lead_time_ns_.load(std::memory_order_relaxed)) {
+            lead_time_ns_.store(required, std::memory_order_relaxed);
+        }
+    }
+
+    if (++since_update_ >= config_.update_interval) {
+        since_update_ = 0;
+        updateEstimates();
+    }
+}
+
+void LeadTimeController::recordSendFailure() { send_failures_.fetch_add(1, std::memory_order_relaxed); }
+
+int64_t LeadTimeController::percentile(std::vector<int64_t>& values) const {
+    const std::size_t idx = std::min(values.size() - 1, (std::size_t)std::ceil(config_.percentile * values.size()));
+    std::nth_element(values.begin(), values.begin() + idx, values.end());
+    return values[idx];
+}
+
+void LeadTimeController::updateEstimates() {
+    if (latencies_.size() >= config_.update_interval) {
+        scratch_.assign(latencies_.begin(), latencies_.end());
+        const int64_t latency = percentile(scratch_);
+        latency_ns_.store(latency, std::memory_order_relaxed);
+
+        const int64_t target  = std::clamp<int64_t>(latency + config_.transport_margin.count(),
+                                                   config_.min_lead_time.count(), config_.max_lead_time.count());
+        const int64_t current = lead_time_ns_.load(std::memory_order_relaxed);
+
+        // Grow immediately, but shrink by an eighth of the difference per update
+        lead_time_ns_.store(target >= current ? target : current - (current - target) / 8 - 1,
+                            std::memory_order_relaxed);
+    }
+
+    if (intervals_.size() >= config_.update_interval) {
+        scratch_.assign(intervals_.begin(), intervals_.end());
+        effect_duration_ns_.store(percentile(scratch_) + config_.min_overlap.count(), std::memory_order_relaxed);
+    }
+}
+
+LeadTimeStats LeadTimeController::getStats() const {
+    LeadTimeStats stats;
+    stats.lead_time        = getLeadTime();
+    stats.effect_duration  = getEffectDuration();
+    stats.send_latency     = Clock::duration(latency_ns_.load(std::memory_order_relaxed));
+    stats.max_send_latency = Clock::duration(max_latency_ns_.load(std::memory_order_relaxed));
+    stats.sends            = sends_.load(std::memory_order_relaxed);
+    stats.misses           = misses_.load(std::memory_order_relaxed);
+    stats.send_failures    = send_failures_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void LeadTimeController::reset() {
+    latencies_.clear();
+    intervals_.clear();
+    latency_idx_  = 0;
+    interval_idx_ = 0;
+    since_update_ = 0;
+    has_previous_ = false;
+
+    lead_time_ns_.store(config_.initial_lead_time.count(), std::memory_order_relaxed);
+    effect_duration_ns_.store(config_.initial_lead_time.count(), std::memory_order_relaxed);
+    latency_ns_.store(0, std::memory_order_relaxed);
+    max_latency_ns_.store(0, std::memory_order_relaxed);
+    sends_.store(0, std::memory_order_relaxed);
+    misses_.store(0, std::memory_order_relaxed);
+    send_failures_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace sc_api::core
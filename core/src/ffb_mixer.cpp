@@ -0,0 +1,135 @@
+#include "sc-api/core/ffb_mixer.h"
+
+#include <algorithm>
+
+#include "sc-api/core/protocol/actions.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SC_API_MIXER_SSE2 1
+#endif
+
+namespace sc_api::core {
+
+namespace {
+
+constexpr unsigned k_block_size = SC_API_PROTOCOL_COMMAND_EFFECT_MAX_SAMPLE_COUNT;
+
+/** out += clamp(in, -limit, limit) * gain */
+void accumulate(float* out, const float* in, unsigned count, float gain, float limit) {
+    unsigned i = 0;
+#ifdef SC_API_MIXER_SSE2
+    const __m128 g  = _mm_set1_ps(gain);
+    const __m128 lo = _mm_set1_ps(-limit);
+    const __m128 hi = _mm_set1_ps(limit);
+    for (; i + 4 <= count; i += 4) {
+        const __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(v, g)));
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] += std::min(limit, std::max(-limit, in[i])) * gain;
+    }
+}
+
+void clampOutput(float* inout, unsigned count, float lo, float hi) {
+    unsigned i = 0;
+#ifdef SC_API_MIXER_SSE2
+    const __m128 l = _mm_set1_ps(lo);
+    const __m128 h = _mm_set1_ps(hi);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(inout + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(inout + i), l), h));
+    }
+#endif
+    for (; i < count; ++i) {
+        inout[i] = std::min(hi, std::max(lo, inout[i]));
+    }
+}
+
+}  // namespace
+
+FfbMixer::FfbMixer(FfbPipeline& pipeline) : pipeline_(pipeline) {}
+
+FfbMixer::SourceId FfbMixer::addSource(EffectSource source, float gain, float limit) {
+    const SourceId id = next_id_++;
+    sources_.push_back(Source{id, std::move(source), gain, limit, true});
+    return id;
+}
+
+bool FfbMixer::removeSource(SourceId id) {
+    auto it = std::find_if(sources_.begin(), sources_.end(), [id](const Source& s) { return s.id == id; });
+    if (it == sources_.end()) return false;
+
+    sources_.erase(it);
+    return true;
+}
+
+FfbMixer::Source* FfbMixer::findSource(SourceId id) {
+    for (Source& s : sources_) {
+        if (s.id == id) return &s;
+    }
+    return nullptr;
+}
+
+bool FfbMixer::setSourceGain(SourceId id, float gain) {
+    Source* s = findSource(id);
+    if (!s) return false;
+
+    s->gain = gain;
+    return true;
+}
+
+bool FfbMixer::setSourceLimit(SourceId id, float limit) {
+    Source* s = findSource(id);
+    if (!s) return false;
+
+    s->limit = limit;
+    return true;
+}
+
+bool FfbMixer::setSourceEnabled(SourceId id, bool enabled) {
+    Source* s = findSource(id);
+    if (!s) return false;
+
+    s->enabled = enabled;
+    return true;
+}
+
+void FfbMixer::setOutputLimits(float lo, float hi) {
+    output_lo_ = lo;
+    output_hi_ = hi;
+}
+
+void FfbMixer::render(float* out, unsigned count) {
+    float scratch[k_block_size];
+    for (unsigned offset = 0; offset < count; offset += k_block_size) {
+        const unsigned n = std::min(k_block_size, count - offset);
+        float*         o = out + offset;
+
+        std::fill(o, o + n, 0.0f);
+        for (Source& s : sources_) {
+            if (!s.enabled) continue;
+
+            // Muted sources are still rendered, so that stateful sources keep advancing in time
+            s.render(scratch, n);
+            if (s.gain != 0.0f) accumulate(o, scratch, n, s.gain, s.limit);
+        }
+        clampOutput(o, n, output_lo_, output_hi_);
+    }
+}
+
+bool FfbMixer::generateEffect(Clock::time_point start_timestamp, Clock::duration sample_time, unsigned sample_count) {
+    EffectSampleWriter writer;
+    if (!pipeline_.beginEffect(writer, start_timestamp, sample_time, sample_count)) return false;
+
+    if (float* samples = writer.getF32Samples()) {
+        render(samples, sample_count);
+    } else {
+        float mixed[k_block_size];
+        render(mixed, sample_count);
+        writer.writeSamples(0, mixed, sample_count);
+    }
+    return pipeline_.sendEffect(writer);
+}
+
+}  // namespace sc_api::core
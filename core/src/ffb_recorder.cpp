@@ -0,0 +1,382 @@
+#include "sc-api/core/ffb_recorder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "compatibility.h"
+#include "effect_action.h"
+
+namespace sc_api::core {
+
+namespace {
+
+constexpr char     k_magic[8] = {'S', 'C', 'F', 'X', 'R', 'E', 'C', '\0'};
+constexpr uint32_t k_version  = 1;
+
+struct FileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;
+
+    /** Offset of the end of the last complete record */
+    uint64_t data_end;
+};
+
+/** Followed by the payload. Records are padded to multiples of 8 bytes */
+struct RecordHeader {
+    /** Size of the record including this header and padding */
+    uint32_t size;
+    uint16_t action_id;
+    uint16_t payload_size;
+    int64_t  timestamp_ns;
+};
+
+std::size_t recordSize(std::size_t payload_size) {
+    return (sizeof(RecordHeader) + payload_size + 7) & ~(std::size_t)7;
+}
+
+uint32_t sampleSize(uint8_t protocol_format) {
+    return protocol_format == SC_API_PROTOCOL_FB_SAMPLE_FORMAT_F32 ? sizeof(float) : sizeof(uint16_t);
+}
+
+bool fromProtocolSampleFormat(uint8_t protocol_format, SampleFormat& format) {
+    switch (protocol_format) {
+        case SC_API_PROTOCOL_FB_SAMPLE_FORMAT_F32:
+            format = SampleFormat::f32;
+            return true;
+        case SC_API_PROTOCOL_FB_SAMPLE_FORMAT_I16:
+            format = SampleFormat::i16;
+            return true;
+        case SC_API_PROTOCOL_FB_SAMPLE_FORMAT_U16:
+            format = SampleFormat::u16;
+            return true;
+    }
+    return false;
+}
+
+/** Pipeline of a recorded effect or effect clear action */
+bool getRecordedPipeline(const RecordHeader& rec, const uint8_t* payload, EffectPipelineRef& ref) {
+    if (rec.action_id == SC_API_PROTOCOL_ACTION_FB_EFFECT && rec.payload_size >= sizeof(internal::EffectHeader)) {
+        internal::EffectHeader hdr;
+        std::memcpy(&hdr, payload, sizeof(hdr));
+        ref = {hdr.device, hdr.aad.fb_pipeline_idx};
+        return true;
+    }
+    if (rec.action_id == SC_API_PROTOCOL_ACTION_FB_EFFECT_CLEAR &&
+        rec.payload_size >= sizeof(internal::EffectClearPayload)) {
+        internal::EffectClearPayload clear;
+        std::memcpy(&clear, payload, sizeof(clear));
+        if (clear.data.cleared_pipeline_count == 0) return false;
+        ref = {clear.device, clear.data.fb_pipelines[0]};
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+EffectRecorder::EffectRecorder() : file_(std::make_unique<internal::MappedFile>()) {}
+
+EffectRecorder::~EffectRecorder() { close(); }
+
+bool EffectRecorder::open(const char* path, std::size_t initial_size) {
+    std::lock_guard lock(mutex_);
+    file_->close(used_);
+    used_    = 0;
+    records_ = 0;
+    dropped_ = 0;
+
+    if (!file_->create(path, std::max(initial_size, sizeof(FileHeader)))) return false;
+
+    FileHeader hdr{};
+    std::memcpy(hdr.magic, k_magic, sizeof(k_magic));
+    hdr.version     = k_version;
+    hdr.header_size = sizeof(FileHeader);
+    hdr.data_end    = sizeof(FileHeader);
+    std::memcpy(file_->getBuffer(), &hdr, sizeof(hdr));
+    used_ = sizeof(FileHeader);
+    return true;
+}
+
+void EffectRecorder::close() {
+    std::lock_guard lock(mutex_);
+    file_->close(used_);
+}
+
+bool EffectRecorder::isOpen() const {
+    std::lock_guard lock(mutex_);
+    return file_->isOpen();
+}
+
+bool EffectRecorder::record(SC_API_PROTOCOL_Action_t action_id, const uint8_t* payload, std::size_t payload_size) {
+    return record(Clock::now(), action_id, payload, payload_size);
+}
+
+bool EffectRecorder::record(Clock::time_point timestamp, SC_API_PROTOCOL_Action_t action_id, const uint8_t* payload,
+                            std::size_t payload_size) {
+    std::lock_guard lock(mutex_);
+    const std::size_t size = recordSize(payload_size);
+    if (!file_->isOpen() || payload_size > UINT16_MAX || !reserve(used_ + size)) {
+        ++dropped_;
+        return false;
+    }
+
+    RecordHeader rec;
+    rec.size         = (uint32_t)size;
+    rec.action_id    = (uint16_t)action_id;
+    rec.payload_size = (uint16_t)payload_size;
+    rec.timestamp_ns = timestamp.time_since_epoch().count();
+
+    uint8_t* buf = (uint8_t*)file_->getBuffer();
+    std::memcpy(buf + used_, &rec, sizeof(rec));
+    std::memcpy(buf + used_ + sizeof(rec), payload, payload_size);
+    std::memset(buf + used_ + sizeof(rec) + payload_size, 0, size - sizeof(rec) - payload_size);
+    used_ += size;
+    ++records_;
+
+    // Record is complete before it is included in the header
+    const uint64_t data_end = used_;
+    std::memcpy(buf + offsetof(FileHeader, data_end), &data_end, sizeof(data_end));
+    return true;
+}
+
+bool EffectRecorder::reserve(std::size_t size) {
+    if (size <= file_->getSize()) return true;
+    return file_->resize(std::max(size, file_->getSize() * 2));
+}
+
+uint64_t EffectRecorder::getRecordCount() const {
+    std::lock_guard lock(mutex_);
+    return records_;
+}
+
+uint64_t EffectRecorder::getDroppedCount() const {
+    std::lock_guard lock(mutex_);
+    return dropped_;
+}
+
+std::size_t EffectRecorder::getSize() const {
+    std::lock_guard lock(mutex_);
+    return used_;
+}
+
+EffectReplayer::EffectReplayer(const std::shared_ptr<Session>& session)
+    : builder_(session), file_(std::make_unique<internal::MappedFile>()) {}
+
+EffectReplayer::~EffectReplayer() = default;
+
+bool EffectReplayer::open(const char* path) {
+    close();
+    if (!file_->openForReadOnly(path)) return false;
+
+    const uint8_t* buf = (const uint8_t*)file_->getBuffer();
+    FileHeader     hdr;
+    if (file_->getSize() < sizeof(hdr)) {
+        close();
+        return false;
+    }
+    std::memcpy(&hdr, buf, sizeof(hdr));
+    if (std::memcmp(hdr.magic, k_magic, sizeof(k_magic)) != 0 || hdr.version != k_version ||
+        hdr.header_size < sizeof(FileHeader) || hdr.data_end > file_->getSize()) {
+        close();
+        return false;
+    }
+
+    // Partially written record at the end is ignored
+    std::size_t offset = hdr.header_size;
+    while (offset + sizeof(RecordHeader) <= hdr.data_end) {
+        RecordHeader rec;
+        std::memcpy(&rec, buf + offset, sizeof(rec));
+        if (rec.size < sizeof(RecordHeader) + rec.payload_size || offset + rec.size > hdr.data_end) break;
+
+        records_.push_back(offset);
+        offset += rec.size;
+    }
+
+    if (!records_.empty()) first_ns_ = recordTimestamp(0);
+    start();
+    return true;
+}
+
+void EffectReplayer::close() {
+    file_->close();
+    records_.clear();
+    next_          = 0;
+    first_ns_      = 0;
+    send_failures_ = 0;
+}
+
+Clock::duration EffectReplayer::getRecordedDuration() const {
+    if (records_.empty()) return Clock::duration::zero();
+    return Clock::duration(recordTimestamp(records_.size() - 1) - first_ns_);
+}
+
+std::vector<EffectPipelineRef> EffectReplayer::getRecordedPipelines() const {
+    std::vector<EffectPipelineRef> refs;
+    const uint8_t*                 buf = (const uint8_t*)file_->getBuffer();
+    for (std::size_t offset : records_) {
+        RecordHeader rec;
+        std::memcpy(&rec, buf + offset, sizeof(rec));
+
+        EffectPipelineRef ref;
+        if (!getRecordedPipeline(rec, buf + offset + sizeof(rec), ref)) continue;
+
+        const bool known = std::any_of(refs.begin(), refs.end(), [&ref](const EffectPipelineRef& r) {
+            return r.device_logical_id == ref.device_logical_id && r.pipeline_id == ref.pipeline_id;
+        });
+        if (!known) refs.push_back(ref);
+    }
+    return refs;
+}
+
+void EffectReplayer::mapPipeline(EffectPipelineRef recorded, FfbPipeline& target) {
+    for (Mapping& m : mappings_) {
+        if (m.recorded.device_logical_id == recorded.device_logical_id &&
+            m.recorded.pipeline_id == recorded.pipeline_id) {
+            m.target = &target;
+            return;
+        }
+    }
+    mappings_.push_back(Mapping{recorded, &target});
+}
+
+void EffectReplayer::clearPipelineMappings() { mappings_.clear(); }
+
+void EffectReplayer::start(Clock::time_point start_time, double time_scale) {
+    next_       = 0;
+    start_time_ = start_time;
+    time_scale_ = time_scale;
+    builder_.reset();
+}
+
+int64_t EffectReplayer::recordTimestamp(std::size_t idx) const {
+    RecordHeader rec;
+    std::memcpy(&rec, (const uint8_t*)file_->getBuffer() + records_[idx], sizeof(rec));
+    return rec.timestamp_ns;
+}
+
+Clock::time_point EffectReplayer::toReplayTime(int64_t recorded_ns) const {
+    return start_time_ + Clock::duration((int64_t)((double)(recorded_ns - first_ns_) * time_scale_));
+}
+
+EffectReplayer::BuildResult EffectReplayer::resolvePipeline(EffectPipelineRef& ref) const {
+    if (mappings_.empty()) return BuildResult::built;
+
+    for (const Mapping& m : mappings_) {
+        if (m.recorded.device_logical_id != ref.device_logical_id || m.recorded.pipeline_id != ref.pipeline_id) {
+            continue;
+        }
+        const int8_t pipeline_id = m.target->getPipelineId();
+        if (pipeline_id < 0) return BuildResult::failed;
+
+        ref = {m.target->getDevice().id, (uint8_t)pipeline_id};
+        return BuildResult::built;
+    }
+    return BuildResult::skipped;
+}
+
+EffectReplayer::BuildResult EffectReplayer::buildRecord(std::size_t idx) {
+    const uint8_t* buf = (const uint8_t*)file_->getBuffer() + records_[idx];
+    RecordHeader   rec;
+    std::memcpy(&rec, buf, sizeof(rec));
+    const uint8_t* payload = buf + sizeof(rec);
+
+    EffectPipelineRef ref;
+    if (!getRecordedPipeline(rec, payload, ref)) return BuildResult::skipped;
+
+    const BuildResult resolved = resolvePipeline(ref);
+    if (resolved != BuildResult::built) return resolved;
+
+    if (rec.action_id == SC_API_PROTOCOL_ACTION_FB_EFFECT_CLEAR) {
+        return buildEffectClearAction(builder_, ref) ? BuildResult::built : BuildResult::failed;
+    }
+
+    internal::EffectHeader hdr;
+    std::memcpy(&hdr, payload, sizeof(hdr));
+
+    SampleFormat   format;
+    const unsigned sample_count = (unsigned)hdr.data.sample_count_minus_1 + 1;
+    const uint32_t data_size    = sample_count * sampleSize(hdr.data.sample_format);
+    if (!fromProtocolSampleFormat(hdr.data.sample_format, format) || rec.payload_size < sizeof(hdr) + data_size) {
+        return BuildResult::failed;
+    }
+
+    const int64_t start_ns    = (int64_t)(((uint64_t)hdr.data.start_time_high << 32) | hdr.data.start_time_low);
+    const int64_t duration_ns = (int64_t)(((uint64_t)hdr.data.sample_duration_high << 32) | hdr.data.sample_duration);
+    const Clock::duration sample_time((int64_t)((double)duration_ns * time_scale_));
+
+    // Samples are copied as recorded, so gain doesn't matter
+    EffectSampleWriter writer;
+    if (!writer.begin(builder_, ref, toReplayTime(start_ns), sample_time, sample_count, format, 1.0f)) {
+        return BuildResult::failed;
+    }
+
+    void* samples = nullptr;
+    switch (format) {
+        case SampleFormat::f32:
+            samples = writer.getF32Samples();
+            break;
+        case SampleFormat::i16:
+            samples = writer.getI16Samples();
+            break;
+        case SampleFormat::u16:
+            samples = writer.getU16Samples();
+            break;
+    }
+    std::memcpy(samples, payload + sizeof(hdr), data_size);
+    if (!writer.finish()) {
+        // Don't leave a half built action to be sent with the next records
+        builder_.reset();
+        return BuildResult::discarded;
+    }
+    return BuildResult::built;
+}
+
+unsigned EffectReplayer::sendDue(Clock::time_point now) {
+    unsigned built = 0;
+    for (; next_ < records_.size() && toReplayTime(recordTimestamp(next_)) <= now; ++next_) {
+        switch (buildRecord(next_)) {
+            case BuildResult::built:
+                ++built;
+                break;
+            case BuildResult::failed:
+                ++send_failures_;
+                break;
+            case BuildResult::discarded:
+                send_failures_ += built + 1;
+                built = 0;
+                break;
+            case BuildResult::skipped:
+                break;
+        }
+    }
+
+    if (built == 0) return 0;
+
+    // Late effects are useless, so blocked datagrams aren't retried
+    if (builder_.sendNonBlocking() != ActionResult::complete) {
+        builder_.reset();
+        send_failures_ += built;
+        return 0;
+    }
+    return built;
+}
+
+bool EffectReplayer::sendNext() {
+    if (isFinished()) return false;
+
+    // Shift the replay so that the next record is due now
+    const int64_t offset = (int64_t)((double)(recordTimestamp(next_) - first_ns_) * time_scale_);
+    start_time_          = Clock::now() - Clock::duration(offset);
+
+    const BuildResult result = buildRecord(next_++);
+    if (result == BuildResult::skipped) return true;
+    if (result == BuildResult::built && builder_.sendNonBlocking() == ActionResult::complete) return true;
+
+    builder_.reset();
+    ++send_failures_;
+    return false;
+}
+
+}  // namespace sc_api::core
@@ -0,0 +1,159 @@
+#include "sc-api/core/ffb_stream.h"
+
+#include <algorithm>
+
+#include "api_internal.h"
+#include "effect_action.h"
+
+namespace sc_api::core {
+
+namespace {
+
+uint32_t roundUpToPowerOfTwo(uint32_t v) {
+    uint32_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+}  // namespace
+
+FfbStream::FfbStream(FfbPipeline& pipeline, const FfbStreamConfig& config)
+    : pipeline_(pipeline), config_(config), builder_(pipeline.getSession()) {
+    const uint32_t capacity = roundUpToPowerOfTwo(std::max(config_.queue_capacity, 1u));
+    queue_                  = std::make_unique<float[]>(capacity);
+    mask_                   = capacity - 1;
+}
+
+FfbStream::~FfbStream() { stopTimer(); }
+
+unsigned FfbStream::push(const float* samples, unsigned count) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    const uint32_t tail = tail_.load(std::memory_order_acquire);
+    const uint32_t n    = std::min<uint32_t>(count, mask_ + 1 - (head - tail));
+
+    for (uint32_t i = 0; i < n; ++i) {
+        queue_[(head + i) & mask_] = samples[i];
+    }
+    head_.store(head + n, std::memory_order_release);
+    return n;
+}
+
+unsigned FfbStream::getQueuedSampleCount() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+}
+
+unsigned FfbStream::maxChunkSamples() {
+    unsigned max_samples = SC_API_PROTOCOL_COMMAND_EFFECT_MAX_SAMPLE_COUNT;
+    if (config_.max_chunk_samples != 0) {
+        max_samples = std::min(max_samples, config_.max_chunk_samples);
+    }
+
+    std::shared_ptr<Session> session = pipeline_.getSession();
+    if (!session) return max_samples;
+
+    const Session::Internal& h           = session->getInternal();
+    const uint32_t           sample_size = pipeline_.getConfig().sample_format == SampleFormat::f32 ? 4 : 2;
+    const uint32_t           overhead    = sizeof(SC_API_PROTOCOL_ActionHeader_t) + sizeof(internal::EffectHeader);
+
+    uint32_t space = 0;
+    if (session->getSecureSession()) {
+        const uint32_t limit     = h.maxEncryptedDatagramSize();
+        const uint32_t encrypted = overhead + sizeof(SC_API_PROTOCOL_EncryptedActionHeader_t) +
+                                   sizeof(SC_API_PROTOCOL_EncryptedActionFooter_t);
+        // Encrypted sample data is padded to the cipher block size
+        space = limit > encrypted ? (limit - encrypted) & ~15u : 0;
+    } else {
+        const uint32_t limit = h.maxPlaintextDatagramSize();
+        space                = limit > overhead ? limit - overhead : 0;
+    }
+
+    return std::max(1u, std::min(max_samples, space / sample_size));
+}
+
+bool FfbStream::service(Clock::time_point now) {
+    // Datagram that would have blocked is retried before anything else so that samples stay in order
+    if (send_pending_) {
+        ActionResult r = builder_.sendNonBlocking();
+        if (r == ActionResult::would_block) return true;
+
+        send_pending_ = false;
+        if (r != ActionResult::complete) return false;
+    }
+
+    const int8_t pipeline_id = pipeline_.getPipelineId();
+    if (pipeline_id < 0) return false;
+
+    const PipelineConfig    pipeline_config = pipeline_.getConfig();
+    const EffectPipelineRef ref             = {pipeline_.getDevice().id, (uint8_t)pipeline_id};
+    const unsigned          max_chunk       = maxChunkSamples();
+
+    EffectSampleWriter writer;
+    while (true) {
+        const uint32_t tail      = tail_.load(std::memory_order_relaxed);
+        const uint32_t available = head_.load(std::memory_order_acquire) - tail;
+        if (available == 0) break;
+
+        if (!has_timeline_ || next_time_ < now) {
+            if (has_timeline_) {
+                underruns_.fetch_add(1, std::memory_order_relaxed);
+            }
+            next_time_    = now + config_.lead_time;
+            has_timeline_ = true;
+        }
+
+        const Clock::time_point window_end = now + config_.lookahead;
+        if (next_time_ >= window_end) break;
+
+        const auto     in_window = (uint64_t)((window_end - next_time_ + config_.sample_time - Clock::duration(1)) /
+                                          config_.sample_time);
+        const unsigned count     = (unsigned)std::min<uint64_t>({available, in_window, max_chunk});
+
+        // Partial chunks are only sent when the samples can't wait any longer
+        if (count < max_chunk && next_time_ > now + config_.lead_time) break;
+
+        if (!writer.begin(builder_, ref, next_time_, config_.sample_time, count, pipeline_config.sample_format,
+                          pipeline_config.gain)) {
+            return false;
+        }
+
+        // Samples are written straight from the queue to the action, in two parts if the queue wraps around
+        const uint32_t start = tail & mask_;
+        const unsigned first = std::min<unsigned>(count, mask_ + 1 - start);
+        writer.writeSamples(0, &queue_[start], first);
+        writer.writeSamples(first, &queue_[0], count - first);
+        tail_.store(tail + count, std::memory_order_release);
+
+        if (!writer.finish()) {
+            builder_.reset();
+            return false;
+        }
+        next_time_ += config_.sample_time * count;
+        sent_chunks_.fetch_add(1, std::memory_order_relaxed);
+
+        ActionResult r = builder_.sendNonBlocking();
+        if (r == ActionResult::would_block) {
+            send_pending_ = true;
+            return true;
+        }
+        if (r != ActionResult::complete) return false;
+    }
+    return true;
+}
+
+void FfbStream::startTimer(std::chrono::milliseconds period) {
+    std::shared_ptr<Session> session = pipeline_.getSession();
+    if (!session) return;
+
+    timer_ = session->createPeriodicTimer(period, [this]() { service(); });
+}
+
+void FfbStream::stopTimer() { timer_.destroy(); }
+
+void FfbStream::reset() {
+    tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    builder_.reset();
+    send_pending_ = false;
+    has_timeline_ = false;
+}
+
+}  // namespace sc_api::core
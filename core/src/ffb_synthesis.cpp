@@ -0,0 +1,353 @@
+#include "sc-api/core/ffb_synthesis.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SC_API_SYNTHESIS_SSE2 1
+#endif
+
+namespace sc_api::core::synthesis {
+
+namespace {
+
+constexpr float k_two_pi = 6.28318530718f;
+
+// Taylor series coefficients of sin(y) up to y^9. Maximum error within [-pi/2, pi/2] is about 4e-6
+constexpr float k_sin_c3 = -1.0f / 6.0f;
+constexpr float k_sin_c5 = 1.0f / 120.0f;
+constexpr float k_sin_c7 = -1.0f / 5040.0f;
+constexpr float k_sin_c9 = 1.0f / 362880.0f;
+
+double toSeconds(Clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+/** Fractional part of the phase, range [0, 1) */
+inline float wrapPhase(float x) { return x - std::floor(x); }
+
+/** sin(2 * pi * x) for x in range [0, 1) */
+inline float sinTurns(float x) {
+    // sin(2 * pi * x) = -sin(2 * pi * t), where t is in range [-0.5, 0.5). Folded to [-0.25, 0.25] by symmetry
+    float t = x - 0.5f;
+    if (t > 0.25f) {
+        t = 0.5f - t;
+    } else if (t < -0.25f) {
+        t = -0.5f - t;
+    }
+    const float y  = t * k_two_pi;
+    const float y2 = y * y;
+    return -y * (1.0f + y2 * (k_sin_c3 + y2 * (k_sin_c5 + y2 * (k_sin_c7 + y2 * k_sin_c9))));
+}
+
+/** Normalized waveform value at phase x in range [0, 1) */
+template <Waveform k_waveform>
+inline float shape(float x, float duty_cycle) {
+    switch (k_waveform) {
+        case Waveform::sine:
+            return sinTurns(x);
+        case Waveform::square:
+            return x < duty_cycle ? 1.0f : -1.0f;
+        case Waveform::triangle:
+            return std::fabs(4.0f * wrapPhase(x + 0.75f) - 2.0f) - 1.0f;
+        case Waveform::sawtooth:
+            return 2.0f * x - 1.0f;
+        case Waveform::pulse:
+            return x < duty_cycle ? 1.0f : 0.0f;
+        case Waveform::bump:
+            return x < duty_cycle ? sinTurns(0.5f * x / duty_cycle) : 0.0f;
+    }
+    return 0.0f;
+}
+
+#ifdef SC_API_SYNTHESIS_SSE2
+
+inline __m128 select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+inline __m128 absPs(__m128 v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+
+/** Floor for values that fit to int32 */
+inline __m128 floorPs(__m128 v) {
+    const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+}
+
+inline __m128 wrapPhase(__m128 x) { return _mm_sub_ps(x, floorPs(x)); }
+
+inline __m128 sinTurns(__m128 x) {
+    __m128 t = _mm_sub_ps(x, _mm_set1_ps(0.5f));
+    t        = select(_mm_cmpgt_ps(t, _mm_set1_ps(0.25f)), _mm_sub_ps(_mm_set1_ps(0.5f), t), t);
+    t        = select(_mm_cmplt_ps(t, _mm_set1_ps(-0.25f)), _mm_sub_ps(_mm_set1_ps(-0.5f), t), t);
+
+    const __m128 y  = _mm_mul_ps(t, _mm_set1_ps(k_two_pi));
+    const __m128 y2 = _mm_mul_ps(y, y);
+    __m128       p  = _mm_add_ps(_mm_set1_ps(k_sin_c7), _mm_mul_ps(y2, _mm_set1_ps(k_sin_c9)));
+    p               = _mm_add_ps(_mm_set1_ps(k_sin_c5), _mm_mul_ps(y2, p));
+    p               = _mm_add_ps(_mm_set1_ps(k_sin_c3), _mm_mul_ps(y2, p));
+    p               = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(y2, p));
+    return _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(y, p));
+}
+
+template <Waveform k_waveform>
+inline __m128 shape(__m128 x, float duty_cycle) {
+    const __m128 duty = _mm_set1_ps(duty_cycle);
+    const __m128 one  = _mm_set1_ps(1.0f);
+    switch (k_waveform) {
+        case Waveform::sine:
+            return sinTurns(x);
+        case Waveform::square:
+            return select(_mm_cmplt_ps(x, duty), one, _mm_set1_ps(-1.0f));
+        case Waveform::triangle: {
+            const __m128 t = wrapPhase(_mm_add_ps(x, _mm_set1_ps(0.75f)));
+            return _mm_sub_ps(absPs(_mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(4.0f)), _mm_set1_ps(2.0f))), one);
+        }
+        case Waveform::sawtooth:
+            return _mm_sub_ps(_mm_add_ps(x, x), one);
+        case Waveform::pulse:
+            return _mm_and_ps(_mm_cmplt_ps(x, duty), one);
+        case Waveform::bump: {
+            const __m128 t = _mm_mul_ps(x, _mm_set1_ps(0.5f / duty_cycle));
+            return _mm_and_ps(_mm_cmplt_ps(x, duty), sinTurns(t));
+        }
+    }
+    return _mm_setzero_ps();
+}
+
+#endif
+
+}  // namespace
+
+Oscillator::Oscillator(Waveform waveform, Clock::duration sample_time)
+    : waveform_(waveform), sample_time_s_(toSeconds(sample_time)) {}
+
+void Oscillator::setSampleTime(Clock::duration sample_time) { sample_time_s_ = toSeconds(sample_time); }
+
+void Oscillator::setDutyCycle(float duty_cycle) { duty_cycle_ = std::clamp(duty_cycle, 0.0f, 1.0f); }
+
+void Oscillator::setPhase(float phase) { phase_ = phase - std::floor(phase); }
+
+void Oscillator::render(float* out, unsigned count) { generate<false>(out, count); }
+
+void Oscillator::mix(float* out, unsigned count) { generate<true>(out, count); }
+
+template <bool k_mix>
+void Oscillator::generate(float* out, unsigned count) {
+    const double step       = (double)frequency_hz_ * sample_time_s_;
+    const float  phase_step = (float)(step - std::floor(step));
+
+    switch (waveform_) {
+        case Waveform::sine:
+            generateWaveform<Waveform::sine, k_mix>(out, count, *this, phase_step);
+            break;
+        case Waveform::square:
+            generateWaveform<Waveform::square, k_mix>(out, count, *this, phase_step);
+            break;
+        case Waveform::triangle:
+            generateWaveform<Waveform::triangle, k_mix>(out, count, *this, phase_step);
+            break;
+        case Waveform::sawtooth:
+            generateWaveform<Waveform::sawtooth, k_mix>(out, count, *this, phase_step);
+            break;
+        case Waveform::pulse:
+            generateWaveform<Waveform::pulse, k_mix>(out, count, *this, phase_step);
+            break;
+        case Waveform::bump:
+            // Bump with zero width would divide by zero and is zero anyway
+            if (duty_cycle_ > 0.0f) {
+                generateWaveform<Waveform::bump, k_mix>(out, count, *this, phase_step);
+            } else {
+                generateWaveform<Waveform::pulse, k_mix>(out, count, *this, phase_step);
+            }
+            break;
+    }
+
+    phase_ += step * count;
+    phase_ -= std::floor(phase_);
+}
+
+template <Waveform k_waveform, bool k_mix>
+void Oscillator::generateWaveform(float* out, unsigned count, const Oscillator& osc, float phase_step) {
+    const float phase = (float)osc.phase_;
+
+    unsigned i = 0;
+#ifdef SC_API_SYNTHESIS_SSE2
+    const __m128 amplitude = _mm_set1_ps(osc.amplitude_);
+    const __m128 offset    = _mm_set1_ps(osc.offset_);
+    const __m128 steps     = _mm_mul_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(phase_step));
+    for (; i + 4 <= count; i += 4) {
+        // Phase is computed from the block start instead of accumulating so that rounding errors don't add up
+        const __m128 x = wrapPhase(_mm_add_ps(_mm_set1_ps(phase + (float)i * phase_step), steps));
+        __m128       v = _mm_add_ps(_mm_mul_ps(shape<k_waveform>(x, osc.duty_cycle_), amplitude), offset);
+        if constexpr (k_mix) {
+            v = _mm_add_ps(v, _mm_loadu_ps(out + i));
+        }
+        _mm_storeu_ps(out + i, v);
+    }
+#endif
+    for (; i < count; ++i) {
+        const float x = wrapPhase(phase + (float)i * phase_step);
+        const float v = shape<k_waveform>(x, osc.duty_cycle_) * osc.amplitude_ + osc.offset_;
+        if constexpr (k_mix) {
+            out[i] += v;
+        } else {
+            out[i] = v;
+        }
+    }
+}
+
+NoiseGenerator::NoiseGenerator(uint32_t seed, Clock::duration sample_time) : sample_time_s_(toSeconds(sample_time)) {
+    // Spread the seed to the lanes with splitmix-like mixing. Xorshift state must not be zero
+    uint32_t s = seed;
+    for (uint32_t& lane : state_) {
+        s += 0x9e3779b9u;
+        uint32_t z = s;
+        z          = (z ^ (z >> 16)) * 0x85ebca6bu;
+        z          = (z ^ (z >> 13)) * 0xc2b2ae35u;
+        z ^= z >> 16;
+        lane = z != 0 ? z : 1;
+    }
+}
+
+void NoiseGenerator::setSampleTime(Clock::duration sample_time) {
+    sample_time_s_ = toSeconds(sample_time);
+    setCutoffFrequency(cutoff_hz_);
+}
+
+void NoiseGenerator::setCutoffFrequency(float hz) {
+    cutoff_hz_ = hz;
+    alpha_     = hz > 0.0f ? (float)(1.0 - std::exp(-2.0 * 3.14159265358979 * hz * sample_time_s_)) : 1.0f;
+}
+
+void NoiseGenerator::render(float* out, unsigned count) { generate<false>(out, count); }
+
+void NoiseGenerator::mix(float* out, unsigned count) { generate<true>(out, count); }
+
+template <bool k_mix>
+void NoiseGenerator::generate(float* out, unsigned count) {
+    constexpr float k_int_to_unit = 1.0f / 2147483648.0f;
+
+    float white[4];
+    float y = filtered_;
+    for (unsigned i = 0; i < count; i += 4) {
+#ifdef SC_API_SYNTHESIS_SSE2
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state_));
+        s         = _mm_xor_si128(s, _mm_slli_epi32(s, 13));
+        s         = _mm_xor_si128(s, _mm_srli_epi32(s, 17));
+        s         = _mm_xor_si128(s, _mm_slli_epi32(s, 5));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state_), s);
+        _mm_storeu_ps(white, _mm_mul_ps(_mm_cvtepi32_ps(s), _mm_set1_ps(k_int_to_unit * amplitude_)));
+#else
+        for (int lane = 0; lane < 4; ++lane) {
+            uint32_t s = state_[lane];
+            s ^= s << 13;
+            s ^= s >> 17;
+            s ^= s << 5;
+            state_[lane] = s;
+            white[lane]  = (float)(int32_t)s * (k_int_to_unit * amplitude_);
+        }
+#endif
+        // First order low-pass is recursive, so it is evaluated one sample at a time
+        const unsigned n = std::min(4u, count - i);
+        for (unsigned k = 0; k < n; ++k) {
+            y += alpha_ * (white[k] - y);
+            if constexpr (k_mix) {
+                out[i + k] += y;
+            } else {
+                out[i + k] = y;
+            }
+        }
+    }
+    filtered_ = y;
+}
+
+Envelope::Envelope(Clock::duration sample_time) : sample_time_s_(toSeconds(sample_time)) { updateSteps(); }
+
+void Envelope::setSampleTime(Clock::duration sample_time) {
+    sample_time_s_ = toSeconds(sample_time);
+    updateSteps();
+}
+
+void Envelope::setAttack(Clock::duration attack) {
+    attack_s_ = toSeconds(attack);
+    updateSteps();
+}
+
+void Envelope::setRelease(Clock::duration release) {
+    release_s_ = toSeconds(release);
+    updateSteps();
+}
+
+void Envelope::updateSteps() {
+    attack_step_  = attack_s_ > 0.0 ? (float)(sample_time_s_ / attack_s_) : 1.0f;
+    release_step_ = release_s_ > 0.0 ? (float)(sample_time_s_ / release_s_) : 1.0f;
+}
+
+void Envelope::apply(float* inout, unsigned count) {
+    if (count == 0) return;
+
+    // Level of each sample is computed from the block start level, so that the loop has no dependency between samples
+    // and can be vectorized by the compiler
+    const float start = level_;
+    if (gate_) {
+        if (start >= 1.0f) return;
+
+        for (unsigned i = 0; i < count; ++i) {
+            inout[i] *= std::min(1.0f, start + (float)(i + 1) * attack_step_);
+        }
+        level_ = std::min(1.0f, start + (float)count * attack_step_);
+    } else {
+        for (unsigned i = 0; i < count; ++i) {
+            inout[i] *= std::max(0.0f, start - (float)(i + 1) * release_step_);
+        }
+        level_ = std::max(0.0f, start - (float)count * release_step_);
+    }
+}
+
+KerbGenerator::KerbGenerator(Clock::duration sample_time)
+    : bumps_(Waveform::bump, sample_time), rumble_(0x4b657262u, sample_time) {
+    bumps_.setDutyCycle(0.5f);
+    rumble_.setCutoffFrequency(60.0f);
+    setAmplitude(amplitude_);
+}
+
+void KerbGenerator::setSampleTime(Clock::duration sample_time) {
+    bumps_.setSampleTime(sample_time);
+    rumble_.setSampleTime(sample_time);
+}
+
+void KerbGenerator::setAmplitude(float amplitude) {
+    amplitude_ = amplitude;
+    bumps_.setAmplitude(amplitude);
+    rumble_.setAmplitude(amplitude * roughness_);
+}
+
+void KerbGenerator::setRoughness(float roughness) {
+    roughness_ = roughness;
+    rumble_.setAmplitude(amplitude_ * roughness);
+}
+
+void KerbGenerator::render(float* out, unsigned count) {
+    std::fill(out, out + count, 0.0f);
+    mix(out, count);
+}
+
+void KerbGenerator::mix(float* out, unsigned count) {
+    if (speed_m_s_ <= 0.0f || spacing_m_ <= 0.0f) return;
+
+    bumps_.setFrequency(speed_m_s_ / spacing_m_);
+    bumps_.mix(out, count);
+    rumble_.mix(out, count);
+}
+
+void scale(float* inout, unsigned count, float gain) {
+    for (unsigned i = 0; i < count; ++i) {
+        inout[i] *= gain;
+    }
+}
+
+void clamp(float* inout, unsigned count, float lo, float hi) {
+    for (unsigned i = 0; i < count; ++i) {
+        inout[i] = std::min(hi, std::max(lo, inout[i]));
+    }
+}
+
+}  // namespace sc_api::core::synthesis
@@ -0,0 +1,75 @@
+#include "sample_quantization.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SC_API_QUANTIZATION_SSE2 1
+#endif
+
+namespace sc_api::core::internal {
+
+namespace {
+
+/** Clamping is done in float domain so that out of range values can't overflow the int32 conversion */
+constexpr float k_i16_min = -32767.0f;
+constexpr float k_i16_max = 32767.0f;
+constexpr float k_u16_min = 0.0f;
+constexpr float k_u16_max = 65535.0f;
+
+/** Scale, clamp and round to nearest even, same as the SSE2 conversion does with the default rounding mode */
+inline int32_t quantizeScalar(float v, float scale, float lo, float hi) {
+    v *= scale;
+    v = v > lo ? v : lo;  // Also replaces NaN
+    v = v < hi ? v : hi;
+    return (int32_t)std::nearbyint(v);
+}
+
+}  // namespace
+
+void quantizeToI16(const float* in, unsigned count, float scale, uint8_t* out) {
+    unsigned i = 0;
+#ifdef SC_API_QUANTIZATION_SSE2
+    const __m128 s  = _mm_set1_ps(scale);
+    const __m128 lo = _mm_set1_ps(k_i16_min);
+    const __m128 hi = _mm_set1_ps(k_i16_max);
+    for (; i + 8 <= count; i += 8) {
+        // _mm_max_ps returns the second operand if the first is NaN
+        __m128  a  = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), s), lo), hi);
+        __m128  b  = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), s), lo), hi);
+        __m128i v  = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * sizeof(int16_t)), v);
+    }
+#endif
+    for (; i < count; ++i) {
+        const int16_t v = (int16_t)quantizeScalar(in[i], scale, k_i16_min, k_i16_max);
+        std::memcpy(out + i * sizeof(int16_t), &v, sizeof(v));
+    }
+}
+
+void quantizeToU16(const float* in, unsigned count, float scale, uint8_t* out) {
+    unsigned i = 0;
+#ifdef SC_API_QUANTIZATION_SSE2
+    // SSE2 only has signed saturating pack, so values are biased to signed range and the sign bit flipped back after
+    const __m128  s    = _mm_set1_ps(scale);
+    const __m128  lo   = _mm_set1_ps(k_u16_min);
+    const __m128  hi   = _mm_set1_ps(k_u16_max);
+    const __m128i bias = _mm_set1_epi32(32768);
+    const __m128i flip = _mm_set1_epi16((short)0x8000);
+    for (; i + 8 <= count; i += 8) {
+        __m128  a  = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), s), lo), hi);
+        __m128  b  = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), s), lo), hi);
+        __m128i ai = _mm_sub_epi32(_mm_cvtps_epi32(a), bias);
+        __m128i bi = _mm_sub_epi32(_mm_cvtps_epi32(b), bias);
+        __m128i v  = _mm_xor_si128(_mm_packs_epi32(ai, bi), flip);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * sizeof(uint16_t)), v);
+    }
+#endif
+    for (; i < count; ++i) {
+        const uint16_t v = (uint16_t)quantizeScalar(in[i], scale, k_u16_min, k_u16_max);
+        std::memcpy(out + i * sizeof(uint16_t), &v, sizeof(v));
+    }
+}
+
+}  // namespace sc_api::core::internal
@@ -0,0 +1,32 @@
+/**
+ * @file
+ * @brief Conversion of float effect samples to the 16-bit effect sample formats
+ *
+ */
+
+#ifndef SC_API_INTERNAL_SAMPLE_QUANTIZATION_H_
+#define SC_API_INTERNAL_SAMPLE_QUANTIZATION_H_
+#include <cstdint>
+
+namespace sc_api::core::internal {
+
+/** Quantize samples to SC_API_PROTOCOL_FB_SAMPLE_FORMAT_I16
+ *
+ * Each output is round(in * scale) saturated to range [-32767, 32767], so that full scale is symmetric. NaN is
+ * converted to the lower limit.
+ *
+ * @param out Output buffer for count values. Doesn't have to be aligned
+ */
+void quantizeToI16(const float* in, unsigned count, float scale, uint8_t* out);
+
+/** Quantize samples to SC_API_PROTOCOL_FB_SAMPLE_FORMAT_U16
+ *
+ * Each output is round(in * scale) saturated to range [0, 65535]. NaN is converted to 0.
+ *
+ * @param out Output buffer for count values. Doesn't have to be aligned
+ */
+void quantizeToU16(const float* in, unsigned count, float scale, uint8_t* out);
+
+}  // namespace sc_api::core::internal
+
+#endif  // SC_API_INTERNAL_SAMPLE_QUANTIZATION_H_
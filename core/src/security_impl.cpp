@@ -91,7 +91,7 @@ void SecureSession::encrypt(uint8_t* iv, uint8_t* aad, uint32_t aad_len, uint8_t
     SC_API_gcm_finish(&gcm_ctx, tag, k_tag_len);
 }
 
-std::vector<uint8_t> SecureSession::handleIV() {
+const std::vector<uint8_t>& SecureSession::handleIV() {
     if (!iv_.empty()) {
         for (std::size_t i = 0; i < iv_.size(); i++) {
             iv_[i]++;
@@ -33,7 +33,7 @@ private:
     /** Generate or increment iv if already generated, return iv after
      * TODO: IV generation is not secure with current implementation!
      */
-    std::vector<uint8_t> handleIV();
+    const std::vector<uint8_t>& handleIV();
 
     static constexpr uint8_t k_iv_len  = 12;
     static constexpr uint8_t k_tag_len = 12;
@@ -1,9 +1,11 @@
 #include "sc-api/core/session.h"
 
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <iostream>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -21,6 +23,12 @@
 #include "sc-api/core/version.h"
 #include "security_impl.h"
 
+#ifdef __linux__
+#include <sys/socket.h>
+
+#include <cerrno>
+#endif
+
 namespace sc_api::core {
 
 /** Sync state for blocking commands */
@@ -219,7 +227,7 @@ Session::PeriodicTimerHandle Session::createPeriodicTimer(std::chrono::milliseco
     assert(emplace_result.second);
     auto& timer = emplace_result.first->second;
 
-    p_->startPeriodicTimer(timer, period, std::move(callback));
+    p_->startPeriodicTimer(timer, id, period, std::move(callback));
     return PeriodicTimerHandle(this, id);
 }
 
@@ -411,6 +419,13 @@ ResultCode Session::registerToControl(uint32_t control_flags, const std::string&
         return ResultCode::error_cannot_connect;
     }
 
+#ifdef SC_API_IO_URING
+    p_->uring_transport =
+        internal::UringTransport::create(p_->high_priority_socket_target.data(),
+                                         (uint32_t)p_->high_priority_socket_target.size(), p_->maxPlaintextDatagramSize());
+    p_->batch_transport_active = p_->uring_transport != nullptr;
+#endif
+
     p_->main_socket.connect(
         asio::ip::tcp::endpoint(asio::ip::make_address_v4(tcp_ipv4_address), p_->session_ptr->tcp_core_port), ec);
     if (ec) {
@@ -543,12 +558,180 @@ void Session::stop() {
 Session::State Session::getState() const { return state_; }
 
 bool Session::Internal::sendHighPrio(const char* raw_data, std::size_t length) {
-    std::lock_guard  lock(high_prio_mutex);
+    std::lock_guard                 lock(high_prio_mutex);
+    internal::ActionStatsCollector* stats = actionStats();
+    const int64_t                   start = stats ? internal::ActionStatsCollector::now() : 0;
+
     asio::error_code ec;
     high_priority_socket.send_to(asio::buffer(raw_data, length), high_priority_socket_target, 0, ec);
+
+    if (stats) {
+        stats->recordSend(internal::ActionStatsCollector::now() - start);
+        stats->addActions((const uint8_t*)raw_data, length);
+        stats->addDatagramResult(!ec                               ? ActionResult::complete
+                                 : ec == asio::error::would_block ? ActionResult::would_block
+                                                                  : ActionResult::failed);
+    }
     return !ec;
 }
 
+bool Session::startActionSender(const ActionSenderConfig& config) {
+    if (p_->action_sender) return false;
+
+    p_->action_sender = std::make_unique<internal::ActionSender>(*p_, config, ++p_->action_sender_generation);
+    p_->active_action_sender.store(p_->action_sender.get());
+    return true;
+}
+
+void Session::stopActionSender() {
+    p_->active_action_sender.store(nullptr);
+
+    // Producers that loaded the sender before it was cleared may still be pushing to its rings
+    while (p_->action_sender_users.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+    p_->action_sender.reset();
+}
+
+void Session::setActionStatsEnabled(bool enabled) {
+    std::lock_guard lock(p_->high_prio_mutex);
+    if (enabled && !p_->action_stats_storage) {
+        p_->action_stats_storage = std::make_unique<internal::ActionStatsCollector>();
+    }
+    p_->action_stats.store(enabled ? p_->action_stats_storage.get() : nullptr, std::memory_order_release);
+}
+
+ActionStats Session::getActionStats() const {
+    std::lock_guard lock(p_->high_prio_mutex);
+    return p_->action_stats_storage ? p_->action_stats_storage->snapshot() : ActionStats();
+}
+
+void Session::resetActionStats() {
+    std::lock_guard lock(p_->high_prio_mutex);
+    if (p_->action_stats_storage) {
+        p_->action_stats_storage->reset();
+    }
+}
+
+void Session::setEffectRecorder(std::shared_ptr<EffectRecorder> recorder) {
+    std::lock_guard lock(p_->high_prio_mutex);
+    p_->effect_recorder.store(recorder.get(), std::memory_order_release);
+    p_->effect_recorder_storage = std::move(recorder);
+}
+
+std::shared_ptr<EffectRecorder> Session::getEffectRecorder() const {
+    std::lock_guard lock(p_->high_prio_mutex);
+    return p_->effect_recorder_storage;
+}
+
+Session::Internal::AsyncSendBuffer* Session::Internal::acquireSendBuffer() {
+    std::lock_guard lock(send_buffer_pool_mutex);
+    if (!free_send_buffers.empty()) {
+        AsyncSendBuffer* buffer = free_send_buffers.back();
+        free_send_buffers.pop_back();
+        return buffer;
+    }
+
+    send_buffers.push_back(std::make_unique<AsyncSendBuffer>());
+    free_send_buffers.reserve(send_buffers.size());
+    return send_buffers.back().get();
+}
+
+void Session::Internal::releaseSendBuffer(AsyncSendBuffer* buffer) {
+    std::lock_guard lock(send_buffer_pool_mutex);
+    free_send_buffers.push_back(buffer);
+}
+
+void Session::Internal::sendHighPrioBatch(const uint8_t* data, const uint32_t* datagram_ends, std::size_t count,
+                                          ActionResult* results) {
+    std::lock_guard                 lock(high_prio_mutex);
+    internal::ActionStatsCollector* stats = actionStats();
+
+    // Datagrams that are still in progress are sent through the socket below
+    bool uring_attempted = false;
+#ifdef SC_API_IO_URING
+    if (uring_transport) {
+        const int64_t start = stats ? internal::ActionStatsCollector::now() : 0;
+        const bool    ok    = uring_transport->send(data, datagram_ends, count, results);
+        if (stats) stats->recordSend(internal::ActionStatsCollector::now() - start);
+        if (ok) {
+            if (stats) stats->addDatagramResults(results, count);
+            return;
+        }
+        // Kernel doesn't support required operations after all
+        uring_transport.reset();
+        batch_transport_active = false;
+        uring_attempted        = true;
+    }
+#endif
+    if (!uring_attempted) std::fill(results, results + count, ActionResult::inprogress);
+
+    std::size_t idx = 0;
+#ifdef __linux__
+    static constexpr std::size_t k_max_datagrams_per_call = 64;
+
+    mmsghdr     msgs[k_max_datagrams_per_call];
+    iovec       iovs[k_max_datagrams_per_call];
+    std::size_t msg_datagrams[k_max_datagrams_per_call];
+
+    const int fd = high_priority_socket.native_handle();
+    while (true) {
+        std::size_t n = 0;
+        for (std::size_t i = idx; i < count && n < k_max_datagrams_per_call; ++i) {
+            if (results[i] != ActionResult::inprogress) continue;
+
+            const uint32_t start        = i == 0 ? 0 : datagram_ends[i - 1];
+            iovs[n].iov_base            = const_cast<uint8_t*>(data + start);
+            iovs[n].iov_len             = datagram_ends[i] - start;
+            msgs[n]                     = {};
+            msgs[n].msg_hdr.msg_name    = high_priority_socket_target.data();
+            msgs[n].msg_hdr.msg_namelen = (socklen_t)high_priority_socket_target.size();
+            msgs[n].msg_hdr.msg_iov     = &iovs[n];
+            msgs[n].msg_hdr.msg_iovlen  = 1;
+            msg_datagrams[n++]          = i;
+        }
+        if (n == 0) break;
+        idx = msg_datagrams[0];
+
+        const int64_t start = stats ? internal::ActionStatsCollector::now() : 0;
+        int           sent  = ::sendmmsg(fd, msgs, (unsigned)n, MSG_DONTWAIT);
+        if (stats) stats->recordSend(internal::ActionStatsCollector::now() - start);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+
+            // sendmmsg reports error only for the first datagram that could not be sent, skip it and continue
+            results[msg_datagrams[0]] = ActionResult::failed;
+            continue;
+        }
+
+        for (int i = 0; i < sent; ++i) {
+            results[msg_datagrams[i]] = ActionResult::complete;
+        }
+    }
+#else
+    for (; idx < count; ++idx) {
+        if (results[idx] != ActionResult::inprogress) continue;
+
+        const uint32_t   start = idx == 0 ? 0 : datagram_ends[idx - 1];
+        asio::error_code ec;
+        const int64_t    send_start = stats ? internal::ActionStatsCollector::now() : 0;
+        high_priority_socket.send_to(asio::buffer(data + start, datagram_ends[idx] - start),
+                                     high_priority_socket_target, 0, ec);
+        if (stats) stats->recordSend(internal::ActionStatsCollector::now() - send_start);
+        if (ec == asio::error::would_block) break;
+        results[idx] = ec ? ActionResult::failed : ActionResult::complete;
+    }
+#endif
+
+    // Socket send buffer is full so the rest would block too
+    for (; idx < count; ++idx) {
+        if (results[idx] == ActionResult::inprogress) results[idx] = ActionResult::would_block;
+    }
+
+    if (stats) stats->addDatagramResults(results, count);
+}
+
 bool Session::Internal::startSendCommand(std::vector<uint8_t> tx_data, int32_t cmd_id,
                                          std::function<void(const AsyncCommandResult&)> cb) {
     std::lock_guard lock(main_socket_mutex);
@@ -698,13 +881,28 @@ void Session::Internal::parsePacket(const uint8_t* data, int32_t size) {
     }
 }
 
-void Session::Internal::startPeriodicTimer(asio::steady_timer& timer, std::chrono::milliseconds period,
+void Session::Internal::startPeriodicTimer(asio::steady_timer& timer, int32_t id, std::chrono::milliseconds period,
                                            std::function<void()>&& cb) {
     timer.expires_after(period);
-    timer.async_wait([this, &timer, period, cb = std::move(cb)](asio::error_code ec) mutable {
-        if (!ec) {
-            cb();
-            startPeriodicTimer(timer, period, std::move(cb));
+    timer.async_wait([this, id, period, cb = std::move(cb)](asio::error_code ec) mutable {
+        if (ec) return;
+
+        {
+            // Cancel doesn't stop a handler that has already expired, so the timer may be destroyed by now
+            std::lock_guard lock(p_->m_);
+            if (periodic_timers.find(id) == periodic_timers.end()) return;
+            running_periodic_timers[id] = std::this_thread::get_id();
+        }
+
+        cb();
+
+        std::lock_guard lock(p_->m_);
+        running_periodic_timers.erase(id);
+        periodic_timer_cv.notify_all();
+
+        auto it = periodic_timers.find(id);
+        if (it != periodic_timers.end()) {
+            startPeriodicTimer(it->second, id, period, std::move(cb));
         }
     });
 }
@@ -714,13 +912,20 @@ void Session::PeriodicTimerHandle::destroy() noexcept {
     auto s = session_.lock();
 
     if (s) {
-        std::lock_guard lock(s->m_);
-        auto&           timer_map = s->p_->periodic_timers;
-        auto            it        = timer_map.find(handle_);
+        std::unique_lock lock(s->m_);
+        auto&            timer_map = s->p_->periodic_timers;
+        auto             it        = timer_map.find(handle_);
         if (it != timer_map.end()) {
             it->second.cancel();
             timer_map.erase(it);
         }
+
+        // Callback must not run after this returns, unless it is destroying its own timer
+        auto& running = s->p_->running_periodic_timers;
+        auto  r       = running.find(handle_);
+        if (r != running.end() && r->second != std::this_thread::get_id()) {
+            s->p_->periodic_timer_cv.wait(lock, [&]() { return running.count(handle_) == 0; });
+        }
     }
 
     session_.reset();
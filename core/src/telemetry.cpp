@@ -4,14 +4,127 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <functional>
 
 #include "api_internal.h"
 #include "sc-api/core/protocol/telemetry.h"
 #include "sc-api/core/session.h"
 #include "telemetry_internal.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SC_API_TELEMETRY_SSE2 1
+#endif
+
 namespace sc_api::core {
 
+namespace {
+
+/** Pack boolean values to 32-bit words. Value i is bit i % 32 of word i / 32
+ *
+ * @return Pointer past the last written word
+ */
+uint8_t* packBools(const uint8_t* const* bufs, unsigned count, uint8_t* out) {
+    unsigned i = 0;
+#ifdef SC_API_TELEMETRY_SSE2
+    // Values are scattered, so they are collected to a contiguous block first and converted to bits with movemask
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 32 <= count; i += 32) {
+        alignas(16) uint8_t bytes[32];
+        for (unsigned k = 0; k < 32; ++k) bytes[k] = *bufs[i + k];
+
+        const uint32_t lo   = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)bytes), zero));
+        const uint32_t hi   = (uint32_t)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(bytes + 16)), zero));
+        const uint32_t word = ~(lo | (hi << 16));
+        std::memcpy(out, &word, 4);
+        out += 4;
+    }
+#endif
+    while (i < count) {
+        const unsigned n    = std::min(32u, count - i);
+        uint32_t       word = 0;
+        for (unsigned k = 0; k < n; ++k) {
+            word |= (uint32_t)(*bufs[i + k] != 0) << k;
+        }
+        std::memcpy(out, &word, 4);
+        out += 4;
+        i += n;
+    }
+    return out;
+}
+
+/** Copy values of k_size bytes from the segments
+ *
+ * @return Pointer past the last written value
+ */
+template <std::size_t k_size, typename Segment>
+uint8_t* packValues(const Segment* segments, unsigned segment_count, uint8_t* out) {
+    for (unsigned i = 0; i < segment_count; ++i) {
+        const Segment& seg = segments[i];
+        if (seg.count == 1) {
+            // Fixed size copy compiles to a single load and store
+            std::memcpy(out, seg.src, k_size);
+            out += k_size;
+        } else {
+            std::memcpy(out, seg.src, k_size * seg.count);
+            out += k_size * seg.count;
+        }
+    }
+    return out;
+}
+
+/** Read serialized numeric value as double for deadband comparison */
+double readValue(const uint8_t* p, Type::BaseType type) {
+    switch (type) {
+        case Type::i8:
+            return (int8_t)p[0];
+        case Type::u8:
+            return p[0];
+        case Type::i16: {
+            int16_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case Type::u16: {
+            uint16_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case Type::i32: {
+            int32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case Type::u32: {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case Type::i64: {
+            int64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return (double)v;
+        }
+        case Type::f32: {
+            float v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case Type::f64: {
+            double v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        default:
+            assert(false);
+            return 0.0;
+    }
+}
+
+}  // namespace
+
 static int baseTypeSizeIndex(Type::BaseType b) {
     switch (b) {
         case Type::boolean:
@@ -64,13 +177,32 @@ bool TelemetryUpdateGroup::configure(std::vector<TelemetryBase*> telemetries, co
 }
 
 bool TelemetryUpdateGroup::configure(const TelemetryDefinitions& definitions) {
+    if (!buildRegistration(definitions)) return false;
+
+    prepared_ = action_builder_.sendBlocking() == ActionResult::complete;
+    return prepared_;
+}
+
+ActionResult TelemetryUpdateGroup::configureNonBlocking(const TelemetryDefinitions& definitions) {
+    if (!buildRegistration(definitions)) return ActionResult::failed;
+
+    const ActionResult result = action_builder_.sendNonBlocking();
+    // Registration is built again on retry
+    if (result == ActionResult::would_block) action_builder_.reset();
+    prepared_ = result == ActionResult::complete;
+    return result;
+}
+
+bool TelemetryUpdateGroup::buildRegistration(const TelemetryDefinitions& definitions) {
     if (!definitions.getSession() || telemetries_.empty()) return false;
 
     action_builder_.init(definitions.getSession());
     prepared_ = false;
 
-    base_value_bufs_.clear();
+    bool_bufs_.clear();
+    value_segments_.clear();
     for (auto& v : base_value_entries_by_size_) v = 0;
+    for (auto& v : segments_by_size_) v = 0;
 
     for (TelemetryBase* t : telemetries_) {
         if (const TelemetryDefinition* def = definitions.find(t->getName(), t->getType())) {
@@ -101,19 +233,31 @@ bool TelemetryUpdateGroup::configure(const TelemetryDefinitions& definitions) {
 
     uint32_t expected_size         = 0;
     uint32_t register_payload_size = 6;
+    uint16_t value_count           = 0;
     for (TelemetryBase* t : telemetries_) {
         // Mapping doesn't match
         if (t->ref_state_.id == 0) continue;
 
-        base_value_bufs_.push_back(t->getSerializedValueBuf());
-        int base_type_size_idx = baseTypeSizeIndex(t->getType().getBaseType());
+        const uint8_t* buf                = t->getSerializedValueBuf();
+        int            base_type_size_idx = baseTypeSizeIndex(t->getType().getBaseType());
         base_value_entries_by_size_[base_type_size_idx]++;
+        ++value_count;
+        register_payload_size += 2;
 
-        if (base_type_size_idx != 0) {
-            expected_size += 1u << (base_type_size_idx - 1);
+        if (base_type_size_idx == 0) {
+            bool_bufs_.push_back(buf);
+            continue;
         }
 
-        register_payload_size += 2;
+        // Values are sorted by size, so a value can only continue the latest segment
+        const uint32_t value_size = 8u >> (base_type_size_idx - 1);
+        uint16_t&      segments   = segments_by_size_[base_type_size_idx - 1];
+        if (segments > 0 && value_segments_.back().src + value_segments_.back().count * value_size == buf) {
+            value_segments_.back().count++;
+        } else {
+            value_segments_.push_back(PackSegment{buf, 1});
+            ++segments;
+        }
     }
     // Bools are stored as 32bit words and total space used by them is aligned to 8 bytes
     expected_size = ((base_value_entries_by_size_[0] + 63u + 32u) / 64) * 8;
@@ -143,90 +287,172 @@ bool TelemetryUpdateGroup::configure(const TelemetryDefinitions& definitions) {
     payload[1]        = group_id_ >> 8;
 
     // Number of telemetries in this update group
-    payload[2]        = (uint8_t)(base_value_bufs_.size() & 0xff);
-    payload[3]        = (uint8_t)(base_value_bufs_.size() >> 8);
+    payload[2]        = (uint8_t)(value_count & 0xff);
+    payload[3]        = (uint8_t)(value_count >> 8);
 
     // Size of set telemetry group packet
     payload[4]        = (uint8_t)(expected_size & 0xff);
     payload[5]        = (uint8_t)(expected_size >> 8);
     set_payload_size_ = expected_size + 4;
 
-    prepared_         = action_builder_.sendBlocking() == ActionResult::complete;
-    return prepared_;
+    // Layout of the values in the set payload for change tracking. Values that have a deadband are compared
+    // numerically and everything between them byte by byte.
+    deadband_checks_.clear();
+    exact_ranges_.clear();
+    uint32_t offset = (4 + ((base_value_entries_by_size_[0] + 31u) / 32) * 4 + 7) & ~7u;
+    uint32_t exact  = 0;
+    for (TelemetryBase* t : telemetries_) {
+        const int base_type_size_idx = baseTypeSizeIndex(t->getType().getBaseType());
+        if (t->ref_state_.id == 0 || base_type_size_idx == 0) continue;
+
+        const uint32_t value_size = 8u >> (base_type_size_idx - 1);
+        if (t->getDeadband() > 0.0) {
+            if (offset > exact) exact_ranges_.push_back(PayloadRange{(uint16_t)exact, (uint16_t)(offset - exact)});
+            deadband_checks_.push_back(DeadbandCheck{(uint16_t)offset, t->getType().getBaseType(), t->getDeadband()});
+            exact = offset + value_size;
+        }
+        offset += value_size;
+    }
+    if (set_payload_size_ > exact) {
+        exact_ranges_.push_back(PayloadRange{(uint16_t)exact, (uint16_t)(set_payload_size_ - exact)});
+    }
+
+    packed_payload_.assign(set_payload_size_, 0);
+    sent_payload_.assign(set_payload_size_, 0);
+    has_sent_ = false;
+    return true;
 }
 
 ActionResult TelemetryUpdateGroup::send() {
-    if (!prepared_) return ActionResult::failed;
+    switch (buildUpdate(action_builder_)) {
+        case BuildResult::built:
+            break;
+        case BuildResult::unchanged:
+            return ActionResult::complete;
+        case BuildResult::failed:
+            return ActionResult::failed;
+    }
 
-    uint8_t* payload = action_builder_.startBuilding(SC_API_PROTOCOL_ACTION_SET_TELEMETRY_GROUP, set_payload_size_);
-    if (!payload) return ActionResult::failed;
+    const ActionResult result = action_builder_.sendNonBlocking();
+    // Values didn't reach the backend, so don't skip the next update
+    if (result != ActionResult::complete) has_sent_ = false;
+    return result;
+}
 
-    unsigned bool_telemetry_count = base_value_entries_by_size_[0];
-    auto     t_buf_it             = base_value_bufs_.begin();
-    int      payload_idx          = 4;
+bool TelemetryUpdateGroup::send(ActionBatch& batch) {
+    switch (buildUpdate(action_builder_)) {
+        case BuildResult::built:
+            if (batch.add(action_builder_)) return true;
+            has_sent_ = false;
+            return false;
+        case BuildResult::unchanged:
+            return true;
+        case BuildResult::failed:
+        default:
+            return false;
+    }
+}
 
-    payload[0]                    = group_id_ & 0xff;
-    payload[1]                    = group_id_ >> 8;
+bool TelemetryUpdateGroup::build(ActionBuilder& builder) { return buildUpdate(builder) == BuildResult::built; }
 
-    // placeholder & alignment
-    payload[2]                    = 0;
-    payload[3]                    = 0;
-
-    // Full words
-    uint32_t word                 = 0;
-    unsigned bit_idx              = 0;
-    for (bit_idx = 0; bit_idx < bool_telemetry_count; ++bit_idx) {
-        const uint8_t* bool_buf = *t_buf_it;
-        if (*(const bool*)bool_buf) {
-            word |= 1u << (bit_idx % 32);
-        }
-        t_buf_it++;
+void TelemetryUpdateGroup::enableChangeTracking(Clock::duration keep_alive) {
+    keep_alive_      = keep_alive;
+    change_tracking_ = true;
+    has_sent_        = false;
+}
 
-        if ((bit_idx + 1) % 32 == 0) {
-            std::memcpy(&payload[payload_idx], &word, 4);
-            payload_idx += 4;
-        }
-    }
-    if (bit_idx % 32 != 0) {
-        std::memcpy(&payload[payload_idx], &word, 4);
-        payload_idx += 4;
-    }
+void TelemetryUpdateGroup::disableChangeTracking() { change_tracking_ = false; }
 
-    // Align up to 8 bytes
-    payload_idx                    = (payload_idx + 7) & ~7;
+TelemetryUpdateGroup::BuildResult TelemetryUpdateGroup::buildUpdate(ActionBuilder& builder) {
+    last_skipped_ = false;
+    if (!prepared_) return BuildResult::failed;
 
-    unsigned telemetry_64bit_count = base_value_entries_by_size_[1];
-    for (unsigned i = 0; i < telemetry_64bit_count; ++i) {
-        std::memcpy(&payload[payload_idx], *t_buf_it, 8);
-        payload_idx += 8;
-        t_buf_it++;
+    if (!change_tracking_) {
+        uint8_t* payload = builder.startBuilding(SC_API_PROTOCOL_ACTION_SET_TELEMETRY_GROUP, set_payload_size_);
+        if (!payload) return BuildResult::failed;
+
+        packPayload(payload);
+        return BuildResult::built;
     }
-    unsigned telemetry_32bit_count = base_value_entries_by_size_[2];
-    for (unsigned i = 0; i < telemetry_32bit_count; ++i) {
-        std::memcpy(&payload[payload_idx], *t_buf_it, 4);
-        payload_idx += 4;
-        t_buf_it++;
+
+    packPayload(packed_payload_.data());
+
+    const Clock::time_point now = Clock::now();
+    if (has_sent_ && now - last_sent_time_ < keep_alive_ && !hasChanged(packed_payload_.data())) {
+        ++skipped_updates_;
+        last_skipped_ = true;
+        return BuildResult::unchanged;
     }
-    unsigned telemetry_16bit_count = base_value_entries_by_size_[3];
-    for (unsigned i = 0; i < telemetry_16bit_count; ++i) {
-        std::memcpy(&payload[payload_idx], *t_buf_it, 2);
-        payload_idx += 2;
-        t_buf_it++;
+
+    uint8_t* payload = builder.startBuilding(SC_API_PROTOCOL_ACTION_SET_TELEMETRY_GROUP, set_payload_size_);
+    if (!payload) return BuildResult::failed;
+
+    std::memcpy(payload, packed_payload_.data(), set_payload_size_);
+    packed_payload_.swap(sent_payload_);
+    last_sent_time_ = now;
+    has_sent_       = true;
+    return BuildResult::built;
+}
+
+bool TelemetryUpdateGroup::hasChanged(const uint8_t* payload) const {
+    const uint8_t* sent = sent_payload_.data();
+    if (deadband_checks_.empty()) return std::memcmp(payload, sent, set_payload_size_) != 0;
+
+    for (const PayloadRange& r : exact_ranges_) {
+        if (std::memcmp(payload + r.offset, sent + r.offset, r.size) != 0) return true;
     }
-    unsigned telemetry_8bit_count = base_value_entries_by_size_[4];
-    for (unsigned i = 0; i < telemetry_8bit_count; ++i) {
-        payload[payload_idx++] = **t_buf_it;
-        t_buf_it++;
+
+    for (const DeadbandCheck& c : deadband_checks_) {
+        const double value = readValue(payload + c.offset, c.type);
+        const double prev  = readValue(sent + c.offset, c.type);
+        // Change to or from NaN is a change, but NaN that stays NaN isn't
+        if (!(std::fabs(value - prev) <= c.deadband) && !(std::isnan(value) && std::isnan(prev))) return true;
     }
+    return false;
+}
 
-    return action_builder_.sendNonBlocking();
+void TelemetryUpdateGroup::packPayload(uint8_t* payload) const {
+    payload[0] = group_id_ & 0xff;
+    payload[1] = group_id_ >> 8;
+
+    // placeholder & alignment
+    payload[2] = 0;
+    payload[3] = 0;
+
+    uint8_t* out = packBools(bool_bufs_.data(), (unsigned)bool_bufs_.size(), payload + 4);
+
+    // Align up to 8 bytes
+    out = payload + ((out - payload + 7) & ~7);
+
+    const PackSegment* segments_64bit = value_segments_.data();
+    const PackSegment* segments_32bit = segments_64bit + segments_by_size_[0];
+    const PackSegment* segments_16bit = segments_32bit + segments_by_size_[1];
+    const PackSegment* segments_8bit  = segments_16bit + segments_by_size_[2];
+
+    out = packValues<8>(segments_64bit, segments_by_size_[0], out);
+    out = packValues<4>(segments_32bit, segments_by_size_[1], out);
+    out = packValues<2>(segments_16bit, segments_by_size_[2], out);
+    packValues<1>(segments_8bit, segments_by_size_[3], out);
 }
 
 ActionResult TelemetryUpdateGroup::disable() {
+    if (!buildDisable()) return ActionResult::failed;
+    return action_builder_.sendBlocking();
+}
+
+ActionResult TelemetryUpdateGroup::disableNonBlocking() {
+    if (!buildDisable()) return ActionResult::failed;
+
+    const ActionResult result = action_builder_.sendNonBlocking();
+    if (result == ActionResult::would_block) action_builder_.reset();
+    return result;
+}
+
+bool TelemetryUpdateGroup::buildDisable() {
     static constexpr uint32_t k_empty_group_size = 6;
     uint8_t*                  payload =
         action_builder_.startBuilding(SC_API_PROTOCOL_ACTION_REGISTER_TELEMETRY_GROUP, k_empty_group_size);
-    if (!payload) return ActionResult::failed;
+    if (!payload) return false;
 
     payload[0] = group_id_ & 0xff;
     payload[1] = group_id_ >> 8;
@@ -239,8 +465,7 @@ ActionResult TelemetryUpdateGroup::disable() {
     payload[4] = 0;
     payload[5] = 0;
     prepared_  = false;
-
-    return action_builder_.sendBlocking();
+    return true;
 }
 
 TelemetryBase::TelemetryBase(std::string&& name, Type type) : name_(std::move(name)), type_(type), ref_state_{0, 0} {}
@@ -308,6 +533,7 @@ bool TelemetrySystem::updateDefinitions() {
         def.variable_idx = def_ptr->alias_variable_idx;
         def_storage->defs.push_back(std::move(def));
     }
+    def_storage->buildIndex();
     std::atomic_thread_fence(std::memory_order_release);
     cur_defs_ = std::move(def_storage);
     return true;
@@ -322,28 +548,54 @@ TelemetryDefinitions TelemetrySystem::getDefinitions(const std::shared_ptr<Sessi
 
 TelemetryDefinitions::TelemetryDefinitions() : s_(s_empty_storage) {}
 
-const TelemetryDefinition* TelemetryDefinitions::find(std::string_view name) const {
-    for (const TelemetryDefinition& def : s_->defs) {
-        if (def.name == name) return &def;
+void TelemetryDefinitions::DefStorage::buildIndex() {
+    // At most half full, so that probe sequences stay short
+    std::size_t table_size = 16;
+    while (table_size < defs.size() * 2) table_size *= 2;
+
+    name_index.assign(table_size, NameSlot{});
+    id_index.clear();
+
+    const std::size_t mask = table_size - 1;
+    for (uint32_t i = 0; i < (uint32_t)defs.size(); ++i) {
+        const TelemetryDefinition& def  = defs[i];
+        const std::size_t          hash = std::hash<std::string_view>()(def.name);
+
+        std::size_t slot = hash & mask;
+        while (name_index[slot].def_idx != k_no_index) slot = (slot + 1) & mask;
+        name_index[slot] = NameSlot{hash, i};
+
+        if (def.id >= id_index.size()) id_index.resize((std::size_t)def.id + 1, k_no_index);
+        if (id_index[def.id] == k_no_index) id_index[def.id] = i;
     }
+}
+
+const TelemetryDefinition* TelemetryDefinitions::DefStorage::findByName(std::string_view name,
+                                                                        const Type*      type) const {
+    if (name_index.empty()) return nullptr;
 
+    const std::size_t hash = std::hash<std::string_view>()(name);
+    const std::size_t mask = name_index.size() - 1;
+    for (std::size_t slot = hash & mask; name_index[slot].def_idx != k_no_index; slot = (slot + 1) & mask) {
+        if (name_index[slot].hash != hash) continue;
+
+        const TelemetryDefinition& def = defs[name_index[slot].def_idx];
+        if (def.name == name && (!type || def.type == *type)) return &def;
+    }
     return nullptr;
 }
 
-const TelemetryDefinition* TelemetryDefinitions::find(std::string_view name, Type type) const {
-    for (const TelemetryDefinition& def : s_->defs) {
-        if (def.name == name && def.type == type) return &def;
-    }
+const TelemetryDefinition* TelemetryDefinitions::find(std::string_view name) const {
+    return s_->findByName(name, nullptr);
+}
 
-    return nullptr;
+const TelemetryDefinition* TelemetryDefinitions::find(std::string_view name, Type type) const {
+    return s_->findByName(name, &type);
 }
 
 const TelemetryDefinition* TelemetryDefinitions::find(uint16_t id) const {
-    for (const TelemetryDefinition& def : s_->defs) {
-        if (def.id == id) return &def;
-    }
-
-    return nullptr;
+    if (id >= s_->id_index.size() || s_->id_index[id] == DefStorage::k_no_index) return nullptr;
+    return &s_->defs[s_->id_index[id]];
 }
 
 TelemetryDefinitions::TelemetryDefinitions(const std::shared_ptr<DefStorage>& defs,
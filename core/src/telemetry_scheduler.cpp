@@ -0,0 +1,159 @@
+#include "sc-api/core/telemetry_scheduler.h"
+
+#include <thread>
+
+#include "sc-api/core/protocol/telemetry.h"
+
+namespace sc_api::core {
+
+TelemetryScheduler::TelemetryScheduler(const std::shared_ptr<Session>& session, const TelemetrySchedulerConfig& config)
+    : session_(session), config_(config), effect_tier_(config.effect_group_id), display_tier_(config.display_group_id) {
+    if (config_.display_keep_alive > Clock::duration::zero()) {
+        display_tier_.group.enableChangeTracking(config_.display_keep_alive);
+    }
+}
+
+TelemetryScheduler::~TelemetryScheduler() { stop(); }
+
+void TelemetryScheduler::set(std::vector<TelemetryBase*> telemetries) {
+    std::lock_guard lock(mutex_);
+    telemetries_ = std::move(telemetries);
+}
+
+void TelemetryScheduler::add(TelemetryBase* telemetry) {
+    std::lock_guard lock(mutex_);
+    telemetries_.push_back(telemetry);
+}
+
+void TelemetryScheduler::add(const std::initializer_list<TelemetryBase*>& telemetries) {
+    std::lock_guard lock(mutex_);
+    telemetries_.insert(telemetries_.end(), telemetries.begin(), telemetries.end());
+}
+
+bool TelemetryScheduler::configure() {
+    // Blocking send would wait for the event loop thread while mutex_ is held, but timer callbacks in that thread lock
+    // it. Tiers are registered without blocking and retried without holding the lock instead
+    while (true) {
+        {
+            std::lock_guard lock(mutex_);
+            const bool      ok = configureLocked();
+            if (!reconfigure_pending_) return ok;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+bool TelemetryScheduler::configureLocked() {
+    if (!session_) return false;
+
+    const TelemetryDefinitions definitions = session_->getTelemetries();
+
+    std::vector<TelemetryBase*> effect;
+    std::vector<TelemetryBase*> display;
+    for (TelemetryBase* t : telemetries_) {
+        const TelemetryDefinition* def = definitions.find(t->getName(), t->getType());
+        // Picked up when definitions change
+        if (!def) continue;
+
+        if ((def->flags & SC_API_PROTOCOL_TELEMETRY_USED_FOR_EFFECTS) != 0) {
+            effect.push_back(t);
+        } else {
+            display.push_back(t);
+        }
+    }
+
+    definition_count_ = definitions.size();
+    ++partitions_;
+
+    const ActionResult effect_result  = configureTier(effect_tier_, std::move(effect), definitions);
+    const ActionResult display_result = configureTier(display_tier_, std::move(display), definitions);
+    reconfigure_pending_ = effect_result == ActionResult::would_block || display_result == ActionResult::would_block;
+    return effect_result == ActionResult::complete && display_result == ActionResult::complete;
+}
+
+ActionResult TelemetryScheduler::configureTier(Tier& tier, std::vector<TelemetryBase*>&& telemetries,
+                                               const TelemetryDefinitions& definitions) {
+    if (telemetries.empty()) {
+        // Group without telemetries can't be configured, so values of a previous configuration are removed instead
+        if (tier.active && tier.group.disableNonBlocking() == ActionResult::would_block) {
+            return ActionResult::would_block;
+        }
+        tier.group.set({});
+        tier.active = false;
+        return ActionResult::complete;
+    }
+
+    tier.group.set(std::move(telemetries));
+    const ActionResult result = tier.group.configureNonBlocking(definitions);
+    tier.active               = result == ActionResult::complete;
+    return result;
+}
+
+bool TelemetryScheduler::start() {
+    // Old timers are stopped first, so their callbacks don't compete for the lock while configuring
+    stop();
+    const bool ok = configure();
+    if (!session_) return false;
+
+    effect_timer_  = session_->createPeriodicTimer(config_.effect_period, [this]() { sendEffectTier(); });
+    display_timer_ = session_->createPeriodicTimer(config_.display_period, [this]() { displayTick(); });
+
+    std::lock_guard lock(mutex_);
+    running_ = true;
+    return ok;
+}
+
+void TelemetryScheduler::stop() {
+    // Waits for a callback that is running in the event loop thread
+    effect_timer_.destroy();
+    display_timer_.destroy();
+
+    std::lock_guard lock(mutex_);
+    running_ = false;
+}
+
+bool TelemetryScheduler::isRunning() const {
+    std::lock_guard lock(mutex_);
+    return running_;
+}
+
+void TelemetryScheduler::displayTick() {
+    std::lock_guard lock(mutex_);
+    // Definitions are only appended within a session, so the count tells if there is anything new. This runs in the
+    // event loop thread, which must not wait for the socket
+    if (reconfigure_pending_ || session_->getTelemetries().size() != definition_count_) configureLocked();
+
+    sendTier(display_tier_);
+}
+
+ActionResult TelemetryScheduler::sendEffectTier() {
+    std::lock_guard lock(mutex_);
+    return sendTier(effect_tier_);
+}
+
+ActionResult TelemetryScheduler::sendDisplayTier() {
+    std::lock_guard lock(mutex_);
+    return sendTier(display_tier_);
+}
+
+ActionResult TelemetryScheduler::sendTier(Tier& tier) {
+    if (!tier.active) return ActionResult::failed;
+    return tier.group.send();
+}
+
+uint64_t TelemetryScheduler::getPartitionCount() const {
+    std::lock_guard lock(mutex_);
+    return partitions_;
+}
+
+std::vector<TelemetryBase*> TelemetryScheduler::getEffectTierTelemetries() const {
+    std::lock_guard lock(mutex_);
+    return effect_tier_.group.getTelemetries();
+}
+
+std::vector<TelemetryBase*> TelemetryScheduler::getDisplayTierTelemetries() const {
+    std::lock_guard lock(mutex_);
+    return display_tier_.group.getTelemetries();
+}
+
+}  // namespace sc_api::core
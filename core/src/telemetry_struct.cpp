@@ -0,0 +1,114 @@
+#include "sc-api/core/telemetry_struct.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "sc-api/core/protocol/actions.h"
+
+namespace sc_api::core {
+
+TelemetryStructGroupBase::TelemetryStructGroupBase(uint16_t group_id) : group_id_(group_id) {}
+
+TelemetryStructGroupBase::~TelemetryStructGroupBase() {}
+
+bool TelemetryStructGroupBase::configureFields(const TelemetryDefinitions& definitions, const FieldInfo* fields,
+                                               std::size_t count, uint16_t* offsets) {
+    if (!definitions.getSession()) return false;
+
+    action_builder_.init(definitions.getSession());
+    prepared_       = false;
+    complete_       = false;
+    resolved_count_ = 0;
+
+    std::vector<int>      size_idx(count, -1);
+    std::vector<uint16_t> ids(count, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (const TelemetryDefinition* def = definitions.find(fields[i].name, Type(fields[i].type))) {
+            ids[i]      = def->id;
+            size_idx[i] = internal::telemetrySizeIndex(fields[i].type);
+            ++resolved_count_;
+        }
+    }
+    if (resolved_count_ == 0) return false;
+
+    const uint32_t payload_size =
+        internal::computeTelemetryPayloadLayout(size_idx.data(), count, offsets, &bool_words_);
+    complete_        = resolved_count_ == count;
+
+    uint8_t* payload = action_builder_.startBuilding(SC_API_PROTOCOL_ACTION_REGISTER_TELEMETRY_GROUP,
+                                                     6 + 2 * (uint32_t)resolved_count_);
+    if (!payload) return false;
+
+    // Ids are listed in the order of the values in set payload
+    uint32_t pos = 6;
+    for (int idx = 0; idx < 5; ++idx) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (size_idx[i] != idx) continue;
+
+            payload[pos]     = ids[i] & 0xff;
+            payload[pos + 1] = ids[i] >> 8;
+            pos += 2;
+        }
+    }
+
+    // group id
+    payload[0]        = group_id_ & 0xff;
+    payload[1]        = group_id_ >> 8;
+
+    // Number of telemetries in this update group
+    payload[2]        = (uint8_t)(resolved_count_ & 0xff);
+    payload[3]        = (uint8_t)(resolved_count_ >> 8);
+
+    // Size of set telemetry group packet
+    payload[4]        = (uint8_t)(payload_size & 0xff);
+    payload[5]        = (uint8_t)(payload_size >> 8);
+    set_payload_size_ = payload_size + 4;
+
+    prepared_         = action_builder_.sendBlocking() == ActionResult::complete;
+    return prepared_;
+}
+
+uint8_t* TelemetryStructGroupBase::startSet(ActionBuilder& builder) {
+    if (!prepared_) return nullptr;
+
+    uint8_t* payload = builder.startBuilding(SC_API_PROTOCOL_ACTION_SET_TELEMETRY_GROUP, set_payload_size_);
+    if (!payload) return nullptr;
+
+    payload[0] = group_id_ & 0xff;
+    payload[1] = group_id_ >> 8;
+
+    // placeholder & alignment
+    payload[2] = 0;
+    payload[3] = 0;
+
+    // Values are written to their offsets, so only the gaps are cleared
+    const uint32_t bool_end     = 4 + bool_words_ * 4;
+    const uint32_t values_start = (bool_end + 7) & ~7u;
+    std::memset(payload + bool_end, 0, values_start - bool_end);
+    std::memset(payload + set_payload_size_ - 4, 0, 4);
+    return payload;
+}
+
+ActionResult TelemetryStructGroupBase::disable() {
+    static constexpr uint32_t k_empty_group_size = 6;
+    uint8_t*                  payload =
+        action_builder_.startBuilding(SC_API_PROTOCOL_ACTION_REGISTER_TELEMETRY_GROUP, k_empty_group_size);
+    if (!payload) return ActionResult::failed;
+
+    payload[0] = group_id_ & 0xff;
+    payload[1] = group_id_ >> 8;
+
+    // Number of telemetries in this update group
+    payload[2] = 0;
+    payload[3] = 0;
+
+    // Size of set telemetry group packet
+    payload[4] = 0;
+    payload[5] = 0;
+    prepared_  = false;
+
+    return action_builder_.sendBlocking();
+}
+
+}  // namespace sc_api::core
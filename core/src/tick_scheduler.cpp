@@ -0,0 +1,173 @@
+#include "sc-api/core/tick_scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "action_stats.h"
+#include "compatibility.h"
+
+#if defined(__linux__)
+#include <time.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+namespace sc_api::core {
+
+#if defined(_WIN32)
+namespace {
+
+/** High resolution waitable timer of the calling thread
+ *
+ * Regular waits are rounded to the system timer interval, which is 1 ms at best and 15.6 ms by default. High
+ * resolution timers are available since Windows 10 1803. Handle is nullptr on older versions.
+ */
+class ThreadWaitTimer {
+public:
+    ThreadWaitTimer()
+        : handle_(CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS)) {}
+    ~ThreadWaitTimer() {
+        if (handle_) CloseHandle(handle_);
+    }
+
+    ThreadWaitTimer(const ThreadWaitTimer&)            = delete;
+    ThreadWaitTimer& operator=(const ThreadWaitTimer&) = delete;
+
+    HANDLE get() const { return handle_; }
+
+private:
+    HANDLE handle_;
+};
+
+}  // namespace
+#endif
+
+struct TickScheduler::Stats {
+    std::atomic<uint64_t>      ticks{0};
+    std::atomic<uint64_t>      skipped_ticks{0};
+    std::atomic<int64_t>       spin_ns{0};
+    internal::LatencyHistogram lateness;
+};
+
+TickScheduler::TickScheduler(const TickSchedulerConfig& config)
+    : config_(config), spin_ns_(config.max_spin.count()), stats_(std::make_unique<Stats>()) {
+    stats_->spin_ns.store(spin_ns_, std::memory_order_relaxed);
+}
+
+TickScheduler::~TickScheduler() = default;
+
+bool TickScheduler::applyThreadSettings() {
+    bool ok = true;
+    if (config_.cpu >= 0 && !internal::setCurrentThreadAffinity(config_.cpu)) ok = false;
+    if (config_.realtime_priority > 0 && !internal::setCurrentThreadRealtimePriority(config_.realtime_priority)) {
+        ok = false;
+    }
+    return ok;
+}
+
+void TickScheduler::start(Clock::time_point first_deadline) {
+    deadline_ = first_deadline;
+    started_  = true;
+}
+
+void TickScheduler::sleepUntil(Clock::time_point t) {
+#if defined(__linux__)
+    // Clock may be CLOCK_MONOTONIC_RAW or TSC based, which clock_nanosleep doesn't accept. CLOCK_MONOTONIC runs at
+    // a slightly different rate, but the difference over a single period is well below the spin time.
+    const int64_t remaining = (t - Clock::now()).count();
+    if (remaining <= 0) return;
+
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t ns = (int64_t)ts.tv_nsec + remaining;
+    ts.tv_sec += (time_t)(ns / 1000000000);
+    ts.tv_nsec = (long)(ns % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+#elif defined(_WIN32)
+    const int64_t remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(t - Clock::now()).count();
+    if (remaining <= 0) return;
+
+    // Without a high resolution timer the wait could overshoot by whole milliseconds, so the caller spins instead
+    static thread_local ThreadWaitTimer timer;
+    if (!timer.get()) return;
+
+    // Negative due time is relative, in 100 ns units
+    LARGE_INTEGER due;
+    due.QuadPart = -(LONGLONG)(remaining / 100);
+    if (due.QuadPart == 0) return;
+    if (SetWaitableTimer(timer.get(), &due, 0, nullptr, nullptr, FALSE)) {
+        WaitForSingleObject(timer.get(), INFINITE);
+    }
+#else
+    const Clock::duration remaining = t - Clock::now();
+    if (remaining > Clock::duration::zero()) std::this_thread::sleep_for(remaining);
+#endif
+}
+
+Clock::time_point TickScheduler::waitNextTick() {
+    if (!started_) {
+        start();
+        stats_->ticks.fetch_add(1, std::memory_order_relaxed);
+        stats_->lateness.record(0);
+        return deadline_;
+    }
+
+    Clock::time_point now = Clock::now();
+    deadline_ += config_.period;
+
+    if (config_.skip_missed_ticks && now - deadline_ >= config_.period) {
+        const int64_t missed = (now - deadline_).count() / config_.period.count();
+        deadline_ += config_.period * missed;
+        stats_->skipped_ticks.fetch_add((uint64_t)missed, std::memory_order_relaxed);
+    }
+
+    const Clock::time_point wake = deadline_ - Clock::duration(spin_ns_);
+    if (now < wake) {
+        sleepUntil(wake);
+        now = Clock::now();
+
+        // Grow spin time right away when sleep overshoots, but shrink it slowly so that a single quiet wake up
+        // doesn't cause the next tick to be late
+        const int64_t overshoot = std::max<int64_t>(0, (now - wake).count());
+        const int64_t target    = overshoot + overshoot / 4;
+        if (target > spin_ns_) {
+            spin_ns_ = target;
+        } else {
+            spin_ns_ -= (spin_ns_ - target) / 64;
+        }
+        spin_ns_ = std::clamp(spin_ns_, (int64_t)config_.min_spin.count(), (int64_t)config_.max_spin.count());
+        stats_->spin_ns.store(spin_ns_, std::memory_order_relaxed);
+    }
+
+    while (now < deadline_) {
+        now = Clock::now();
+    }
+
+    stats_->ticks.fetch_add(1, std::memory_order_relaxed);
+    stats_->lateness.record((now - deadline_).count());
+    return deadline_;
+}
+
+TickStats TickScheduler::getStats() const {
+    TickStats s;
+    s.ticks         = stats_->ticks.load(std::memory_order_relaxed);
+    s.skipped_ticks = stats_->skipped_ticks.load(std::memory_order_relaxed);
+    s.spin_time     = Clock::duration(stats_->spin_ns.load(std::memory_order_relaxed));
+    stats_->lateness.copyTo(s.lateness);
+    return s;
+}
+
+void TickScheduler::resetStats() {
+    stats_->ticks.store(0, std::memory_order_relaxed);
+    stats_->skipped_ticks.store(0, std::memory_order_relaxed);
+    stats_->lateness.reset();
+}
+
+}  // namespace sc_api::core
@@ -20,16 +20,268 @@ int64_t getTimestamp() {
 
 int64_t getTimestampFrequencyHz() { return s_qpc_frequency_; }
 
+void initialize() {}
+
+static SourceType activeSourceType() { return SourceType::query_performance_counter; }
+
 }  // namespace sc_api::core::clock_source
 
 #else
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#include <x86intrin.h>
+#define SC_API_CLOCK_SOURCE_HAS_TSC 1
+#endif
 
 namespace sc_api::core::clock_source {
 
-int64_t getTimestamp() { return 0; }
+namespace {
+
+constexpr int64_t k_ns_per_second = 1000000000;
+
+int64_t readMonotonicRaw() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (int64_t)ts.tv_sec * k_ns_per_second + ts.tv_nsec;
+}
+
+#ifdef SC_API_CLOCK_SOURCE_HAS_TSC
+
+constexpr unsigned k_tsc_shift      = 32;
+
+/** How often the conversion is anchored again to CLOCK_MONOTONIC_RAW */
+constexpr int64_t  k_resync_ns      = k_ns_per_second;
+
+/** Larger offsets ahead of the conversion are stepped instead of slewed. Offsets behind it are slewed at most this
+ * much per resync interval, because stepping back would break monotonicity */
+constexpr int64_t  k_max_slew_ns    = 1000000;
+
+/** TSC can only be used if it ticks at constant rate regardless of P/C-states and is synchronized between cores */
+bool hasInvariantTsc() {
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(0x80000000u, &eax, &ebx, &ecx, &edx) || eax < 0x80000007u) {
+        return false;
+    }
+    if (!__get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (edx & (1u << 8)) != 0;
+}
+
+/** Take TSC and CLOCK_MONOTONIC_RAW readings as close to each other as possible */
+void sampleTscAndMonotonicRaw(uint64_t& tsc_out, int64_t& ns_out) {
+    uint64_t best_window = UINT64_MAX;
+    for (int i = 0; i < 8; ++i) {
+        uint64_t before = __rdtsc();
+        int64_t  ns     = readMonotonicRaw();
+        uint64_t after  = __rdtsc();
+
+        if (after - before < best_window) {
+            best_window = after - before;
+            tsc_out     = before + (after - before) / 2;
+            ns_out      = ns;
+        }
+    }
+}
+
+/** TSC to nanosecond conversion: ns = ns_base + (((tsc - tsc_base) * mult) >> k_tsc_shift)
+ *
+ * Calibrated against CLOCK_MONOTONIC_RAW when constructed, so that both sources produce timestamps in the same time
+ * base. Calibration has rate error of a few ppm, so the conversion is anchored again every k_resync_ns by the thread
+ * that notices it is due. Offset from CLOCK_MONOTONIC_RAW is removed by adjusting the rate for the next interval,
+ * which keeps the timestamps monotonic. Conversion is published with a sequence lock so that readers never block.
+ */
+class TscConversion {
+public:
+    TscConversion() { calibrate(); }
+
+    bool isValid() const { return valid_; }
+
+    int64_t now() {
+        const uint64_t tsc = __rdtsc();
+        uint64_t       tsc_base;
+        int64_t        ns_base;
+        uint64_t       mult;
+        load(tsc_base, ns_base, mult);
+
+        // Signed delta keeps small cross-core TSC offsets right after anchoring from wrapping around
+        const int64_t delta = (int64_t)(tsc - tsc_base);
+        if (delta > resync_tsc_) resync();
+        return ns_base + (int64_t)(((__int128)delta * (__int128)mult) >> k_tsc_shift);
+    }
+
+private:
+    void calibrate() {
+        if (!hasInvariantTsc()) return;
+
+        // Longer calibration period gives better rate accuracy. 20ms gives error in order of few ppm, which is
+        // then corrected by the periodic anchoring.
+        static constexpr timespec k_calibration_period{0, 20000000};
+
+        uint64_t tsc_start = 0, tsc_end = 0;
+        int64_t  ns_start = 0, ns_end = 0;
+        sampleTscAndMonotonicRaw(tsc_start, ns_start);
+        nanosleep(&k_calibration_period, nullptr);
+        sampleTscAndMonotonicRaw(tsc_end, ns_end);
+
+        if (tsc_end <= tsc_start || ns_end <= ns_start) return;
+
+        const uint64_t mult =
+            (uint64_t)((((unsigned __int128)(ns_end - ns_start)) << k_tsc_shift) / (tsc_end - tsc_start));
+        if (mult == 0) return;
+
+        first_tsc_  = tsc_start;
+        first_ns_   = ns_start;
+        resync_tsc_ = (int64_t)(((unsigned __int128)k_resync_ns << k_tsc_shift) / mult);
+        store(tsc_end, ns_end, mult);
+        valid_ = true;
+    }
+
+    void resync() {
+        std::unique_lock lock(resync_mutex_, std::try_to_lock);
+        // Another thread is already doing it
+        if (!lock.owns_lock()) return;
+
+        uint64_t tsc_base;
+        int64_t  ns_base;
+        uint64_t mult;
+        load(tsc_base, ns_base, mult);
+
+        uint64_t tsc = 0;
+        int64_t  raw = 0;
+        sampleTscAndMonotonicRaw(tsc, raw);
+
+        const int64_t delta = (int64_t)(tsc - tsc_base);
+        if (delta <= resync_tsc_) return;
+
+        // Rate over the whole run is accurate to well below a ppm after the first few intervals
+        const uint64_t rate =
+            (uint64_t)((((unsigned __int128)(raw - first_ns_)) << k_tsc_shift) / (tsc - first_tsc_));
+        const int64_t  cur    = ns_base + (int64_t)(((__int128)delta * (__int128)mult) >> k_tsc_shift);
+        const int64_t  offset = raw - cur;
 
-int64_t getTimestampFrequencyHz() { return 1; }
+        if (offset > k_max_slew_ns) {
+            store(tsc, raw, rate);
+        } else {
+            // Anchor stays at the value that readers may already have returned
+            const int64_t slew   = std::max(offset, -k_max_slew_ns);
+            const int64_t adjust = (int64_t)(((__int128)slew << k_tsc_shift) / resync_tsc_);
+            store(tsc, cur, (uint64_t)((int64_t)rate + adjust));
+        }
+    }
+
+    void load(uint64_t& tsc_base, int64_t& ns_base, uint64_t& mult) const {
+        uint32_t seq;
+        do {
+            seq      = seq_.load(std::memory_order_acquire);
+            tsc_base = tsc_base_.load(std::memory_order_relaxed);
+            ns_base  = ns_base_.load(std::memory_order_relaxed);
+            mult     = mult_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) != 0 || seq != seq_.load(std::memory_order_relaxed));
+    }
+
+    void store(uint64_t tsc_base, int64_t ns_base, uint64_t mult) {
+        const uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        tsc_base_.store(tsc_base, std::memory_order_relaxed);
+        ns_base_.store(ns_base, std::memory_order_relaxed);
+        mult_.store(mult, std::memory_order_relaxed);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    std::atomic<uint32_t> seq_{0};
+    std::atomic<uint64_t> tsc_base_{0};
+    std::atomic<int64_t>  ns_base_{0};
+    std::atomic<uint64_t> mult_{0};
+
+    // Constant after calibration
+    bool    valid_      = false;
+    int64_t resync_tsc_ = 0;
+
+    // Accessed only while holding resync_mutex_
+    std::mutex resync_mutex_;
+    uint64_t   first_tsc_ = 0;
+    int64_t    first_ns_  = 0;
+};
+
+TscConversion& tscConversion() {
+    static TscConversion s_conversion;
+    return s_conversion;
+}
+
+#endif
+
+}  // namespace
+
+void initialize() {
+#ifdef SC_API_CLOCK_SOURCE_HAS_TSC
+    (void)tscConversion();
+#endif
+}
+
+int64_t getTimestamp() {
+#ifdef SC_API_CLOCK_SOURCE_HAS_TSC
+    TscConversion& conv = tscConversion();
+    if (conv.isValid()) return conv.now();
+#endif
+    return readMonotonicRaw();
+}
+
+int64_t getTimestampFrequencyHz() { return k_ns_per_second; }
+
+static SourceType activeSourceType() {
+#ifdef SC_API_CLOCK_SOURCE_HAS_TSC
+    if (tscConversion().isValid()) {
+        return SourceType::tsc;
+    }
+#endif
+    return SourceType::monotonic_raw;
+}
 
 }  // namespace sc_api::core::clock_source
 
 #endif
+
+namespace sc_api::core::clock_source {
+
+SourceInfo getSourceInfo() {
+    static const SourceInfo s_info = []() {
+        static constexpr int k_read_cost_iterations = 1000;
+
+        SourceInfo info;
+        info.type         = activeSourceType();
+        info.frequency_hz = getTimestampFrequencyHz();
+
+        int64_t start     = getTimestamp();
+        for (int i = 0; i < k_read_cost_iterations - 1; ++i) {
+            (void)getTimestamp();
+        }
+        int64_t end       = getTimestamp();
+
+        info.read_cost_ns = (double)(end - start) * 1e9 / (double)info.frequency_hz / k_read_cost_iterations;
+        return info;
+    }();
+    return s_info;
+}
+
+const char* toString(SourceType type) {
+    switch (type) {
+        case SourceType::query_performance_counter:
+            return "query_performance_counter";
+        case SourceType::monotonic_raw:
+            return "monotonic_raw";
+        case SourceType::tsc:
+            return "tsc";
+    }
+    return "unknown";
+}
+
+}  // namespace sc_api::core::clock_source
@@ -0,0 +1,237 @@
+#include "uring_transport.h"
+
+#include <linux/fs.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace sc_api::core::internal {
+
+namespace {
+
+int sysIoUringSetup(unsigned entries, io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+int sysIoUringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+int sysIoUringRegister(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+unsigned loadAcquire(const unsigned* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+
+void storeRelease(unsigned* p, unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+}  // namespace
+
+UringTransport::~UringTransport() {
+    if (sqes_) munmap(sqes_, sqes_size_);
+    if (cq_ring_ && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_) munmap(sq_ring_, sq_ring_size_);
+    if (ring_fd_ >= 0) ::close(ring_fd_);
+    if (socket_fd_ >= 0) ::close(socket_fd_);
+}
+
+std::unique_ptr<UringTransport> UringTransport::create(const void* target_addr, uint32_t target_addr_len,
+                                                       uint32_t max_datagram_size) {
+    std::unique_ptr<UringTransport> transport(new UringTransport());
+
+    // Own socket, so that connecting it doesn't change the error semantics of the shared unconnected socket
+    const sockaddr* addr  = static_cast<const sockaddr*>(target_addr);
+    transport->socket_fd_ = ::socket(addr->sa_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (transport->socket_fd_ < 0) {
+        return nullptr;
+    }
+    if (::connect(transport->socket_fd_, addr, target_addr_len) != 0) {
+        return nullptr;
+    }
+
+    if (!transport->setup(max_datagram_size)) {
+        return nullptr;
+    }
+    return transport;
+}
+
+bool UringTransport::setup(uint32_t max_datagram_size) {
+    io_uring_params params{};
+    ring_fd_ = sysIoUringSetup(k_slot_count, &params);
+    if (ring_fd_ < 0) {
+        return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        return false;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                        IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            return false;
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_     = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq  = static_cast<uint8_t*>(sq_ring_);
+    auto* cq  = static_cast<uint8_t*>(cq_ring_);
+    sq_tail_  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_  = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_     = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // One registered buffer that is divided to fixed size slots
+    slot_size_ = (max_datagram_size + 63u) & ~63u;
+    buffers_.reset(static_cast<uint8_t*>(alignedAlloc(4096, (std::size_t)slot_size_ * k_slot_count)));
+    if (!buffers_) {
+        return false;
+    }
+
+    iovec iov{buffers_.get(), (std::size_t)slot_size_ * k_slot_count};
+    if (sysIoUringRegister(ring_fd_, IORING_REGISTER_BUFFERS, &iov, 1) != 0) {
+        return false;
+    }
+    if (sysIoUringRegister(ring_fd_, IORING_REGISTER_FILES, &socket_fd_, 1) != 0) {
+        return false;
+    }
+    return true;
+}
+
+bool UringTransport::send(const uint8_t* data, const uint32_t* datagram_ends, std::size_t count,
+                          ActionResult* results) {
+    std::fill(results, results + count, ActionResult::inprogress);
+
+    std::size_t base = 0;
+    while (base < count) {
+        const unsigned n    = (unsigned)std::min<std::size_t>(count - base, k_slot_count);
+        const unsigned mask = *sq_mask_;
+        unsigned       tail = *sq_tail_;
+
+        unsigned submitted = 0;
+        for (unsigned i = 0; i < n; ++i) {
+            const uint32_t start = base + i == 0 ? 0 : datagram_ends[base + i - 1];
+            const uint32_t size  = datagram_ends[base + i] - start;
+            if (size > slot_size_) {
+                results[base + i] = ActionResult::failed;
+                continue;
+            }
+
+            uint8_t* slot = buffers_.get() + (std::size_t)i * slot_size_;
+            std::memcpy(slot, data + start, size);
+
+            const unsigned idx = tail & mask;
+            io_uring_sqe&  sqe = sqes_[idx];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode     = IORING_OP_WRITE_FIXED;
+            sqe.flags      = IOSQE_FIXED_FILE;
+            sqe.fd         = 0;
+            sqe.addr       = (uint64_t)(uintptr_t)slot;
+            sqe.len        = size;
+            sqe.buf_index  = 0;
+            sqe.rw_flags   = RWF_NOWAIT;
+            sqe.user_data  = base + i;
+            sq_array_[idx] = idx;
+            ++tail;
+            ++submitted;
+        }
+        storeRelease(sq_tail_, tail);
+
+        unsigned consumed = 0;
+        if (submitted > 0) {
+            int ret;
+            do {
+                ret = sysIoUringEnter(ring_fd_, submitted, submitted, IORING_ENTER_GETEVENTS);
+            } while (ret < 0 && errno == EINTR);
+            ++submit_calls_;
+            consumed = ret < 0 ? 0 : (unsigned)ret;
+        }
+
+        if (consumed < submitted) {
+            // Kernel consumes entries in order, so the last ones weren't submitted. Take them back so that they are
+            // not submitted by the next call, and leave their datagrams unsent
+            storeRelease(sq_tail_, tail - (submitted - consumed));
+            for (unsigned i = consumed; i < submitted; ++i) {
+                const io_uring_sqe& sqe = sqes_[(tail - submitted + i) & mask];
+                results[sqe.user_data]  = ActionResult::would_block;
+            }
+        }
+
+        // Kernel doesn't wait for completions when it didn't consume all entries, so wait here for the rest
+        bool     unsupported = false;
+        unsigned reaped      = 0;
+        while (reaped < consumed) {
+            unsigned head    = *cq_head_;
+            unsigned cq_tail = loadAcquire(cq_tail_);
+            for (; head != cq_tail; ++head, ++reaped) {
+                const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+                ActionResult&       r   = results[cqe.user_data];
+                if (cqe.res >= 0) {
+                    r = ActionResult::complete;
+                } else if (cqe.res == -EAGAIN) {
+                    r = ActionResult::would_block;
+                } else if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+                    // Not sent, so the caller can send it through another path
+                    r           = ActionResult::inprogress;
+                    unsupported = true;
+                } else {
+                    // Includes ECONNREFUSED, which is an error of an earlier datagram that connected socket reports
+                    r = ActionResult::failed;
+                }
+            }
+            storeRelease(cq_head_, head);
+
+            if (reaped < consumed) {
+                int ret;
+                do {
+                    ret = sysIoUringEnter(ring_fd_, 0, consumed - reaped, IORING_ENTER_GETEVENTS);
+                } while (ret < 0 && errno == EINTR);
+                if (ret < 0) {
+                    // Datagrams whose completion is still missing may have been sent, so they must not be sent again
+                    for (std::size_t i = base; i < base + n; ++i) {
+                        if (results[i] == ActionResult::inprogress) results[i] = ActionResult::failed;
+                    }
+                    return false;
+                }
+            }
+        }
+
+        if (unsupported) {
+            return false;
+        }
+        base += n;
+    }
+    return true;
+}
+
+}  // namespace sc_api::core::internal
@@ -0,0 +1,96 @@
+/**
+ * @file
+ * @brief io_uring based transport for high priority action datagrams (Linux only)
+ *
+ */
+
+#ifndef SC_API_INTERNAL_URING_TRANSPORT_H_
+#define SC_API_INTERNAL_URING_TRANSPORT_H_
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "compatibility.h"
+#include "sc-api/core/action.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace sc_api::core::internal {
+
+/** Sends datagrams to a UDP target through io_uring
+ *
+ * Datagrams are copied to buffers that are registered to the kernel once and all datagrams of one send call are
+ * submitted with a single io_uring_enter system call. Writes are submitted with RWF_NOWAIT so that full socket send
+ * buffer is reported as ActionResult::would_block instead of blocking.
+ *
+ * Fixed buffer writes cannot specify the destination address, so the transport uses an own socket that is connected
+ * to the target. A connected socket reports ICMP port unreachable of an earlier datagram as ECONNREFUSED on a later
+ * write. That write isn't sent and its result is ActionResult::failed, but the transport stays usable like the
+ * unconnected socket of the regular path.
+ *
+ * Not thread-safe. Caller must serialize send calls.
+ */
+class UringTransport {
+public:
+    ~UringTransport();
+
+    UringTransport(const UringTransport&)            = delete;
+    UringTransport& operator=(const UringTransport&) = delete;
+
+    /** Create transport and its socket that is connected to the target address
+     *
+     * @return nullptr, if io_uring is not available on the running kernel or setting it up fails. Caller should then
+     *         use the regular socket path.
+     */
+    static std::unique_ptr<UringTransport> create(const void* target_addr, uint32_t target_addr_len,
+                                                  uint32_t max_datagram_size);
+
+    /** Send datagrams that are stored back to back in data
+     *
+     * @param[out] results Result of each datagram. ActionResult::inprogress for datagrams that weren't sent, because
+     *             the transport stopped at an unsupported operation
+     * @return false, if the kernel doesn't support required operations. Datagrams whose result is
+     *         ActionResult::inprogress should then be sent through the regular socket path, and the transport shouldn't
+     *         be used anymore.
+     */
+    bool send(const uint8_t* data, const uint32_t* datagram_ends, std::size_t count, ActionResult* results);
+
+    /** Number of io_uring_enter calls made so far */
+    uint64_t getSubmitCalls() const { return submit_calls_; }
+
+private:
+    UringTransport() = default;
+
+    bool setup(uint32_t max_datagram_size);
+
+    static constexpr uint32_t k_slot_count = 64;
+
+    int ring_fd_                           = -1;
+    int socket_fd_                         = -1;
+
+    void*       sq_ring_      = nullptr;
+    void*       cq_ring_      = nullptr;
+    std::size_t sq_ring_size_ = 0;
+    std::size_t cq_ring_size_ = 0;
+
+    unsigned* sq_tail_  = nullptr;
+    unsigned* sq_mask_  = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_  = nullptr;
+    unsigned* cq_tail_  = nullptr;
+    unsigned* cq_mask_  = nullptr;
+
+    io_uring_sqe* sqes_      = nullptr;
+    std::size_t   sqes_size_ = 0;
+    io_uring_cqe* cqes_      = nullptr;
+
+    AlignedUniquePtr<uint8_t> buffers_;
+    uint32_t                  slot_size_ = 0;
+
+    uint64_t submit_calls_ = 0;
+};
+
+}  // namespace sc_api::core::internal
+
+#endif  // SC_API_INTERNAL_URING_TRANSPORT_H_
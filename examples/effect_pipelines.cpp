@@ -93,6 +93,11 @@ int main(int argc, char* argv[]) {
         pipelineB->configure(configB);
     }
 
+    // Effects of both pedals are sent together in one datagram on every tick
+    sc_api::FfbPipelineGroup group(session);
+    if (pipelineT) group.addPipeline(*pipelineT);
+    if (pipelineB) group.addPipeline(*pipelineB);
+
     auto start_time       = sc_api::Clock::now();
 
     // 1000Hz update rate
@@ -104,8 +109,14 @@ int main(int argc, char* argv[]) {
 
     std::this_thread::sleep_for(std::chrono::seconds(1));
 
+    sc_api::TickSchedulerConfig tick_config;
+    tick_config.period = update_rate;
+    sc_api::TickScheduler ticks(tick_config);
+
     float force_N = 2;
     while (true) {
+        auto cur_time = ticks.waitNextTick();
+
         while (auto event = eventQueue->tryPop()) {
             if (auto* s = sc_api::event::getIfSessionStateChanged(&event)) {
                 if (s->state != sc_api::SessionState::connected_control) {
@@ -115,8 +126,7 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        auto    cur_time     = sc_api::Clock::now();
-        float   freq         = 20.0f;
+        float freq = 20.0f;
 
         double seconds_from_start =
             std::chrono::duration_cast<std::chrono::duration<double>>(cur_time - start_time).count();
@@ -130,19 +140,14 @@ int main(int argc, char* argv[]) {
         static constexpr uint32_t k_sample_count          = 2;
         float                     samples[k_sample_count] = {v * force_N, v * force_N};
 
-        if (pipelineT &&
-            !pipelineT->generateEffect(cur_time + sampleTimeOffset, update_rate * 2, samples, k_sample_count)) {
-            std::cerr << "T failed\n";
+        const float* pipeline_samples[2] = {samples, samples};
+        if (group.generateEffects(cur_time + sampleTimeOffset, update_rate * 2, pipeline_samples, k_sample_count) !=
+            group.getPipelineCount()) {
+            std::cerr << "Generating effects failed\n";
         }
-        if (pipelineB &&
-            !pipelineB->generateEffect(cur_time + sampleTimeOffset, update_rate * 2, samples, k_sample_count)) {
-            std::cerr << "B failed\n";
-        }
-
-        // Do some busy looping while we wait for the next update time
-        // this will cause some scheduling jitter
-        while (sc_api::Clock::now() < cur_time + update_rate) {
-            std::this_thread::yield();
+        if (group.send() != sc_api::ActionResult::complete) {
+            group.discardFrame();
+            std::cerr << "Sending effects failed\n";
         }
     }
 }
@@ -0,0 +1,111 @@
+#include <sc-api/api.h>
+#include <sc-api/device_info.h>
+#include <sc-api/events.h>
+#include <sc-api/ffb.h>
+#include <sc-api/time.h>
+
+#include <iostream>
+#include <thread>
+
+/** Streams engine vibration to the brake pedal
+ *
+ * Signal is generated in blocks of 10 samples at 1 kHz sample rate and FfbStream takes care of scheduling the samples
+ * and packing them to effect actions.
+ */
+int main(int argc, char* argv[]) {
+    sc_api::Api                              api_thread;
+    std::unique_ptr<sc_api::Api::EventQueue> eventQueue = api_thread.createEventQueue();
+
+    sc_api::ApiUserInformation apiUserInformation;
+    apiUserInformation.display_name = "effect_stream";
+    apiUserInformation.author       = "Simucube";
+
+    sc_api::NoAuthControlEnabler control_enabler(&api_thread, sc_api::Session::control_ffb_effects, "effect_stream",
+                                                 apiUserInformation);
+
+    std::shared_ptr<sc_api::Session> session;
+    sc_api::DeviceSessionId          brake_ap;
+    auto                             timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    std::cout << "Wait 10s for AP brake to connect" << std::endl;
+    while (auto opt_event = eventQueue->tryPopUntil(timeout)) {
+        const sc_api::Event event = *opt_event;
+        if (auto* s = sc_api::event::getIfSessionStateChanged(&event)) {
+            if (s->session && (s->control_flags & sc_api::Session::control_ffb_effects) != 0u) {
+                session = s->session;
+            }
+        }
+
+        if (session) {
+            for (const sc_api::device_info::DeviceInfo& device : *session->getDeviceInfo()) {
+                if (device.hasFeedbackType(sc_api::device_info::FeedbackType::active_pedal) &&
+                    device.getRole() == sc_api::device_info::DeviceRole::brake_pedal) {
+                    brake_ap = device.getSessionId();
+                }
+            }
+
+            if (brake_ap) break;
+        }
+    }
+
+    if (!session || !brake_ap) {
+        std::cout << "Could not find ActivePedal brake within 10s" << std::endl;
+        return 1;
+    }
+
+    // Vibration amplitude stays within 5 N, so 16-bit samples with 5 N full scale are accurate enough
+    sc_api::PipelineConfig config;
+    config.offset_type   = sc_api::OffsetType::force_N;
+    config.sample_format = sc_api::SampleFormat::i16;
+    config.gain          = 5.0f;
+
+    sc_api::FfbPipeline pipeline(session, brake_ap);
+    if (!pipeline.configure(config)) {
+        std::cout << "Failed to configure pipeline" << std::endl;
+        return 2;
+    }
+
+    sc_api::FfbStreamConfig stream_config;
+    stream_config.sample_time = std::chrono::milliseconds(1);
+    stream_config.lookahead   = std::chrono::milliseconds(30);
+
+    // Stream is serviced by the API thread, so this thread only has to keep the queue filled
+    sc_api::FfbStream stream(pipeline, stream_config);
+    stream.startTimer(std::chrono::milliseconds(2));
+
+    // 40 Hz engine vibration with some roughness
+    sc_api::synthesis::Oscillator engine(sc_api::synthesis::Waveform::sine, stream_config.sample_time);
+    engine.setFrequency(40.0f);
+    engine.setAmplitude(2.0f);
+
+    sc_api::synthesis::NoiseGenerator roughness(1, stream_config.sample_time);
+    roughness.setAmplitude(1.0f);
+    roughness.setCutoffFrequency(100.0f);
+
+    static constexpr unsigned k_block_size = 10;
+    const auto                end_time     = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < end_time) {
+        while (auto event = eventQueue->tryPop()) {
+            if (auto* s = sc_api::event::getIfSessionStateChanged(&event)) {
+                if (s->state != sc_api::SessionState::connected_control) {
+                    std::cerr << "Session was disconnected. Closing example." << std::endl;
+                    return 0;
+                }
+            }
+        }
+
+        // Keep about 50 ms of signal queued
+        while (stream.getQueuedSampleCount() < 50) {
+            float samples[k_block_size];
+            engine.render(samples, k_block_size);
+            roughness.mix(samples, k_block_size);
+            stream.push(samples, k_block_size);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    stream.stopTimer();
+    std::cout << "Sent " << stream.getSentChunkCount() << " effect actions, " << stream.getUnderrunCount()
+              << " underruns" << std::endl;
+    return 0;
+}
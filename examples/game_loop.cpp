@@ -4,6 +4,7 @@
 #include <sc-api/ffb.h>
 #include <sc-api/sim_data.h>
 #include <sc-api/telemetry.h>
+#include <sc-api/time.h>
 #include <sc-api/variables.h>
 
 #include <cassert>
@@ -42,6 +43,10 @@ struct ApState {
             PipelineConfig config;
             config.offset_type = OffsetType::force_relative;
             relative_force_pipeline->configure(config);
+
+            // Effects are sent with generateEffectNow, which measures the send path and picks the smallest start time
+            // lead that still lets the samples reach the pedal in time
+            relative_force_pipeline->enableLeadTimeControl();
         }
     }
 
@@ -160,11 +165,6 @@ int main(int argc, char* argv[]) {
 
     auto start_time              = sc_api::Clock::now();
 
-    // Give 4ms time for the samples to reach the pedal and to give some time for pedal to interpolate between
-    // separate samples. If samples arrive too late compared to their start time, glitches may occur in signal,
-    // when some samples are dropped
-    auto sample_time_offset      = std::chrono::milliseconds(4);
-
     auto update_rate             = std::chrono::milliseconds(1);
 
     unsigned debug_print_counter = 0;
@@ -172,10 +172,17 @@ int main(int argc, char* argv[]) {
     // Use a class instance to store Api related data
     ApiState api_state{api.createEventQueue()};
 
+    // Sleeps until shortly before each update and busy waits the rest, so updates start on time without keeping a
+    // CPU core busy the whole time
+    sc_api::TickSchedulerConfig tick_config;
+    tick_config.period = update_rate;
+    sc_api::TickScheduler ticks(tick_config);
+
     while (true) {
+        auto cur_time = ticks.waitNextTick();
+
         api_state.update();
 
-        auto    cur_time     = sc_api::Clock::now();
         float   freq         = 20.0f;
         double  seconds_from_start =
             std::chrono::duration_cast<std::chrono::duration<double>>(cur_time - start_time).count();
@@ -196,29 +203,22 @@ int main(int argc, char* argv[]) {
                 // Add +-10% sine wave just for fun
                 relative_force_offset += v * 0.1f;
 
-                // Use two samples because using only one sample would produce sawtooth pattern if the next sample
-                // arrives after this sample start time Linear interpolation will try to interpolate samples so that the
-                // first sample value will be reached at exactly the given start timestamp (so the interpolation starts
-                // before the start timestamp) and after last samples timestamp offset will be interpolated towards 0
-                // offset if there are no more samples available
-                static constexpr uint32_t k_sample_count          = 2;
-                float                     samples[k_sample_count] = {relative_force_offset, relative_force_offset};
-
-                if (!brake.relative_force_pipeline->generateEffect(cur_time + sample_time_offset, update_rate * 2,
-                                                                   samples, k_sample_count)) {
+                // Start time is chosen by the lead time controller, which also repeats the sample until the next update
+                // is expected to arrive. Otherwise linear interpolation would fade the offset towards 0 after the last
+                // sample and produce a sawtooth pattern if the next sample arrives late.
+                if (!brake.relative_force_pipeline->generateEffectNow(update_rate, &relative_force_offset, 1)) {
                     std::cerr << "Sending effect failed\n";
                 }
 
                 if (debug_print_counter % 1000 == 0) {
-                    std::cout << "Brake force: " << *brake.vars.force_N << "N" << std::endl;
+                    const sc_api::LeadTimeStats stats =
+                        brake.relative_force_pipeline->getLeadTimeController()->getStats();
+                    std::cout << "Brake force: " << *brake.vars.force_N << "N, lead time: "
+                              << std::chrono::duration_cast<std::chrono::microseconds>(stats.lead_time).count()
+                              << "us, misses: " << stats.misses << ", max tick lateness: "
+                              << ticks.getStats().lateness.max_ns / 1000 << "us" << std::endl;
                 }
             }
         }
-
-        // Do some busy looping while we wait for the next update time
-        // this will cause some scheduling jitter
-        while (sc_api::Clock::now() < cur_time + update_rate) {
-            std::this_thread::yield();
-        }
     }
 }
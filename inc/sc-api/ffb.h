@@ -7,14 +7,33 @@
 #ifndef SC_API_INTERNAL_FFB_H_
 #define SC_API_INTERNAL_FFB_H_
 #include <sc-api/core/ffb.h>
+#include <sc-api/core/ffb_mixer.h>
+#include <sc-api/core/ffb_recorder.h>
+#include <sc-api/core/ffb_stream.h>
+#include <sc-api/core/ffb_synthesis.h>
 
 #include "./time.h"
 
 namespace sc_api {
 
-using FfbPipeline    = core::FfbPipeline;
-using PipelineConfig = core::PipelineConfig;
+using ActionBatch        = core::ActionBatch;
+using EffectRecorder     = core::EffectRecorder;
+using EffectReplayer     = core::EffectReplayer;
+using EffectSource       = core::EffectSource;
+using FfbMixer           = core::FfbMixer;
+using FfbPipeline        = core::FfbPipeline;
+using FfbPipelineGroup   = core::FfbPipelineGroup;
+using FfbStream          = core::FfbStream;
+using FfbStreamConfig    = core::FfbStreamConfig;
+using LeadTimeConfig     = core::LeadTimeConfig;
+using LeadTimeController = core::LeadTimeController;
+using LeadTimeStats      = core::LeadTimeStats;
+using PipelineConfig     = core::PipelineConfig;
+using core::ActionResult;
 using core::OffsetType;
+using core::SampleFormat;
+
+namespace synthesis = ::sc_api::core::synthesis;
 
 }  // namespace sc_api
 
@@ -8,13 +8,19 @@
 #define SC_API_INTERNAL_TELEMETRY_H_
 #include <sc-api/core/telemetry.h>
 #include <sc-api/core/telemetry_references.h>
+#include <sc-api/core/telemetry_scheduler.h>
+#include <sc-api/core/telemetry_struct.h>
 
 namespace sc_api {
 
 using core::Telemetry;
 using core::TelemetryDefinition;
 using core::TelemetryDefinitions;
+using core::TelemetryField;
 using core::TelemetryReference;
+using core::TelemetryScheduler;
+using core::TelemetrySchedulerConfig;
+using core::TelemetryStructGroup;
 using core::TelemetryUpdateGroup;
 
 namespace telemetry = ::sc_api::core::telemetry;
@@ -6,11 +6,15 @@
 
 #ifndef SC_API_INTERNAL_TIME_H_
 #define SC_API_INTERNAL_TIME_H_
+#include <sc-api/core/tick_scheduler.h>
 #include <sc-api/core/time.h>
 
 namespace sc_api {
 
 using core::Clock;
+using core::TickScheduler;
+using core::TickSchedulerConfig;
+using core::TickStats;
 
 }  // namespace sc_api
 
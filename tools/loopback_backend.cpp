@@ -0,0 +1,1073 @@
+#include "loopback_backend.h"
+
+#include <algorithm>
+#include <asio.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/ip/udp.hpp>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "compatibility.h"
+#include "sc-api/core/protocol/bson_shm_blocks.h"
+#include "sc-api/core/protocol/commands.h"
+#include "sc-api/core/protocol/core.h"
+#include "sc-api/core/protocol/telemetry.h"
+#include "sc-api/core/protocol/variables.h"
+#include "sc-api/core/telemetry_references.h"
+#include "sc-api/core/util/bson_builder.h"
+#include "sc-api/core/util/bson_reader.h"
+#include "sc-api/core/variable_references.h"
+
+namespace sc_api::tools {
+
+using core::internal::SharedMemory;
+using core::util::BsonBuilder;
+using core::util::BsonReader;
+
+namespace {
+
+/** Data of every block starts at this offset. Leaves room for the block specific header and keeps data aligned */
+constexpr uint32_t k_block_data_offset     = 32;
+
+constexpr uint32_t k_device_info_shm_size  = 0x4000;
+constexpr uint32_t k_variable_shm_size     = 0x4000;
+constexpr uint32_t k_telemetry_shm_size    = 0x4000;
+constexpr uint32_t k_sim_data_shm_size     = 0x10000;
+
+constexpr uint32_t k_rx_buffer_size        = 0x10000;
+
+constexpr int32_t k_max_pipelines_per_device = 16;
+
+/** Each variable value gets its own 8 byte slot so that all types are suitably aligned */
+constexpr uint32_t k_variable_slot_size    = 8;
+
+struct LoopbackDevice {
+    int32_t     session_id;
+    const char* uid;
+    const char* name;
+    const char* role;
+    const char* input_role;
+};
+
+constexpr LoopbackDevice k_devices[] = {
+    {1, "loopback-ap-brake", "ActivePedal brake", "brake_pedal", "brake"},
+    {2, "loopback-ap-throttle", "ActivePedal throttle", "throttle_pedal", "throttle"},
+};
+
+constexpr std::size_t k_device_count = sizeof(k_devices) / sizeof(k_devices[0]);
+
+/** Layout of the plaintext SC_API_PROTOCOL_ACTION_FB_EFFECT payload. Same as the one built by FfbPipeline */
+struct FbEffectPayload {
+    SC_API_PROTOCOL_ActionFbEffect_AAD_t aad;
+    uint16_t                             device;
+    SC_API_PROTOCOL_ActionFbEffect_Enc_t data;
+};
+
+uint32_t sampleSize(uint8_t sample_format) {
+    switch (sample_format) {
+        case SC_API_PROTOCOL_FB_SAMPLE_FORMAT_F32:
+            return 4;
+        case SC_API_PROTOCOL_FB_SAMPLE_FORMAT_I16:
+        case SC_API_PROTOCOL_FB_SAMPLE_FORMAT_U16:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+/** Make modifications visible to readers that follow the data_revision_counter protocol */
+template <typename Func>
+void modifyShmBlock(SC_API_PROTOCOL_ShmBlockHeader_t* hdr, Func&& f) {
+    uint32_t rev               = hdr->data_revision_counter | 1u;
+    hdr->data_revision_counter = rev;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    f();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    hdr->data_revision_counter = rev + 1;
+}
+
+void copyShmPath(char (&dst)[64], const std::string& path) {
+    std::memset(dst, 0, sizeof(dst));
+    std::memcpy(dst, path.data(), std::min(path.size(), sizeof(dst) - 1));
+}
+
+void addStats(LoopbackActionStats& total, const LoopbackActionStats& d) {
+    total.datagrams += d.datagrams;
+    total.bytes += d.bytes;
+    total.actions += d.actions;
+    total.malformed_datagrams += d.malformed_datagrams;
+    total.unknown_controller += d.unknown_controller;
+    total.encrypted_actions += d.encrypted_actions;
+    total.ffb_effect_actions += d.ffb_effect_actions;
+    total.ffb_effect_samples += d.ffb_effect_samples;
+    total.ffb_clear_actions += d.ffb_clear_actions;
+    total.telemetry_actions += d.telemetry_actions;
+    total.other_actions += d.other_actions;
+    total.commands += d.commands;
+}
+
+}  // namespace
+
+class LoopbackBackend::Impl {
+public:
+    struct Connection;
+
+    struct Pipeline {
+        int32_t     device_session_id;
+        int32_t     pipeline_id;
+        uint16_t    controller_id;
+        std::string offset_mode;
+
+        /** Full scale value of 16-bit samples */
+        double gain = 1.0;
+    };
+
+    /** Result of a single command. Payload is added to the "data" sub document of the response */
+    struct CommandResponse {
+        int32_t                          result = SC_API_PROTOCOL_OK;
+        std::string                      error_message;
+        std::function<void(BsonBuilder&)> payload;
+
+        static CommandResponse error(int32_t code, std::string message) {
+            CommandResponse r;
+            r.result        = code;
+            r.error_message = std::move(message);
+            return r;
+        }
+    };
+
+    explicit Impl(LoopbackBackendConfig c) : config(std::move(c)) {}
+
+    bool start();
+    void stop();
+
+    bool openSockets();
+    bool publishSession();
+    void unpublishSession();
+
+    bool createBlock(SharedMemory& shm, const std::string& path, uint32_t size);
+    bool writeBsonBlock(SharedMemory& shm, const uint8_t* bson, uint32_t size);
+    void buildDeviceInfo(std::vector<uint8_t>& buffer) const;
+    void initializeVariables();
+    void initializeTelemetryDefinitions();
+
+    void startAccept();
+    void startUdpReceive();
+    void startKeepAliveTimer();
+
+    void handleDatagram(const uint8_t* data, std::size_t size);
+    void handleCommand(Connection& connection, const uint8_t* doc, std::size_t size);
+    void connectionClosed(Connection& connection);
+
+    CommandResponse handleRegister(Connection& connection, BsonReader& cmd);
+    CommandResponse handleConfigurePipeline(Connection& connection, BsonReader& cmd);
+    CommandResponse handleFreePipeline(Connection& connection, BsonReader& cmd);
+    CommandResponse handleSimData(std::string_view command, const uint8_t* content);
+
+    bool isRegisteredController(uint16_t controller_id) const;
+    const Pipeline* findPipeline(int32_t device_session_id, int32_t pipeline_id) const;
+
+    LoopbackBackendConfig config;
+    ActionObserver        observer;
+
+    uint32_t session_id = 0;
+
+    SharedMemory                   core_shm;
+    SharedMemory                   session_shm;
+    SharedMemory                   device_info_shm;
+    SharedMemory                   variable_header_shm;
+    SharedMemory                   variable_data_shm;
+    SharedMemory                   telemetry_shm;
+    SharedMemory                   sim_data_shm;
+    std::vector<std::string>       created_shm_paths;
+    SC_API_PROTOCOL_Session_t*     session_ptr = nullptr;
+
+    /** Current sim data document. Kept separately so that updates can be merged to it */
+    std::vector<uint8_t> sim_data;
+
+    /** Pointers to the effect offset variables of each device so that received effects can be mirrored to them */
+    struct DeviceVariables {
+        float* force_effect_offset = nullptr;
+        float* pos_effect_offset   = nullptr;
+    };
+    DeviceVariables device_variables[k_device_count];
+
+    asio::io_context        io_ctx;
+    asio::ip::tcp::acceptor acceptor{io_ctx};
+    asio::ip::udp::socket   udp_socket{io_ctx};
+    asio::ip::udp::endpoint udp_sender;
+    asio::steady_timer      keep_alive_timer{io_ctx};
+    std::vector<uint8_t>    udp_rx_buffer;
+    std::thread             thread;
+    std::atomic_bool        running{false};
+
+    // Following are only accessed from the backend thread
+    std::vector<std::shared_ptr<Connection>> connections;
+    std::vector<uint16_t>                    registered_controllers;
+    std::vector<Pipeline>                    pipelines;
+    uint16_t                                 next_controller_id = 1;
+
+    mutable std::mutex  stats_mutex;
+    LoopbackActionStats stats;
+};
+
+struct LoopbackBackend::Impl::Connection : std::enable_shared_from_this<Connection> {
+    Connection(Impl* b, asio::ip::tcp::socket s) : backend(b), socket(std::move(s)), rx_buffer(k_rx_buffer_size) {}
+
+    void startReceive() {
+        socket.async_read_some(asio::buffer(&rx_buffer[rx_used], rx_buffer.size() - rx_used),
+                               [self = shared_from_this()](asio::error_code ec, std::size_t rx_size) {
+                                   if (ec) {
+                                       self->close();
+                                       return;
+                                   }
+                                   self->rx_used += (uint32_t)rx_size;
+                                   if (!self->parseReceived()) {
+                                       self->close();
+                                       return;
+                                   }
+                                   self->startReceive();
+                               });
+    }
+
+    /** @return false, if received data is corrupted and the connection must be closed */
+    bool parseReceived() {
+        uint32_t offset = 0;
+        while (rx_used - offset >= 5) {
+            int32_t doc_size = BsonReader::getTotalDocumentSize(&rx_buffer[offset]);
+            if (doc_size < 5 || doc_size > (int32_t)rx_buffer.size()) {
+                return false;
+            }
+            if ((uint32_t)doc_size > rx_used - offset) break;
+
+            backend->handleCommand(*this, &rx_buffer[offset], (std::size_t)doc_size);
+            offset += (uint32_t)doc_size;
+        }
+
+        if (offset > 0) {
+            std::memmove(rx_buffer.data(), rx_buffer.data() + offset, rx_used - offset);
+            rx_used -= offset;
+        }
+        return true;
+    }
+
+    void send(std::vector<uint8_t> data) {
+        tx_queue.push_back(std::move(data));
+        if (tx_queue.size() == 1) {
+            startNextSend();
+        }
+    }
+
+    void startNextSend() {
+        asio::async_write(socket, asio::buffer(tx_queue.front()),
+                          [self = shared_from_this()](asio::error_code ec, std::size_t) {
+                              if (ec) {
+                                  self->close();
+                                  return;
+                              }
+                              self->tx_queue.pop_front();
+                              if (!self->tx_queue.empty()) {
+                                  self->startNextSend();
+                              }
+                          });
+    }
+
+    void close() {
+        if (!socket.is_open()) return;
+
+        asio::error_code ec;
+        socket.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+        socket.close(ec);
+        backend->connectionClosed(*this);
+    }
+
+    Impl*                            backend;
+    asio::ip::tcp::socket            socket;
+    std::vector<uint8_t>             rx_buffer;
+    uint32_t                         rx_used       = 0;
+    std::deque<std::vector<uint8_t>> tx_queue;
+    uint16_t                         controller_id = 0;
+};
+
+bool LoopbackBackend::Impl::start() {
+    if (running) return false;
+
+    session_id = (uint32_t)std::chrono::steady_clock::now().time_since_epoch().count() ^
+                 (core::internal::getCurrentProcessId() << 16);
+    if (session_id == 0) session_id = 1;
+
+    if (!openSockets() || !publishSession()) {
+        unpublishSession();
+        asio::error_code ec;
+        acceptor.close(ec);
+        udp_socket.close(ec);
+        return false;
+    }
+
+    if (io_ctx.stopped()) {
+        io_ctx.restart();
+    }
+
+    startAccept();
+    startUdpReceive();
+    startKeepAliveTimer();
+
+    running = true;
+    thread  = std::thread([this]() { io_ctx.run(); });
+    return true;
+}
+
+void LoopbackBackend::Impl::stop() {
+    if (!running) return;
+
+    if (session_ptr) {
+        session_ptr->state = SC_API_PROTOCOL_SESSION_SHUTDOWN;
+    }
+
+    asio::post(io_ctx, [this]() {
+        asio::error_code ec;
+        keep_alive_timer.cancel();
+        acceptor.close(ec);
+        udp_socket.close(ec);
+
+        // close() removes the connection from the list
+        auto open_connections = connections;
+        for (auto& c : open_connections) {
+            c->close();
+        }
+        io_ctx.stop();
+    });
+
+    thread.join();
+    running = false;
+
+    unpublishSession();
+    registered_controllers.clear();
+    pipelines.clear();
+}
+
+bool LoopbackBackend::Impl::openSockets() {
+    asio::error_code ec;
+    auto             loopback = asio::ip::make_address_v4("127.0.0.1");
+
+    acceptor.open(asio::ip::tcp::v4(), ec);
+    if (ec) return false;
+    acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true), ec);
+    acceptor.bind(asio::ip::tcp::endpoint(loopback, config.tcp_port), ec);
+    if (ec) return false;
+    acceptor.listen(asio::socket_base::max_listen_connections, ec);
+    if (ec) return false;
+
+    udp_socket.open(asio::ip::udp::v4(), ec);
+    if (ec) return false;
+    udp_socket.bind(asio::ip::udp::endpoint(loopback, config.udp_port), ec);
+    if (ec) return false;
+
+    // Only a request, operating system may limit the size. Failure isn't fatal
+    udp_socket.set_option(asio::socket_base::receive_buffer_size(config.udp_receive_buffer_size), ec);
+
+    udp_rx_buffer.resize(k_rx_buffer_size);
+    return true;
+}
+
+bool LoopbackBackend::Impl::createBlock(SharedMemory& shm, const std::string& path, uint32_t size) {
+    // Leftover object from a crashed run may have different size, start from scratch
+    SharedMemory::remove(path.c_str());
+    if (!shm.createForReadWrite(path.c_str(), size)) {
+        return false;
+    }
+    created_shm_paths.push_back(path);
+    std::memset(shm.getBuffer(), 0, size);
+    return true;
+}
+
+bool LoopbackBackend::Impl::writeBsonBlock(SharedMemory& shm, const uint8_t* bson, uint32_t size) {
+    auto* block = reinterpret_cast<SC_API_PROTOCOL_BsonDataShm_t*>(shm.getBuffer());
+    if ((uint64_t)k_block_data_offset + size > shm.getSize()) {
+        return false;
+    }
+
+    modifyShmBlock(&block->header, [&]() {
+        block->data_offset = k_block_data_offset;
+        block->data_size   = size;
+        std::memcpy(reinterpret_cast<uint8_t*>(block) + k_block_data_offset, bson, size);
+    });
+    return true;
+}
+
+bool LoopbackBackend::Impl::publishSession() {
+    char id_str[16];
+    std::snprintf(id_str, sizeof(id_str), "%08x", session_id);
+    const std::string prefix = config.shm_prefix + "-" + id_str;
+
+    struct BlockInfo {
+        SharedMemory* shm;
+        const char*   suffix;
+        uint32_t      id;
+        uint32_t      version;
+        uint32_t      size;
+    };
+
+    const BlockInfo blocks[] = {
+        {&device_info_shm, "-device-info", SC_API_PROTOCOL_DEVICE_INFO_SHM_ID, SC_API_PROTOCOL_DEVICE_INFO_SHM_VERSION,
+         k_device_info_shm_size},
+        {&variable_header_shm, "-var-header", SC_API_PROTOCOL_VARIABLE_HEADER_SHM_ID,
+         SC_API_PROTOCOL_VARIABLE_HEADER_SHM_VERSION, k_variable_shm_size},
+        {&variable_data_shm, "-var-data", SC_API_PROTOCOL_VARIABLE_DATA_SHM_ID, SC_API_PROTOCOL_VARIABLE_DATA_SHM_VERSION,
+         k_variable_shm_size},
+        {&telemetry_shm, "-telemetry-defs", SC_API_PROTOCOL_TELEMETRY_DEFINITION_SHM_ID,
+         SC_API_PROTOCOL_TELEMETRY_DEFINITION_SHM_VERSION, k_telemetry_shm_size},
+        {&sim_data_shm, "-sim-data", SC_API_PROTOCOL_SIM_DATA_SHM_ID, SC_API_PROTOCOL_SIM_DATA_SHM_VERSION,
+         k_sim_data_shm_size},
+    };
+    constexpr uint32_t k_block_count = sizeof(blocks) / sizeof(blocks[0]);
+
+    const uint32_t refs_offset  = (uint32_t)((sizeof(SC_API_PROTOCOL_Session_t) + 7) & ~(std::size_t)7);
+    const uint32_t session_size = refs_offset + k_block_count * (uint32_t)sizeof(SC_API_PROTOCOL_ShmBlockReference_t);
+    const std::string session_path = prefix + "-session";
+
+    if (!createBlock(session_shm, session_path, session_size)) return false;
+
+    session_ptr = reinterpret_cast<SC_API_PROTOCOL_Session_t*>(session_shm.getBuffer());
+    auto* refs  = reinterpret_cast<SC_API_PROTOCOL_ShmBlockReference_t*>(
+        reinterpret_cast<uint8_t*>(session_ptr) + refs_offset);
+
+    for (uint32_t i = 0; i < k_block_count; ++i) {
+        const BlockInfo& b    = blocks[i];
+        const std::string path = prefix + b.suffix;
+        if (!createBlock(*b.shm, path, b.size)) return false;
+
+        auto* hdr     = reinterpret_cast<SC_API_PROTOCOL_ShmBlockHeader_t*>(b.shm->getBuffer());
+        hdr->version  = b.version;
+        hdr->shm_size = b.size;
+
+        refs[i].id      = b.id;
+        refs[i].version = b.version;
+        refs[i].size    = b.size;
+        copyShmPath(refs[i].shm_path, path);
+    }
+
+    std::vector<uint8_t> device_info(1024);
+    buildDeviceInfo(device_info);
+    if (!writeBsonBlock(device_info_shm, device_info.data(), (uint32_t)device_info.size())) return false;
+
+    // Empty document
+    sim_data = {5, 0, 0, 0, 0};
+    writeBsonBlock(sim_data_shm, sim_data.data(), (uint32_t)sim_data.size());
+
+    initializeVariables();
+    initializeTelemetryDefinitions();
+
+    SC_API_PROTOCOL_Session_t& s = *session_ptr;
+    s.session_version             = SC_API_PROTOCOL_SESSION_SHM_VERSION;
+    s.session_id                  = session_id;
+    s.keep_alive_counter          = 0;
+    s.session_data_size           = session_size;
+    s.manager_process_pid         = core::internal::getCurrentProcessId();
+
+    const auto tcp_ip             = acceptor.local_endpoint().address().to_v4().to_bytes();
+    s.tcp_core_protocol_version   = SC_API_PROTOCOL_TCP_CORE_VERSION;
+    std::memcpy(s.tcp_core_address, tcp_ip.data(), sizeof(s.tcp_core_address));
+    s.tcp_core_port               = acceptor.local_endpoint().port();
+    s.tcp_core_max_packet_size    = k_rx_buffer_size;
+
+    const auto udp_ip             = udp_socket.local_endpoint().address().to_v4().to_bytes();
+    s.udp_control_protocol_version = (uint32_t)SC_API_PROTOCOL_UDP_PROTOCOL_VERSION_MAJOR << 16;
+    std::memcpy(s.udp_control_address, udp_ip.data(), sizeof(s.udp_control_address));
+    s.udp_control_port                      = udp_socket.local_endpoint().port();
+    s.udp_control_max_plaintext_packet_size = config.udp_max_plaintext_size;
+    s.udp_control_max_encrypted_packet_size = config.udp_max_encrypted_size;
+
+    s.shm_reference_count  = (uint16_t)k_block_count;
+    s.shm_reference_size   = (uint16_t)sizeof(SC_API_PROTOCOL_ShmBlockReference_t);
+    s.shm_reference_offset = (int32_t)refs_offset;
+
+    // Session block must be complete before it becomes visible
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    s.state = SC_API_PROTOCOL_SESSION_ACTIVE;
+
+    // Core block is left in place on stop with offline state so that clients that still have it mapped see the change
+    if (!core_shm.createForReadWrite(SC_API_PROTOCOL_CORE_SHM_FILENAME, SC_API_PROTOCOL_CORE_SHM_SIZE)) {
+        return false;
+    }
+
+    auto*    core = reinterpret_cast<SC_API_PROTOCOL_Core_t*>(core_shm.getBuffer());
+    uint32_t rev  = core->revision_counter | 1u;
+    core->revision_counter = rev;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    core->version          = SC_API_PROTOCOL_CORE_SHM_VERSION;
+    core->session_id       = session_id;
+    core->session_version  = SC_API_PROTOCOL_SESSION_SHM_VERSION;
+    core->session_shm_size = session_size;
+    core->state            = SC_API_PROTOCOL_CORE_ACTIVE;
+    for (std::size_t i = 0; i < sizeof(core->session_shm_path); ++i) {
+        core->session_shm_path[i] = i < session_path.size() ? session_path[i] : '\0';
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    core->revision_counter = rev + 1;
+    return true;
+}
+
+void LoopbackBackend::Impl::unpublishSession() {
+    if (core_shm.isOpen()) {
+        auto* core = reinterpret_cast<SC_API_PROTOCOL_Core_t*>(core_shm.getBuffer());
+        if (core->session_id == session_id) {
+            uint32_t rev           = core->revision_counter | 1u;
+            core->revision_counter = rev;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            core->state = SC_API_PROTOCOL_CORE_OFFLINE;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            core->revision_counter = rev + 1;
+        }
+        core_shm.close();
+    }
+
+    for (SharedMemory* shm : {&session_shm, &device_info_shm, &variable_header_shm, &variable_data_shm, &telemetry_shm,
+                              &sim_data_shm}) {
+        shm->close();
+    }
+    session_ptr = nullptr;
+
+    for (const std::string& path : created_shm_paths) {
+        SharedMemory::remove(path.c_str());
+    }
+    created_shm_paths.clear();
+}
+
+void LoopbackBackend::Impl::buildDeviceInfo(std::vector<uint8_t>& buffer) const {
+    BsonBuilder b(&buffer);
+    for (const LoopbackDevice& dev : k_devices) {
+        b.docBeginSubDoc(dev.uid);
+        b.docAddElement("logical_id", dev.session_id);
+        b.docAddElement("device_uid", dev.uid);
+        b.docAddElement("role", dev.role);
+        b.docAddElement("is_connected", true);
+
+        b.docBeginSubDoc("control");
+        b.docBeginSubDoc("pedal");
+        b.docAddElement("name", dev.name);
+        b.docAddElement("role", "pedal");
+        b.endDocument();
+        b.endDocument();
+
+        b.docBeginSubDoc("input");
+        b.docBeginSubDoc("pedal");
+        b.docAddElement("role", dev.input_role);
+        b.docAddElement("type", "axis");
+        b.docAddElement("control", "pedal");
+        b.docAddElement("variable", core::variable::activepedal::primary_input.name);
+        b.endDocument();
+        b.endDocument();
+
+        b.docBeginSubDoc("feedback");
+        b.docBeginSubDoc("pedal");
+        b.docAddElement("type", "active_pedal");
+        b.docAddElement("control", "pedal");
+        b.endDocument();
+        b.endDocument();
+
+        b.endDocument();
+    }
+
+    auto [ptr, size] = b.finish();
+    buffer.resize(size);
+}
+
+void LoopbackBackend::Impl::initializeVariables() {
+    auto* header = reinterpret_cast<SC_API_PROTOCOL_VariableDefinitionsShm_t*>(variable_header_shm.getBuffer());
+    auto* data   = reinterpret_cast<SC_API_PROTOCOL_VariableDataShm_t*>(variable_data_shm.getBuffer());
+
+    auto* defs   = reinterpret_cast<SC_API_PROTOCOL_VariableDefinition_t*>(
+        reinterpret_cast<uint8_t*>(header) + k_block_data_offset);
+    uint8_t* values     = reinterpret_cast<uint8_t*>(data) + k_block_data_offset;
+    uint32_t count      = 0;
+    uint32_t data_size  = 0;
+
+    auto add = [&](const core::VariableReferenceBase& ref, core::Type type, uint16_t device) -> uint8_t* {
+        SC_API_PROTOCOL_VariableDefinition_t& def = defs[count++];
+        def.flags                                 = SC_API_VAR_FLAG_STABLE;
+        def.type                                  = type.type;
+        def.type_variant_data                     = type.variant_data;
+        def.value_offset                          = data_size;
+        def.device_session_id                     = device;
+        std::memcpy(def.name, ref.name.data(), std::min(ref.name.size(), sizeof(def.name) - 1));
+
+        uint8_t* value = values + data_size;
+        data_size += k_variable_slot_size;
+        return value;
+    };
+
+    namespace ap = core::variable::activepedal;
+    for (std::size_t i = 0; i < k_device_count; ++i) {
+        const uint16_t device = (uint16_t)k_devices[i].session_id;
+        for (const auto* ref : {&ap::primary_input, &ap::pedal_face_pos_mm, &ap::abs_pedal_face_pos_mm, &ap::force,
+                                &ap::force_no_effect_filter}) {
+            add(*ref, ref->type_value, device);
+        }
+
+        float travel = 100.f;
+        std::memcpy(add(ap::pedal_face_travel_mm, ap::pedal_face_travel_mm.type_value, device), &travel,
+                    sizeof(travel));
+        add(ap::using_position_input, ap::using_position_input.type_value, device);
+
+        device_variables[i].force_effect_offset = reinterpret_cast<float*>(
+            add(ap::force_effect_offset, ap::force_effect_offset.type_value, device));
+        device_variables[i].pos_effect_offset = reinterpret_cast<float*>(
+            add(ap::pos_effect_offset_mm, ap::pos_effect_offset_mm.type_value, device));
+    }
+
+    modifyShmBlock(&data->header, [&]() {
+        data->var_data_offset = k_block_data_offset;
+        data->var_data_size   = data_size;
+    });
+
+    modifyShmBlock(&header->header, [&]() {
+        header->var_definition_offset    = k_block_data_offset;
+        header->var_definition_data_size = sizeof(SC_API_PROTOCOL_VariableDefinition_t);
+        header->var_definition_count     = count;
+    });
+}
+
+void LoopbackBackend::Impl::initializeTelemetryDefinitions() {
+    auto* header = reinterpret_cast<SC_API_PROTOCOL_TelemetryDefinitionShm_t*>(telemetry_shm.getBuffer());
+    auto* defs   = reinterpret_cast<SC_API_PROTOCOL_TelemetryDef_t*>(
+        reinterpret_cast<uint8_t*>(header) + k_block_data_offset);
+    uint16_t count = 0;
+
+    auto add = [&](const auto& ref, uint16_t flags) {
+        using T                             = typename std::decay_t<decltype(ref)>::type;
+        SC_API_PROTOCOL_TelemetryDef_t& def = defs[count];
+        def.id                              = ++count;
+        def.flags                           = flags;
+        def.type                            = core::get_base_type<T>::value;
+        def.type_variant_data               = 0;
+        def.alias_variable_idx              = 0xffffffffu;
+        std::memcpy(def.name, ref.name.data(), std::min(ref.name.size(), sizeof(def.name) - 1));
+    };
+
+    namespace t                 = core::telemetry;
+    constexpr uint16_t k_effects = SC_API_PROTOCOL_TELEMETRY_USED_FOR_EFFECTS;
+    constexpr uint16_t k_display = SC_API_PROTOCOL_TELEMETRY_USED_FOR_DISPLAY;
+
+    add(t::physics_running, k_effects | k_display);
+    add(t::engine_running, k_effects | k_display);
+    add(t::abs_active, k_effects | k_display);
+    add(t::tc_active, k_effects | k_display);
+    add(t::engine_rpm, k_effects | k_display);
+    add(t::speed, k_effects | k_display);
+    add(t::brake_input, k_effects);
+    add(t::local_acceleration_x, k_effects);
+    add(t::local_acceleration_y, k_effects);
+    add(t::local_acceleration_z, k_effects);
+    add(t::wheel_ang_vel_fl, k_effects);
+    add(t::wheel_ang_vel_fr, k_effects);
+    add(t::wheel_ang_vel_rl, k_effects);
+    add(t::wheel_ang_vel_rr, k_effects);
+    add(t::engine_max_rpm, k_display);
+    add(t::transmission_gear, k_display);
+    add(t::shift_light_level, k_display);
+    add(t::flag_yellow, k_display);
+
+    modifyShmBlock(&header->header, [&]() {
+        header->definition_offset    = k_block_data_offset;
+        header->definition_data_size = sizeof(SC_API_PROTOCOL_TelemetryDef_t);
+        header->definition_count     = count;
+    });
+}
+
+void LoopbackBackend::Impl::startAccept() {
+    acceptor.async_accept([this](asio::error_code ec, asio::ip::tcp::socket socket) {
+        if (ec) {
+            // Acceptor has been closed
+            return;
+        }
+
+        socket.set_option(asio::ip::tcp::no_delay(true), ec);
+        auto connection = std::make_shared<Connection>(this, std::move(socket));
+        connections.push_back(connection);
+        connection->startReceive();
+        startAccept();
+    });
+}
+
+void LoopbackBackend::Impl::startUdpReceive() {
+    udp_socket.async_receive_from(asio::buffer(udp_rx_buffer), udp_sender,
+                                  [this](asio::error_code ec, std::size_t rx_size) {
+                                      if (ec == asio::error::operation_aborted || !udp_socket.is_open()) {
+                                          return;
+                                      }
+                                      if (!ec) {
+                                          handleDatagram(udp_rx_buffer.data(), rx_size);
+                                      }
+                                      startUdpReceive();
+                                  });
+}
+
+void LoopbackBackend::Impl::startKeepAliveTimer() {
+    keep_alive_timer.expires_after(config.keep_alive_period);
+    keep_alive_timer.async_wait([this](asio::error_code ec) {
+        if (ec) return;
+        session_ptr->keep_alive_counter = session_ptr->keep_alive_counter + 1;
+        startKeepAliveTimer();
+    });
+}
+
+void LoopbackBackend::Impl::handleDatagram(const uint8_t* data, std::size_t size) {
+    LoopbackActionStats d;
+    d.datagrams = 1;
+    d.bytes     = size;
+
+    std::size_t offset = 0;
+    while (offset < size) {
+        SC_API_PROTOCOL_ActionHeader_t hdr;
+        if (size - offset < sizeof(hdr)) {
+            ++d.malformed_datagrams;
+            break;
+        }
+
+        std::memcpy(&hdr, data + offset, sizeof(hdr));
+        if (hdr.size < sizeof(hdr) || hdr.size > size - offset) {
+            ++d.malformed_datagrams;
+            break;
+        }
+
+        const uint8_t* action    = data + offset;
+        const bool     encrypted = (hdr.flags & SC_API_PROTOCOL_ACTION_FLAG_ENCRYPTED) != 0;
+
+        ++d.actions;
+        if (!isRegisteredController(hdr.controller_id)) ++d.unknown_controller;
+        if (encrypted) ++d.encrypted_actions;
+
+        switch (hdr.action_id) {
+            case SC_API_PROTOCOL_ACTION_FB_EFFECT: {
+                ++d.ffb_effect_actions;
+
+                FbEffectPayload payload;
+                if (encrypted || hdr.size < sizeof(hdr) + sizeof(payload)) break;
+
+                std::memcpy(&payload, action + sizeof(hdr), sizeof(payload));
+                const uint32_t sample_count = payload.data.sample_count_minus_1 + 1u;
+                const uint32_t sample_bytes = sampleSize(payload.data.sample_format) * sample_count;
+                if (sample_bytes == 0 || sizeof(hdr) + sizeof(payload) + sample_bytes > hdr.size) break;
+
+                d.ffb_effect_samples += sample_count;
+
+                // Mirror the first offset sample to the device variables like a real ActivePedal would do
+                const Pipeline* pipeline = findPipeline(payload.device, payload.aad.fb_pipeline_idx);
+                if (!pipeline) break;
+
+                const uint8_t* sample_ptr   = action + sizeof(hdr) + sizeof(payload);
+                float          first_sample = 0.0f;
+                if (payload.data.sample_format == SC_API_PROTOCOL_FB_SAMPLE_FORMAT_F32) {
+                    std::memcpy(&first_sample, sample_ptr, sizeof(first_sample));
+                } else if (payload.data.sample_format == SC_API_PROTOCOL_FB_SAMPLE_FORMAT_I16) {
+                    int16_t v;
+                    std::memcpy(&v, sample_ptr, sizeof(v));
+                    first_sample = (float)(v * pipeline->gain / 32767.0);
+                } else {
+                    uint16_t v;
+                    std::memcpy(&v, sample_ptr, sizeof(v));
+                    first_sample = (float)(v * pipeline->gain / 65535.0);
+                }
+                for (std::size_t i = 0; i < k_device_count; ++i) {
+                    if (k_devices[i].session_id != payload.device) continue;
+                    if (pipeline->offset_mode == "force") {
+                        *device_variables[i].force_effect_offset = first_sample;
+                    } else if (pipeline->offset_mode == "position") {
+                        *device_variables[i].pos_effect_offset = first_sample;
+                    }
+                }
+                break;
+            }
+            case SC_API_PROTOCOL_ACTION_FB_EFFECT_CLEAR:
+                ++d.ffb_clear_actions;
+                break;
+            case SC_API_PROTOCOL_ACTION_REGISTER_TELEMETRY_GROUP:
+            case SC_API_PROTOCOL_ACTION_SET_TELEMETRY_GROUP:
+            case SC_API_PROTOCOL_ACTION_TEMP_TELEMETRY_DATA:
+                ++d.telemetry_actions;
+                break;
+            default:
+                ++d.other_actions;
+                break;
+        }
+
+        if (observer) {
+            observer(hdr, action);
+        }
+        offset += hdr.size;
+    }
+
+    std::lock_guard lock(stats_mutex);
+    addStats(stats, d);
+}
+
+void LoopbackBackend::Impl::handleCommand(Connection& connection, const uint8_t* doc, std::size_t size) {
+    {
+        std::lock_guard lock(stats_mutex);
+        ++stats.commands;
+    }
+
+    BsonReader r(doc, size);
+
+    int32_t          user_data     = 0;
+    bool             has_user_data = r.tryFindAndGet("user-data", user_data);
+    std::string_view service;
+    r.tryFindAndGet("service", service);
+
+    std::string_view command;
+    const uint8_t*   content = nullptr;
+    if (r.seekKey("cmd") == BsonReader::ELEMENT_DOC && r.beginSub() && r.next() == BsonReader::ELEMENT_DOC) {
+        command = r.key();
+        content = r.subdocument().first;
+    }
+
+    CommandResponse response;
+    if (!content) {
+        response = CommandResponse::error(SC_API_PROTOCOL_ERROR_INVALID_FORMAT, "Missing command");
+    } else {
+        BsonReader cmd(content, (std::size_t)BsonReader::getTotalDocumentSize(content));
+        if (service == "core" && command == "register") {
+            response = handleRegister(connection, cmd);
+        } else if (connection.controller_id == 0) {
+            response = CommandResponse::error(SC_API_PROTOCOL_ERROR_NOT_REGISTERED, "Not registered");
+        } else if (service == "ffb" && command == "configure_pipeline") {
+            response = handleConfigurePipeline(connection, cmd);
+        } else if (service == "ffb" && command == "free_pipeline") {
+            response = handleFreePipeline(connection, cmd);
+        } else if (service == "sim_data" && (command == "replace" || command == "update")) {
+            response = handleSimData(command, content);
+        }
+        // Any other command is accepted as is so that command round trips can be measured with any content
+    }
+
+    std::vector<uint8_t> buffer(256);
+    BsonBuilder          b(&buffer);
+    b.docAddElement("00type", 1);
+    if (has_user_data) {
+        b.docAddElement("user-data", user_data);
+    }
+    b.docAddElement("result", response.result);
+    if (response.result != SC_API_PROTOCOL_OK) {
+        b.docAddElement("error_message", response.error_message);
+    } else {
+        b.docBeginSubDoc("data");
+        b.docBeginSubDoc(command);
+        if (response.payload) {
+            response.payload(b);
+        }
+        b.endDocument();
+        b.endDocument();
+    }
+
+    auto [ptr, response_size] = b.finish();
+    buffer.resize(response_size);
+    connection.send(std::move(buffer));
+}
+
+LoopbackBackend::Impl::CommandResponse LoopbackBackend::Impl::handleRegister(Connection& connection, BsonReader& cmd) {
+    if (connection.controller_id != 0) {
+        return CommandResponse::error(SC_API_PROTOCOL_ERROR_NO_RESOURCE, "Already registered");
+    }
+
+    if (cmd.seekKey("secure_session") == BsonReader::ELEMENT_DOC) {
+        return CommandResponse::error(SC_API_PROTOCOL_ERROR_NOT_SUPPORTED,
+                                      "Loopback backend doesn't support secure sessions");
+    }
+
+    std::vector<std::string> control;
+    if (cmd.seekKey("control") == BsonReader::ELEMENT_ARRAY && cmd.beginSub()) {
+        BsonReader::ElementType e;
+        while (!BsonReader::isEndOrError(e = cmd.next())) {
+            if (e == BsonReader::ELEMENT_STR) {
+                control.emplace_back(cmd.stringValue());
+            }
+        }
+        cmd.endSub();
+    }
+
+    connection.controller_id = next_controller_id++;
+    if (next_controller_id == 0) next_controller_id = 1;
+    registered_controllers.push_back(connection.controller_id);
+
+    CommandResponse response;
+    response.payload = [controller_id = connection.controller_id, control = std::move(control)](BsonBuilder& b) {
+        b.docAddElement("controller_id", (int32_t)controller_id);
+        b.docBeginSubArray("control");
+        for (const std::string& c : control) {
+            b.arrayAddElement(c);
+        }
+        b.endArray();
+    };
+    return response;
+}
+
+LoopbackBackend::Impl::CommandResponse LoopbackBackend::Impl::handleConfigurePipeline(Connection& connection,
+                                                                                      BsonReader& cmd) {
+    int32_t          device_session_id = 0;
+    std::string_view offset_mode;
+    if (!cmd.tryFindAndGet("device_session_id", device_session_id) || !cmd.tryFindAndGet("offset_mode", offset_mode)) {
+        return CommandResponse::error(SC_API_PROTOCOL_ERROR_INVALID_FORMAT, "Missing parameters");
+    }
+
+    bool known_device = false;
+    for (const LoopbackDevice& dev : k_devices) {
+        known_device |= dev.session_id == device_session_id;
+    }
+    if (!known_device) {
+        return CommandResponse::error(SC_API_PROTOCOL_ERROR_INVALID_ARGUMENT, "Unknown device");
+    }
+
+    double gain = 1.0;
+    cmd.tryFindAndGet("gain", gain);
+
+    int32_t pipeline_id = -1;
+    if (cmd.tryFindAndGet("pipeline_id", pipeline_id)) {
+        // Reconfiguring existing pipeline
+        for (Pipeline& p : pipelines) {
+            if (p.device_session_id == device_session_id && p.pipeline_id == pipeline_id &&
+                p.controller_id == connection.controller_id) {
+                p.offset_mode = offset_mode;
+                p.gain        = gain;
+                CommandResponse response;
+                response.payload = [pipeline_id](BsonBuilder& b) { b.docAddElement("pipeline_id", pipeline_id); };
+                return response;
+            }
+        }
+        return CommandResponse::error(SC_API_PROTOCOL_ERROR_INVALID_ARGUMENT, "Unknown pipeline");
+    }
+
+    for (int32_t id = 0; id < k_max_pipelines_per_device; ++id) {
+        if (!findPipeline(device_session_id, id)) {
+            pipelines.push_back(
+                Pipeline{device_session_id, id, connection.controller_id, std::string(offset_mode), gain});
+            CommandResponse response;
+            response.payload = [id](BsonBuilder& b) { b.docAddElement("pipeline_id", id); };
+            return response;
+        }
+    }
+    return CommandResponse::error(SC_API_PROTOCOL_ERROR_NO_RESOURCE, "No free pipelines");
+}
+
+LoopbackBackend::Impl::CommandResponse LoopbackBackend::Impl::handleFreePipeline(Connection& connection,
+                                                                                 BsonReader& cmd) {
+    int32_t device_session_id = 0;
+    int32_t pipeline_id       = -1;
+    if (!cmd.tryFindAndGet("device_session_id", device_session_id) || !cmd.tryFindAndGet("pipeline_id", pipeline_id)) {
+        return CommandResponse::error(SC_API_PROTOCOL_ERROR_INVALID_FORMAT, "Missing parameters");
+    }
+
+    for (auto it = pipelines.begin(); it != pipelines.end(); ++it) {
+        if (it->device_session_id == device_session_id && it->pipeline_id == pipeline_id &&
+            it->controller_id == connection.controller_id) {
+            pipelines.erase(it);
+            return {};
+        }
+    }
+    return CommandResponse::error(SC_API_PROTOCOL_ERROR_INVALID_ARGUMENT, "Unknown pipeline");
+}
+
+LoopbackBackend::Impl::CommandResponse LoopbackBackend::Impl::handleSimData(std::string_view command,
+                                                                            const uint8_t*   content) {
+    const int32_t content_size = BsonReader::getTotalDocumentSize(content);
+
+    std::vector<uint8_t> new_data;
+    if (command == "replace") {
+        new_data.assign(content, content + content_size);
+    } else {
+        // Update replaces whole top level sections. Good enough to exercise the data path, real backend merges deeper.
+        new_data.resize(4);
+        BsonReader update(content, (std::size_t)content_size);
+        BsonReader current(sim_data.data(), sim_data.size());
+        while (!BsonReader::isEndOrError(current.next())) {
+            if (!BsonReader::isEndOrError(update.seekKey(current.key()))) continue;
+
+            auto [ptr, size] = current.rawElement();
+            new_data.insert(new_data.end(), ptr, ptr + size);
+        }
+        // Elements of the update document, without its size header and terminator
+        new_data.insert(new_data.end(), content + 4, content + content_size - 1);
+        new_data.push_back(0);
+
+        int32_t total_size = (int32_t)new_data.size();
+        std::memcpy(new_data.data(), &total_size, sizeof(total_size));
+    }
+
+    if (!writeBsonBlock(sim_data_shm, new_data.data(), (uint32_t)new_data.size())) {
+        return CommandResponse::error(SC_API_PROTOCOL_ERROR_NO_RESOURCE, "Sim data doesn't fit to shared memory");
+    }
+    sim_data = std::move(new_data);
+    return {};
+}
+
+void LoopbackBackend::Impl::connectionClosed(Connection& connection) {
+    if (connection.controller_id != 0) {
+        const uint16_t id = connection.controller_id;
+        pipelines.erase(std::remove_if(pipelines.begin(), pipelines.end(),
+                                       [id](const Pipeline& p) { return p.controller_id == id; }),
+                        pipelines.end());
+        registered_controllers.erase(
+            std::remove(registered_controllers.begin(), registered_controllers.end(), id),
+            registered_controllers.end());
+        connection.controller_id = 0;
+    }
+
+    connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                     [&connection](const auto& c) { return c.get() == &connection; }),
+                      connections.end());
+}
+
+bool LoopbackBackend::Impl::isRegisteredController(uint16_t controller_id) const {
+    return std::find(registered_controllers.begin(), registered_controllers.end(), controller_id) !=
+           registered_controllers.end();
+}
+
+const LoopbackBackend::Impl::Pipeline* LoopbackBackend::Impl::findPipeline(int32_t device_session_id,
+                                                                           int32_t pipeline_id) const {
+    for (const Pipeline& p : pipelines) {
+        if (p.device_session_id == device_session_id && p.pipeline_id == pipeline_id) return &p;
+    }
+    return nullptr;
+}
+
+LoopbackBackend::LoopbackBackend(LoopbackBackendConfig config) : p_(std::make_unique<Impl>(std::move(config))) {}
+
+LoopbackBackend::~LoopbackBackend() { stop(); }
+
+void LoopbackBackend::setActionObserver(ActionObserver observer) { p_->observer = std::move(observer); }
+
+bool LoopbackBackend::start() { return p_->start(); }
+
+void LoopbackBackend::stop() { p_->stop(); }
+
+bool LoopbackBackend::isRunning() const { return p_->running; }
+
+uint32_t LoopbackBackend::getSessionId() const { return p_->session_id; }
+
+uint16_t LoopbackBackend::getTcpPort() const {
+    asio::error_code ec;
+    return p_->acceptor.local_endpoint(ec).port();
+}
+
+uint16_t LoopbackBackend::getUdpPort() const {
+    asio::error_code ec;
+    return p_->udp_socket.local_endpoint(ec).port();
+}
+
+LoopbackActionStats LoopbackBackend::getActionStats() const {
+    std::lock_guard lock(p_->stats_mutex);
+    return p_->stats;
+}
+
+void LoopbackBackend::resetActionStats() {
+    std::lock_guard lock(p_->stats_mutex);
+    p_->stats = {};
+}
+
+}  // namespace sc_api::tools
@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @brief Stand-in for the Tuner side of SC-API that runs fully on the local machine
+ *
+ */
+
+#ifndef SC_API_TOOLS_LOOPBACK_BACKEND_H_
+#define SC_API_TOOLS_LOOPBACK_BACKEND_H_
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "sc-api/core/protocol/actions.h"
+
+namespace sc_api::tools {
+
+struct LoopbackBackendConfig {
+    /** Prefix used for the session specific shared memory names */
+    std::string shm_prefix                = "sc-api-loopback";
+
+    /** TCP port for commands. 0 lets the operating system pick a free port */
+    uint16_t tcp_port                     = 0;
+
+    /** UDP port for actions. 0 lets the operating system pick a free port */
+    uint16_t udp_port                     = 0;
+
+    /** Datagram size limits published in the session block. Defaults are the smallest values a backend may use */
+    uint16_t udp_max_plaintext_size       = 4096;
+    uint16_t udp_max_encrypted_size       = 1400;
+
+    /** Receive buffer size requested for the action socket so that bursts aren't dropped under load */
+    int udp_receive_buffer_size           = 4 * 1024 * 1024;
+
+    /** How often keep_alive_counter is increased. Real backend does this at least 10Hz */
+    std::chrono::milliseconds keep_alive_period{100};
+};
+
+/** Counters of the received action traffic */
+struct LoopbackActionStats {
+    uint64_t datagrams            = 0;
+    uint64_t bytes                = 0;
+    uint64_t actions              = 0;
+
+    /** Datagrams that had an action header with invalid size. Rest of the datagram is ignored */
+    uint64_t malformed_datagrams  = 0;
+
+    /** Actions from a controller id that isn't registered */
+    uint64_t unknown_controller   = 0;
+
+    /** Encrypted actions are counted, but not decrypted */
+    uint64_t encrypted_actions    = 0;
+
+    uint64_t ffb_effect_actions   = 0;
+    uint64_t ffb_effect_samples   = 0;
+    uint64_t ffb_clear_actions    = 0;
+    uint64_t telemetry_actions    = 0;
+    uint64_t other_actions        = 0;
+
+    /** Commands received through TCP connections, including register */
+    uint64_t commands             = 0;
+};
+
+/** Publishes SC-API session shared memory and serves the command and action protocols on loopback interface
+ *
+ * Session contains two ActivePedals, brake and throttle, with a few variables each, set of telemetry definitions and
+ * empty sim data. This is enough for opening a session, registering to control, configuring effect pipelines and
+ * sending any actions without Tuner or hardware, so the whole client side data path can be integration and load
+ * tested on a plain machine.
+ *
+ * There can be only one backend, real or loopback, at a time on a machine as the core shared memory block has a fixed
+ * name. Secure sessions are not supported and encrypted actions are only counted.
+ */
+class LoopbackBackend {
+    class Impl;
+
+public:
+    /** Called for every received action from the receiving thread
+     *
+     * @param header Action header
+     * @param action Pointer to the start of the action including the header, valid only during the call
+     */
+    using ActionObserver = std::function<void(const SC_API_PROTOCOL_ActionHeader_t& header, const uint8_t* action)>;
+
+    explicit LoopbackBackend(LoopbackBackendConfig config = {});
+    ~LoopbackBackend();
+
+    LoopbackBackend(const LoopbackBackend&)            = delete;
+    LoopbackBackend& operator=(const LoopbackBackend&) = delete;
+
+    /** Set observer for the received actions. Must be called before start() */
+    void setActionObserver(ActionObserver observer);
+
+    /** Publish shared memory blocks, open sockets and start the backend thread
+     *
+     * @return false, if shared memory or sockets could not be created or the backend is already running
+     */
+    bool start();
+
+    /** Mark session as shut down, close connections and remove the shared memory blocks */
+    void stop();
+
+    bool isRunning() const;
+
+    uint32_t getSessionId() const;
+
+    uint16_t getTcpPort() const;
+    uint16_t getUdpPort() const;
+
+    LoopbackActionStats getActionStats() const;
+    void                resetActionStats();
+
+private:
+    std::unique_ptr<Impl> p_;
+};
+
+}  // namespace sc_api::tools
+
+#endif  // SC_API_TOOLS_LOOPBACK_BACKEND_H_
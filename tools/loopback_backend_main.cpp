@@ -0,0 +1,80 @@
+/** Runs the loopback backend until interrupted and prints received action statistics
+ *
+ * Usage: sc-api-loopback [--tcp-port N] [--udp-port N] [--stats-interval-ms N]
+ */
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "loopback_backend.h"
+
+namespace {
+
+std::atomic_bool s_stop_requested{false};
+
+void onSignal(int) { s_stop_requested = true; }
+
+void printUsage() { std::printf("Usage: sc-api-loopback [--tcp-port N] [--udp-port N] [--stats-interval-ms N]\n"); }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    sc_api::tools::LoopbackBackendConfig config;
+    long                                 stats_interval_ms = 1000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "--tcp-port") == 0) {
+            config.tcp_port = (uint16_t)std::strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--udp-port") == 0) {
+            config.udp_port = (uint16_t)std::strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--stats-interval-ms") == 0) {
+            stats_interval_ms = std::strtol(argv[++i], nullptr, 10);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    sc_api::tools::LoopbackBackend backend(config);
+    if (!backend.start()) {
+        std::fprintf(stderr, "Failed to start loopback backend. Is another backend already running?\n");
+        return 2;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    std::printf("Loopback backend running: session 0x%08x, tcp 127.0.0.1:%u, udp 127.0.0.1:%u\n",
+                backend.getSessionId(), backend.getTcpPort(), backend.getUdpPort());
+
+    sc_api::tools::LoopbackActionStats prev;
+    auto                               next_print = std::chrono::steady_clock::now();
+    while (!s_stop_requested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (stats_interval_ms <= 0 || std::chrono::steady_clock::now() < next_print) continue;
+        next_print += std::chrono::milliseconds(stats_interval_ms);
+
+        sc_api::tools::LoopbackActionStats s = backend.getActionStats();
+        if (s.datagrams == prev.datagrams && s.commands == prev.commands) continue;
+
+        std::printf(
+            "datagrams %llu (+%llu) actions %llu (+%llu) bytes %llu effects %llu samples %llu clears %llu telemetry "
+            "%llu other %llu encrypted %llu malformed %llu unknown_controller %llu commands %llu\n",
+            (unsigned long long)s.datagrams, (unsigned long long)(s.datagrams - prev.datagrams),
+            (unsigned long long)s.actions, (unsigned long long)(s.actions - prev.actions), (unsigned long long)s.bytes,
+            (unsigned long long)s.ffb_effect_actions, (unsigned long long)s.ffb_effect_samples,
+            (unsigned long long)s.ffb_clear_actions, (unsigned long long)s.telemetry_actions,
+            (unsigned long long)s.other_actions, (unsigned long long)s.encrypted_actions,
+            (unsigned long long)s.malformed_datagrams, (unsigned long long)s.unknown_controller,
+            (unsigned long long)s.commands);
+        std::fflush(stdout);
+        prev = s;
+    }
+
+    backend.stop();
+    return 0;
+}